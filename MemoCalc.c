@@ -21,6 +21,22 @@
 #include "MemoCalcFunctions.h"
 #include "MemoCalcLexer.h"
 #include "MemoCalcParser.h"
+#include "MemoCalcGradient.h"
+#include "MemoCalcSolver.h"
+#include "MemoCalcBatch.h"
+#include "MemoCalcMonteCarlo.h"
+#include "MemoCalcDispatch.h"
+#include "MemoCalcOptimizer.h"
+#include "MemoCalcExport.h"
+#include "MemoCalcFixed.h"
+#include "MemoCalcCache.h"
+#include "MemoCalcIncremental.h"
+#include "MemoCalcBytecode.h"
+#include "MemoCalcIntern.h"
+#include "MemoCalcPersist.h"
+#include "MemoCalcMulti.h"
+#include "MemoCalcSheet.h"
+#include "MemoCalcLibrary.h"
 
 
 /***********************************************************************
@@ -33,15 +49,17 @@
 #define memoDBType					'DATA'
 #define memoCalcDefaultCategoryName	"MemoCalc"
 #define memoCalcCurrRecFtrNum		0
+#define memoCalcEvalLevelFtrNum		1	// set to force an evaluation level
+#define memoCalcFixedScaleFtrNum	2	// set to change the fixed point decimals
+#define memoCalcOptimizeFtrNum		3	// set to 0 for rewrites that may round differently
+#define memoCalcSamplesPrecisionFtrNum	4	// set to 1 for Monte Carlo samples in single precision
 
 #define kEditFormTitle				"Expression editor"
 #define kVarsEditLabel				"Vars"
 #define kVarsListLabel				"List"
 #define kErrorStr					"Error"
-#define kExprTag					"<--expr-->"
-#define kVarsTag					"<--vars-->"
-#define kExprTagLen					10
-#define kVarsTagLen					10
+#define kOverflowStr				"Overflow"
+#define kExportDoneStr				"C source saved as a new memo"
 
 #define editorSaveMemo				0
 #define editorDeleteMemo			1
@@ -50,6 +68,7 @@
 
 #define resultBaseDecimal			0
 #define resultBaseHexadecimal		1
+#define resultBaseFixed				2
 
 #define kMemoHeaderSize				20
 #define kMemoHeaderStr				"MemoCalc XXXXXX\n"
@@ -70,6 +89,8 @@ static EventType sAppEvent;
 /* **** **** Memo DB **** **** */
 static DmOpenRef sMemoDB;
 static UInt16 sMemoCalcCategory;
+static Sheet sSheet;
+static Boolean sLibraryEdited;
 
 /* **** **** List View ** **** */
 static UInt16 sCurrentRecIndex, sTopVisibleRecIndex, sSavedRecIndex;
@@ -82,6 +103,7 @@ static Int16 sNVars;
 static UInt16 sEditFieldFocus;
 static UInt8 sEditorSavePolicy;
 static UInt8 sEditorResultBase;
+static UInt8 sFixedScale;
 static Boolean sVarsOk, sVarsList;
 static Char sMemoHeaderBuf[kMemoHeaderSize];
 
@@ -201,6 +223,104 @@ static UInt16 MemoCalcDBClose (DmOpenRef *dbPP)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	MemoCalcIsLibrary
+ *
+ * DESCRIPTION: Check a memo is titled kLibraryTitle
+ *
+ * PARAMETERS:  memo string
+ *
+ * RETURNED:	true for the library memo
+ *
+ ***********************************************************************/
+
+static Boolean MemoCalcIsLibrary (Char * memoStr)
+{
+	UInt16 titleLen = StrLen(kLibraryTitle), iNext = titleLen;
+
+	if (StrNCompare(memoStr, kLibraryTitle, titleLen))
+		return false;
+	while (memoStr[iNext] == ' ' || memoStr[iNext] == '\t')
+		++iNext;
+	return memoStr[iNext] == '\n' || StrNCompare(memoStr + iNext, kVarsTag, kVarsTagLen) == 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MemoCalcLoadLibrary
+ *
+ * DESCRIPTION: Load the vars of the library memo of the MemoCalc
+ *		category as the shared constants library
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void MemoCalcLoadLibrary (void)
+{
+	MemHandle memoH;
+	Char * memoStr, * varsStr, * exprStr, * libStr = NULL;
+	UInt16 recIndex = 0;
+
+	for (; !libStr && (memoH = DmQueryNextInCategory(sMemoDB, &recIndex, sMemoCalcCategory)) != NULL; recIndex++)
+	{
+		memoStr = MemHandleLock(memoH);
+		varsStr = StrStr(memoStr, kVarsTag);
+		exprStr = StrStr(memoStr, kExprTag);
+		if (varsStr && exprStr && varsStr < exprStr && MemoCalcIsLibrary(memoStr))
+		{
+			varsStr += kVarsTagLen;
+			libStr = MemPtrNew(1 + (UInt32)exprStr - (UInt32)varsStr);
+			StrNCopy(libStr, varsStr, (UInt32)exprStr - (UInt32)varsStr);
+			libStr[(UInt16)((UInt32)exprStr - (UInt32)varsStr)] = nullChr;
+		}
+		MemHandleUnlock(memoH);
+	}
+
+	LoadConstLibrary(libStr);
+	if (libStr)
+		MemPtrFree(libStr);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MemoCalcMemoSaved
+ *
+ * DESCRIPTION: Update the memos graph after a memo was saved, or load
+ *		the library again if it was the library memo, before or after
+ *
+ * PARAMETERS:  index of the record saved, dmMaxRecordIndex if deleted
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void MemoCalcMemoSaved (UInt16 recIndex)
+{
+	MemHandle memoH;
+
+	if (recIndex != dmMaxRecordIndex && (memoH = DmQueryRecord(sMemoDB, recIndex)) != NULL)
+	{
+		sLibraryEdited |= MemoCalcIsLibrary(MemHandleLock(memoH));
+		MemHandleUnlock(memoH);
+	}
+	// any memo may use a library constant
+	if (sLibraryEdited)
+	{
+		MemoCalcLoadLibrary();
+		DeleteSheet(&sSheet);
+	}
+	else
+		UpdateSheet(&sSheet, recIndex);
+	sLibraryEdited = false;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	StartApplication
@@ -226,12 +346,29 @@ static UInt16 StartApplication (void)
 	// Memo DB
 	sMemoDB = NULL;
 	sMemoCalcCategory = dmAllCategories;
+	sLibraryEdited = false;
 
 // Run init code
 	err = MemoCalcMathLibOpen();
+	if (FtrGet(sysFileCMemoCalc, memoCalcEvalLevelFtrNum, &ftr))
+		ftr = evalLevelAuto;
+	SelectEvalDispatch((UInt8) ftr);
+	if (FtrGet(sysFileCMemoCalc, memoCalcFixedScaleFtrNum, &ftr))
+		ftr = kFixedDefaultScale;
+	sFixedScale = (UInt8) ftr;
+	if (FtrGet(sysFileCMemoCalc, memoCalcOptimizeFtrNum, &ftr))
+		ftr = optimizeExact;
+	SetOptimizeFlags((UInt8) ftr);
+	if (FtrGet(sysFileCMemoCalc, memoCalcSamplesPrecisionFtrNum, &ftr))
+		ftr = batchDouble;
+	SetMonteCarloPrecision((UInt8) ftr);
 	err = MemoCalcDBOpen(&sMemoDB, &sMemoCalcCategory);
 	if (err)
 		goto Exit;
+	// compiled expressions saved by previous runs, memos still work without
+	OpenPersistCache(sysFileCMemoCalc);
+	InitSheet(&sSheet, sMemoDB, sMemoCalcCategory);
+	MemoCalcLoadLibrary();
 
 	// List View
 	if (FtrGet(sysFileCMemoCalc, memoCalcCurrRecFtrNum, &ftr)
@@ -261,6 +398,11 @@ static UInt16 StopApplication (void)
 {
 	UInt16 err;
 	FrmCloseAllForms();
+	FlushEvalCache();
+	FlushInternTable();
+	ClosePersistCache();
+	DeleteSheet(&sSheet);
+	UnloadConstLibrary();
 	err = MemoCalcDBClose(&sMemoDB);
 	MemoCalcMathLibClose();
 	return err;
@@ -352,12 +494,10 @@ static void EditViewToggleExprButtons (FormPtr frmP)
 		FrmShowObject(frmP, FrmGetObjectIndex(frmP, Bopn));
 		FrmShowObject(frmP, FrmGetObjectIndex(frmP, Bcls));
 		FrmShowObject(frmP, FrmGetObjectIndex(frmP, Bclr));
+		FrmShowObject(frmP, FrmGetObjectIndex(frmP, Bexp));
 		FrmHideObject(frmP, FrmGetObjectIndex(frmP, Bequ));
 		if (MathLibRef)
-		{
-			FrmShowObject(frmP, FrmGetObjectIndex(frmP, Bexp));
 			FrmShowObject(frmP, FrmGetObjectIndex(frmP, FunctionsTrigger));
-		}
 	}
 	else
 	{
@@ -367,11 +507,9 @@ static void EditViewToggleExprButtons (FormPtr frmP)
 		FrmHideObject(frmP, FrmGetObjectIndex(frmP, Bopn));
 		FrmHideObject(frmP, FrmGetObjectIndex(frmP, Bcls));
 		FrmHideObject(frmP, FrmGetObjectIndex(frmP, Bclr));
+		FrmHideObject(frmP, FrmGetObjectIndex(frmP, Bexp));
 		if (MathLibRef)
-		{
-			FrmHideObject(frmP, FrmGetObjectIndex(frmP, Bexp));
 			FrmHideObject(frmP, FrmGetObjectIndex(frmP, FunctionsTrigger));
-		}
 		if (FrmGetFocus(frmP) == FrmGetObjectIndex(frmP, VarsField))
 		{
 			sEditFieldFocus = FrmGetObjectIndex(frmP, VarsField);
@@ -383,6 +521,72 @@ static void EditViewToggleExprButtons (FormPtr frmP)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	EditViewGetVarValueRange
+ *
+ * DESCRIPTION: Find the value of a variable in the vars string, or
+ *		its definition up to the end of the line
+ *
+ * PARAMETERS:  vars string, variable index, value start and end
+ *
+ * RETURNED:	nothing, start and end are equal if not found or if
+ *		the variable is declared with a distribution
+ *
+ ***********************************************************************/
+
+static void EditViewGetVarValueRange (Char * varsStr, Int16 iVar, UInt16 * valStartP, UInt16 * valEndP)
+{
+	Int16 iChar, iPeek;
+
+	* valStartP = * valEndP = 0;
+	iChar = 0;
+	while (varsStr[iChar])
+	{
+		if (varsStr[iChar] == '=' || varsStr[iChar] == '~')
+		{
+			iChar++;
+			if (varsStr[iChar-1] == '~' && !iVar)
+				break;
+			if (varsStr[iChar-1] == '=')
+			{
+				while (isSeparator(varsStr[iChar]))
+					iChar++;
+				* valStartP = iChar;
+				if (varsStr[iChar] == '0' && isHexTag(varsStr[iChar+1]))
+				{
+					iChar += 2;
+					while (isHexNumber(varsStr[iChar]))
+						iChar++;
+				}
+				else
+					while (isNumber(varsStr[iChar]) || varsStr[iChar] == '.' || varsStr[iChar] == '-')
+						iChar++;
+				// a definition, which may hold '~' operators
+				iPeek = iChar;
+				while (varsStr[iPeek] == ' ' || varsStr[iPeek] == '\t')
+					iPeek++;
+				if (varsStr[iPeek] && varsStr[iPeek] != '\n' && varsStr[iPeek] != 0x0d
+				&& (iPeek == iChar || !isLetter(varsStr[iPeek])))
+				{
+					while (varsStr[iChar] && varsStr[iChar] != '\n' && varsStr[iChar] != 0x0d)
+						iChar++;
+					while (iChar > * valStartP && isSeparator(varsStr[iChar-1]))
+						iChar--;
+				}
+				* valEndP = iChar;
+			}
+			if (!iVar)
+				break;
+			iVar--;
+			* valStartP = * valEndP = 0;
+			continue;
+		}
+		iChar++;
+	}
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	EditViewToggleVarsView
@@ -401,7 +605,7 @@ static void EditViewToggleVarsView (FormPtr frmP)
 	ListPtr varsLstP;
 	FieldPtr varsFldP;
 	Char * varsStr;
-	Int16 iVar, iChar;
+	Int16 iVar;
 	UInt16 valStart, valEnd;
 
 	if (sVarsStrTbl)
@@ -439,29 +643,8 @@ static void EditViewToggleVarsView (FormPtr frmP)
 		valStart = valEnd = 0;
 		iVar = LstGetSelection(varsLstP);
 		if (sVarsOk && varsStr && iVar != noListSelection)
-		{	// select variable value in the field
-			iChar = 0;
-			while (varsStr[iChar])
-			{
-				if (varsStr[iChar] == '=')
-				{
-					iChar++;
-					if (iVar)
-						iVar--;
-					else
-					{
-						while (isSeparator(varsStr[iChar]))
-							iChar++;
-						valStart = iChar;
-						while (isNumber(varsStr[iChar]) || varsStr[iChar] == '.' || varsStr[iChar] == '-')
-							iChar++;
-						valEnd = iChar;
-						break;
-					}
-				}
-				iChar++;
-			}
-		}
+			// select variable value in the field
+			EditViewGetVarValueRange(varsStr, iVar, &valStart, &valEnd);
 
 		FrmHideObject(frmP, FrmGetObjectIndex(frmP, VarsList));
 		FrmShowObject(frmP, FrmGetObjectIndex(frmP, Bequ));
@@ -484,6 +667,87 @@ static void EditViewToggleVarsView (FormPtr frmP)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	EditViewEvalFixed
+ *
+ * DESCRIPTION: Evaluate in fixed point with sFixedScale decimals, and
+ *		in double where the fixed point engine has no function. An
+ *		expression that does not compile fails, even for a missing
+ *		function, its tree would be partial.
+ *
+ * PARAMETERS:  expression string, vars string, result buffer
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+static UInt8 EditViewEvalFixed (Char * exprStr, Char * varsStr, Char * resultBuf)
+{
+	CompiledExpr comp;
+	FixedExpr fix;
+	FlpCompDouble result;
+	Int64Value fixResult;
+	UInt8 err = 0;
+
+	err = CompileExpr(exprStr, varsStr, &comp);
+	if (err)
+	{
+		DeleteCompiledExpr(&comp);
+		return err;
+	}
+	err = CompileFixedExpr(&comp, sFixedScale, 0, &fix);
+	if (!err)
+	{
+		err = EvalFixedExpr(&fix, &fixResult);
+		if (!err)
+			FixedToA(&fix, fixResult, resultBuf);
+		DeleteFixedExpr(&fix);
+	}
+	if (err == missingFuncError)
+	{
+		err = EvalExprTree(&(comp.exprT), &(result.d));
+		if (!err)
+			FlpCmpDblToA(&result, resultBuf);
+	}
+	DeleteCompiledExpr(&comp);
+
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EditViewEvalMulti
+ *
+ * DESCRIPTION: Evaluate a memo of named expressions, the first one is
+ *		the result shown
+ *
+ * PARAMETERS:  expressions string, vars string, result
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+static UInt8 EditViewEvalMulti (Char * exprStr, Char * varsStr, double * resultP)
+{
+	MultiExpr multi;
+	double results[kMultiMaxExprs];
+	UInt8 errs[kMultiMaxExprs];
+	UInt8 err = 0;
+
+	err = CompileMultiExpr(exprStr, varsStr, &multi);
+	if (err)
+		return err;
+	EvalMultiExpr(&multi, results, errs);
+	* resultP = results[0];
+	err = errs[0];
+	DeleteMultiExpr(&multi);
+
+	return err;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	EditViewEval
@@ -502,6 +766,8 @@ static void EditViewEval (FormPtr frmP)
 	FieldPtr exprFldP, varsFldP, resultFldP;
 	Char * exprStr, * varsStr;
 	FlpCompDouble result;
+	Int64Value intResult;
+	Boolean doubleResult = false;
 	UInt8 err = 0;
 
 	exprFldP = FrmGetObjectPtr(frmP, FrmGetObjectIndex(frmP, ExprField));
@@ -513,19 +779,46 @@ static void EditViewEval (FormPtr frmP)
 
 	if (exprStr == NULL || *exprStr == '\0')
 		result.d = 0;
+	else if (IsSheetExpr(exprStr, varsStr))
+	{
+		err = EvalSheetExpr(&sSheet, exprStr, varsStr, &(result.d));
+		doubleResult = true;
+	}
+	else if ((doubleResult = IsMultiExpr(exprStr)))
+		err = EditViewEvalMulti(exprStr, varsStr, &(result.d));
+	else if (sEditorResultBase == resultBaseFixed)
+		err = EditViewEvalFixed(exprStr, varsStr, resultBuf);
 	else
 		err = Eval(exprStr, varsStr, &(result.d));
 	sVarsOk = !(err & missingVarError);
 
-	if (err)
+	if (err & overflowError)
+		StrCopy(resultBuf, kOverflowStr);
+	else if (err)
 		StrCopy(resultBuf, kErrorStr);
 	else {
 		switch (sEditorResultBase) {
 			case resultBaseDecimal:
 				FlpCmpDblToA(&result, resultBuf);
 			break;
+			case resultBaseFixed:
+				if (exprStr == NULL || *exprStr == '\0')
+					StrCopy(resultBuf, "0");
+				else if (doubleResult)
+					FlpCmpDblToA(&result, resultBuf);
+			break;
 			case resultBaseHexadecimal:
-				StrPrintF(resultBuf,"0x%08lx",(long)result.d);
+				// out of the integer range, or NaN, shown in decimal
+				if (!isInt64Range(result.d))
+				{
+					FlpCmpDblToA(&result, resultBuf);
+					break;
+				}
+				intResult = (Int64Value) result.d;
+				if (intResult == (long) intResult || (intResult >= 0 && intResult <= 0xFFFFFFFFL))
+					StrPrintF(resultBuf,"0x%08lx",(long)intResult);
+				else
+					StrPrintF(resultBuf,"0x%lx%08lx",(long)(intResult >> 32),(long)intResult);
 			break;
 			default:
 				StrCopy(resultBuf, kErrorStr);
@@ -537,6 +830,522 @@ static void EditViewEval (FormPtr frmP)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	EditViewCompileSelected
+ *
+ * DESCRIPTION: Compile the expression of the memo, or of a multiple
+ *		expressions memo the one at the insertion point, the other
+ *		named expressions being its definitions
+ *
+ * PARAMETERS:  Pointer to the edit view form, multiple expressions,
+ *		compiled expression, both to delete with
+ *		EditViewDeleteSelected
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+static UInt8 EditViewCompileSelected (FormPtr frmP, MultiExpr * multiP, CompiledExpr * compP)
+{
+	FieldPtr exprFldP, varsFldP;
+	UInt8 err = 0;
+
+	exprFldP = FrmGetObjectPtr(frmP, FrmGetObjectIndex(frmP, ExprField));
+	varsFldP = FrmGetObjectPtr(frmP, FrmGetObjectIndex(frmP, VarsField));
+
+	MemSet(multiP, sizeof(MultiExpr), 0);
+	if (!IsMultiExpr(FldGetTextPtr(exprFldP)))
+		return CompileExpr(FldGetTextPtr(exprFldP), FldGetTextPtr(varsFldP), compP);
+
+	MemSet(compP, sizeof(CompiledExpr), 0);
+	err = CompileMultiExpr(FldGetTextPtr(exprFldP), FldGetTextPtr(varsFldP), multiP);
+	if (!err)
+		err = GetMultiCompiledExpr(multiP, FldGetInsPtPosition(exprFldP), compP);
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EditViewDeleteSelected
+ *
+ * DESCRIPTION: Delete the expression compiled by EditViewCompileSelected
+ *
+ * PARAMETERS:  multiple expressions, compiled expression
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void EditViewDeleteSelected (MultiExpr * multiP, CompiledExpr * compP)
+{
+	if (multiP->exprStr)
+		DeleteMultiExpr(multiP);
+	else
+		DeleteCompiledExpr(compP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EditViewGradient
+ *
+ * DESCRIPTION: Show the partial derivatives of the expression with
+ *		respect to each variable
+ *
+ * PARAMETERS:  Pointer to the edit view form
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void EditViewGradient (FormPtr frmP)
+{
+	CompiledExpr comp;
+	MultiExpr multi;
+	Char * msgStr, ** gradStrTbl = NULL;
+	Int16 nGrad = 0, i;
+	UInt16 len;
+	UInt8 err = 0;
+
+	err = EditViewCompileSelected(frmP, &multi, &comp);
+	if (!err)
+		err = MakeExprGradientStringList(&comp, &gradStrTbl, &nGrad);
+	EditViewDeleteSelected(&multi, &comp);
+	if (err || !nGrad)
+	{
+		FrmCustomAlert(InfoAlert, kErrorStr, "", "");
+		return;
+	}
+
+	len = 1;
+	for (i = 0; i < nGrad; i++)
+		len += StrLen(gradStrTbl[i]) + 1;
+	msgStr = MemPtrNew(len);
+	*msgStr = nullChr;
+	for (i = 0; i < nGrad; i++)
+	{
+		StrCat(msgStr, gradStrTbl[i]);
+		StrCat(msgStr, "\n");
+		MemPtrFree(gradStrTbl[i]);
+	}
+	MemPtrFree(gradStrTbl);
+
+	FrmCustomAlert(InfoAlert, msgStr, "", "");
+	MemPtrFree(msgStr);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EditViewResults
+ *
+ * DESCRIPTION: Show the result of each named expression of the memo
+ *
+ * PARAMETERS:  Pointer to the edit view form
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void EditViewResults (FormPtr frmP)
+{
+	FieldPtr exprFldP, varsFldP;
+	MultiExpr multi;
+	FlpCompDouble result;
+	double results[kMultiMaxExprs];
+	UInt8 errs[kMultiMaxExprs];
+	Char * msgStr;
+	UInt16 len, i;
+	UInt8 err = 0;
+
+	exprFldP = FrmGetObjectPtr(frmP, FrmGetObjectIndex(frmP, ExprField));
+	varsFldP = FrmGetObjectPtr(frmP, FrmGetObjectIndex(frmP, VarsField));
+
+	err = CompileMultiExpr(FldGetTextPtr(exprFldP), FldGetTextPtr(varsFldP), &multi);
+	if (err)
+	{
+		FrmCustomAlert(InfoAlert, kErrorStr, "", "");
+		return;
+	}
+	EvalMultiExpr(&multi, results, errs);
+
+	len = 1;
+	for (i = 0; i < multi.nExprs; i++)
+		len += (multi.namesP[i] ? StrLen(multi.namesP[i]) : 0) + 3 + kFlpBufSize + 1;
+	msgStr = MemPtrNew(len);
+	*msgStr = nullChr;
+	for (i = 0; i < multi.nExprs; i++)
+	{
+		if (multi.namesP[i])
+			StrCat(msgStr, multi.namesP[i]);
+		StrCat(msgStr, " = ");
+		result.d = results[i];
+		if (errs[i] & overflowError)
+			StrCat(msgStr, kOverflowStr);
+		else if (errs[i])
+			StrCat(msgStr, kErrorStr);
+		else
+			FlpCmpDblToA(&result, msgStr + StrLen(msgStr));
+		StrCat(msgStr, "\n");
+	}
+	DeleteMultiExpr(&multi);
+
+	FrmCustomAlert(InfoAlert, msgStr, "", "");
+	MemPtrFree(msgStr);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EditViewGoalSeek
+ *
+ * DESCRIPTION: Ask for a target value and a variable, solve the
+ *		expression for this variable and replace its value in the vars
+ *		field.
+ *
+ * PARAMETERS:  Pointer to the edit view form
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void EditViewGoalSeek (FormPtr frmP)
+{
+	FormPtr dlgP;
+	FieldPtr varsFldP, fldP;
+	ListPtr lstP;
+	CompiledExpr comp;
+	MultiExpr multi;
+	FlpCompDouble tmpF;
+	Char * varsStr, * valueStr, ** strTbl;
+	Char targetBuf[kFlpBufSize], valueBuf[kFlpBufSize];
+	Int16 nStr, iVar;
+	UInt16 valStart, valEnd;
+	UInt8 err = 0;
+
+	varsFldP = FrmGetObjectPtr(frmP, FrmGetObjectIndex(frmP, VarsField));
+	varsStr = FldGetTextPtr(varsFldP);
+
+	if (MakeVarsStringList(varsStr, &strTbl, &nStr) || !nStr)
+	{
+		FrmCustomAlert(InfoAlert, kErrorStr, "", "");
+		return;
+	}
+
+	iVar = noListSelection;
+	targetBuf[0] = nullChr;
+	dlgP = FrmInitForm(GoalSeekDialog);
+	lstP = FrmGetObjectPtr(dlgP, FrmGetObjectIndex(dlgP, GoalSeekVarsList));
+	LstSetListChoices(lstP, strTbl, nStr);
+	LstSetSelection(lstP, 0);
+	FrmSetFocus(dlgP, FrmGetObjectIndex(dlgP, GoalSeekTargetField));
+	if (FrmDoDialog(dlgP) == GoalSeekOkButton)
+	{
+		iVar = LstGetSelection(lstP);
+		fldP = FrmGetObjectPtr(dlgP, FrmGetObjectIndex(dlgP, GoalSeekTargetField));
+		if (FldGetTextPtr(fldP))
+			StrNCopy(targetBuf, FldGetTextPtr(fldP), kFlpBufSize - 1);
+		targetBuf[kFlpBufSize - 1] = nullChr;
+	}
+	FrmDeleteForm(dlgP);
+
+	while (nStr)
+		MemPtrFree(strTbl[--nStr]);
+	MemPtrFree(strTbl);
+
+	if (iVar == noListSelection || !targetBuf[0])
+		return;
+
+	err |= AToFlpCmpDbl(&tmpF, targetBuf);
+	err |= EditViewCompileSelected(frmP, &multi, &comp);
+	if (!err)
+	{
+		comp.varL.cellP = comp.varL.headP;
+		while (comp.varL.cellP && comp.varL.cellP->index != iVar)
+			comp.varL.cellP = comp.varL.cellP->nextP;
+		if (comp.varL.cellP)
+			err |= SolveExpr(&comp, comp.varL.cellP, tmpF.d, &(tmpF.d));
+		else
+			err |= missingVarError;
+	}
+	EditViewDeleteSelected(&multi, &comp);
+
+	if (!err)
+		err |= FlpCmpDblToA(&tmpF, valueBuf);
+	if (err)
+	{
+		FrmCustomAlert(InfoAlert, kErrorStr, "", "");
+		return;
+	}
+
+	valueStr = valueBuf;
+	while (*valueStr == ' ')
+		valueStr++;
+	// only plain decimal numbers can be read back in the vars field
+	if (StrChr(valueStr, 'e') || StrChr(valueStr, 'E'))
+	{
+		FrmCustomAlert(InfoAlert, valueStr, "", "");
+		return;
+	}
+
+	EditViewGetVarValueRange(varsStr, iVar, &valStart, &valEnd);
+	if (valStart < valEnd)
+	{
+		FldSetSelection(varsFldP, valStart, valEnd);
+		FldInsert(varsFldP, valueStr, StrLen(valueStr));
+	}
+	if (sVarsList)
+		// rebuild the list of values, the view stays the same
+		EditViewToggleVarsView(frmP);
+	else if (valStart < valEnd)
+	{
+		// update the field in place, the new value selected
+		FldSetSelection(varsFldP, valStart, valStart + StrLen(valueStr));
+		MemoCalcUIUpdateScrollBar(frmP, VarsField, VarsScrollBar);
+	}
+	EditViewEval(frmP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EditViewMonteCarlo
+ *
+ * DESCRIPTION: Sample the variables declared with a distribution and
+ *		show the statistics of the expression results
+ *
+ * PARAMETERS:  Pointer to the edit view form
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void EditViewMonteCarlo (FormPtr frmP)
+{
+	static Char * statNames[] = { "mean ", "sd ", "min ", "max ", "5% ", "50% ", "95% " };
+	CompiledExpr comp;
+	MultiExpr multi;
+	MonteCarloStats stats;
+	FlpCompDouble tmpF;
+	Char msgBuf[7 * (kFlpBufSize + 8)], valueBuf[kFlpBufSize], errorsBuf[32];
+	UInt16 i;
+	UInt8 err = 0;
+
+	err = EditViewCompileSelected(frmP, &multi, &comp);
+	if (!err)
+		err = MonteCarloEval(&comp, kMonteCarloSamples, TimGetTicks(), &stats);
+	EditViewDeleteSelected(&multi, &comp);
+	if (err)
+	{
+		FrmCustomAlert(InfoAlert, kErrorStr, "", "");
+		return;
+	}
+
+	msgBuf[0] = nullChr;
+	for (i = 0; i < 7; i++)
+	{
+		switch (i)
+		{
+			case 0: tmpF.d = stats.mean; break;
+			case 1: tmpF.d = MonteCarloStdDev(&stats); break;
+			case 2: tmpF.d = stats.min; break;
+			case 3: tmpF.d = stats.max; break;
+			default: tmpF.d = MonteCarloQuantile(&stats, i - 4);
+		}
+		FlpCmpDblToA(&tmpF, valueBuf);
+		StrCat(msgBuf, statNames[i]);
+		StrCat(msgBuf, valueBuf);
+		StrCat(msgBuf, "\n");
+	}
+	StrPrintF(errorsBuf, "errors %ld / %ld", (long)stats.nErrors, (long)stats.nSamples);
+
+	FrmCustomAlert(InfoAlert, msgBuf, errorsBuf, "");
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EditViewStats
+ *
+ * DESCRIPTION: Show how the expression was optimized, how often
+ *		evaluations were found in the results cache, how many trees
+ *		the memos share and the tier their evaluations are on
+ *
+ * PARAMETERS:  Pointer to the edit view form
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void EditViewStats (FormPtr frmP)
+{
+	FieldPtr exprFldP, varsFldP;
+	CompiledExpr comp;
+	MultiExpr multi;
+	OptimizeStats stats;
+	EvalCacheStats * cacheStatsP;
+	InternStats * internStatsP;
+	PersistStats * persistStatsP;
+	IncrStats * incrStatsP;
+	MultiStats * multiStatsP;
+	SheetStats * sheetStatsP;
+	LibraryStats * libraryStatsP;
+	BatchStats * batchStatsP;
+	TierStats * tierStatsP;
+	TieredExpr * tierP = NULL;
+	Char * tierNames[] = {"tree", "bytecode", "incremental"};
+	Char msgBuf[640];
+	UInt16 i;
+	UInt8 err = 0;
+
+	exprFldP = FrmGetObjectPtr(frmP, FrmGetObjectIndex(frmP, ExprField));
+	varsFldP = FrmGetObjectPtr(frmP, FrmGetObjectIndex(frmP, VarsField));
+
+	MemSet(&stats, sizeof(OptimizeStats), 0);
+	if (IsMultiExpr(FldGetTextPtr(exprFldP)))
+	{
+		err = CompileMultiExpr(FldGetTextPtr(exprFldP), FldGetTextPtr(varsFldP), &multi);
+		if (!err)
+		{
+			// the rewrites of all the expressions of the memo
+			for (i = 0; i < multi.nExprs; i++)
+			{
+				stats.nPolynomials += multi.trees[i].stats.nPolynomials;
+				stats.opsSaved += multi.trees[i].stats.opsSaved;
+				stats.nContractions += multi.trees[i].stats.nContractions;
+				stats.nIntNodes += multi.trees[i].stats.nIntNodes;
+			}
+			DeleteMultiExpr(&multi);
+		}
+	}
+	else
+	{
+		err = CompileExpr(FldGetTextPtr(exprFldP), FldGetTextPtr(varsFldP), &comp);
+		if (!err)
+		{
+			stats = comp.exprT.stats;
+			tierP = GetInternTier(FldGetTextPtr(exprFldP), &(comp.varL));
+		}
+		DeleteCompiledExpr(&comp);
+	}
+	if (err)
+	{
+		FrmCustomAlert(InfoAlert, kErrorStr, "", "");
+		return;
+	}
+
+	StrPrintF(msgBuf, "Horner polynomials %d\nOperations saved %d\nMultiply-adds %d\nInteger operations %d\n",
+		stats.nPolynomials, stats.opsSaved, stats.nContractions, stats.nIntNodes);
+	cacheStatsP = GetEvalCacheStats();
+	StrPrintF(msgBuf + StrLen(msgBuf), "Cache hits %ld misses %ld evictions %ld\n",
+		(long)cacheStatsP->nHits, (long)cacheStatsP->nMisses, (long)cacheStatsP->nEvictions);
+	internStatsP = GetInternStats();
+	StrPrintF(msgBuf + StrLen(msgBuf), "Shared trees %d hits %ld bytes saved %ld\n",
+		internStatsP->nEntries, (long)(internStatsP->nHits + internStatsP->nCanonicalHits),
+		(long)(internStatsP->nodesShared * sizeof(ExprNode)));
+	persistStatsP = GetPersistStats();
+	StrPrintF(msgBuf + StrLen(msgBuf), "Saved trees %d loaded %ld evicted %ld\n",
+		persistStatsP->nRecords, (long)persistStatsP->nLoads, (long)persistStatsP->nEvictions);
+	incrStatsP = GetIncrStats();
+	StrPrintF(msgBuf + StrLen(msgBuf), "Nodes evaluated %ld reused %ld\n",
+		(long)incrStatsP->nRecomputed, (long)incrStatsP->nReused);
+	multiStatsP = GetMultiStats();
+	StrPrintF(msgBuf + StrLen(msgBuf), "Expressions %d nodes %d shared %d\n",
+		multiStatsP->nExprs, multiStatsP->nNodes, multiStatsP->nNodes - multiStatsP->nSlots);
+	sheetStatsP = GetSheetStats();
+	StrPrintF(msgBuf + StrLen(msgBuf), "Memos %d levels %d recalculated %ld\n",
+		sheetStatsP->nMemos, sheetStatsP->nLevels, (long)sheetStatsP->nRecalcs);
+	libraryStatsP = GetLibraryStats();
+	StrPrintF(msgBuf + StrLen(msgBuf), "Library constants %d hits %ld\n",
+		libraryStatsP->nConsts, (long)libraryStatsP->nHits);
+	batchStatsP = GetBatchStats();
+	StrPrintF(msgBuf + StrLen(msgBuf), "Single samples %ld rechecked %ld\n",
+		(long)batchStatsP->nSingleRows, (long)batchStatsP->nRechecked);
+	if (tierP)
+		StrPrintF(msgBuf + StrLen(msgBuf), "Tier %s after %ld evaluations, up at %d and %d\n",
+			tierNames[tierP->tier], (long)tierP->nEvals, kTierBytecodeEvals, kTierIncrEvals);
+	tierStatsP = GetTierStats();
+	StrPrintF(msgBuf + StrLen(msgBuf), "Tree evaluations %ld bytecode %ld incremental %ld\n",
+		(long)tierStatsP->nTreeEvals, (long)tierStatsP->nBytecodeEvals, (long)tierStatsP->nIncrEvals);
+	FrmCustomAlert(InfoAlert, msgBuf, "", "");
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EditViewExport
+ *
+ * DESCRIPTION: Export the expression as C source in a new unfiled
+ *		memo, to be compiled on the desktop after a HotSync.
+ *
+ * PARAMETERS:  Pointer to the edit view form, export flags
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void EditViewExport (FormPtr frmP, UInt8 flags)
+{
+	CompiledExpr comp;
+	MultiExpr multi;
+	MemHandle srcH;
+	Char * srcStr = NULL;
+	UInt16 srcIndex = dmMaxRecordIndex;
+	UInt8 err = 0;
+
+	err = EditViewCompileSelected(frmP, &multi, &comp);
+	if (!err)
+		err |= ExportExprC(&comp, sEditViewTitleStr, flags, &srcStr);
+	EditViewDeleteSelected(&multi, &comp);
+	if (err)
+	{
+		FrmCustomAlert(InfoAlert, kErrorStr, "", "");
+		return;
+	}
+
+	srcH = DmNewRecord(sMemoDB, &srcIndex, StrLen(srcStr) + 1);
+	if (srcH)
+	{
+		DmWrite(MemHandleLock(srcH), 0, srcStr, StrLen(srcStr) + 1);
+		MemHandleUnlock(srcH);
+		DmReleaseRecord(sMemoDB, srcIndex, true);
+		FrmCustomAlert(InfoAlert, kExportDoneStr, "", "");
+	}
+	else
+		FrmCustomAlert(InfoAlert, kErrorStr, "", "");
+	MemPtrFree(srcStr);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EditViewPersist
+ *
+ * DESCRIPTION: Save the compiled tree of a single expression memo for
+ *		the next run, on save or evaluation by the Eval button only, so
+ *		that the memos merely browsed do not fill the cache database
+ *
+ * PARAMETERS:  Pointer to the edit view form
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void EditViewPersist (FormPtr frmP)
+{
+	Char * exprStr, * varsStr;
+
+	exprStr = FldGetTextPtr(FrmGetObjectPtr(frmP, FrmGetObjectIndex(frmP, ExprField)));
+	varsStr = FldGetTextPtr(FrmGetObjectPtr(frmP, FrmGetObjectIndex(frmP, VarsField)));
+	if (exprStr == NULL || *exprStr == '\0'
+	|| IsSheetExpr(exprStr, varsStr) || IsMultiExpr(exprStr))
+		return;
+	PersistMemoExpr(exprStr, varsStr);
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	EditViewSave
@@ -561,6 +1370,7 @@ static void EditViewSave (FormPtr frmP)
 	memoLen = exprLen = varsLen = titleLen = 0;
 	memoStr = exprStr = varsStr = tmpStr = NULL;
 	defaultTitle = 0;
+	sLibraryEdited = false;
 
 	if (sEditViewTitleStr)
 	{
@@ -572,6 +1382,7 @@ static void EditViewSave (FormPtr frmP)
 	if (sMemoH)
 	{
 		memoStr = (Char*) MemHandleLock(sMemoH);
+		sLibraryEdited = MemoCalcIsLibrary(memoStr);
 		titleLen = memoLen = StrLen(memoStr);
 		tmpStr = StrStr(memoStr, kVarsTag);
 		if (tmpStr)
@@ -650,6 +1461,7 @@ static void EditViewSave (FormPtr frmP)
 	}
 
 	DmSet(memoStr, memoLen, 1, 0);
+	EditViewPersist(frmP);
 
 Cleanup:
 	if (exprH)
@@ -680,6 +1492,8 @@ Cleanup:
 			sSavedRecIndex = sCurrentRecIndex;
 		sCurrentRecIndex = dmMaxRecordIndex;
 	}
+	if (sEditorSavePolicy != editorDiscardMemo)
+		MemoCalcMemoSaved(sSavedRecIndex);
 	if (sVarsStrTbl)
 	{
 		while(sNVars)
@@ -716,7 +1530,6 @@ static void EditViewInit (FormPtr frmP)
 
 	if (!MathLibRef)
 	{
-		FrmHideObject(frmP, FrmGetObjectIndex(frmP, Bexp));
 		FrmHideObject(frmP, FrmGetObjectIndex(frmP, FunctionsTrigger));
 	}
 	else
@@ -916,6 +1729,7 @@ static Boolean EditViewHandleEvent (EventType * evtP)
 				case EvalButton:
 					frmP = FrmGetActiveForm();
 					EditViewEval(frmP);
+					EditViewPersist(frmP);
 					handled = true;
 				break;
 
@@ -1107,6 +1921,62 @@ static Boolean EditViewHandleEvent (EventType * evtP)
 					handled = true;
 					break;
 
+				case EditViewOptionsFixedMenu:
+					sEditorResultBase = resultBaseFixed;
+					frmP = FrmGetActiveForm();
+					EditViewEval(frmP);
+					handled = true;
+					break;
+
+				case EditViewOptionsGradientMenu:
+					MenuEraseStatus(NULL);
+					frmP = FrmGetActiveForm();
+					EditViewGradient(frmP);
+					handled = true;
+					break;
+
+				case EditViewOptionsGoalSeekMenu:
+					MenuEraseStatus(NULL);
+					frmP = FrmGetActiveForm();
+					EditViewGoalSeek(frmP);
+					handled = true;
+					break;
+
+				case EditViewOptionsMonteCarloMenu:
+					MenuEraseStatus(NULL);
+					frmP = FrmGetActiveForm();
+					EditViewMonteCarlo(frmP);
+					handled = true;
+					break;
+
+				case EditViewOptionsResultsMenu:
+					MenuEraseStatus(NULL);
+					frmP = FrmGetActiveForm();
+					EditViewResults(frmP);
+					handled = true;
+					break;
+
+				case EditViewOptionsStatsMenu:
+					MenuEraseStatus(NULL);
+					frmP = FrmGetActiveForm();
+					EditViewStats(frmP);
+					handled = true;
+					break;
+
+				case EditViewOptionsExportMenu:
+					MenuEraseStatus(NULL);
+					frmP = FrmGetActiveForm();
+					EditViewExport(frmP, 0);
+					handled = true;
+					break;
+
+				case EditViewOptionsExportInlineMenu:
+					MenuEraseStatus(NULL);
+					frmP = FrmGetActiveForm();
+					EditViewExport(frmP, exportInline);
+					handled = true;
+					break;
+
 			}
 		break;
 	}
@@ -1435,6 +2305,8 @@ static Boolean MemoViewHandleEvent (EventType * evtP)
 		case frmOpenEvent:
 			sCurrentRecIndex = sSavedRecIndex;
 			sMemoH = DmGetRecord(sMemoDB, sCurrentRecIndex);
+			sLibraryEdited = MemoCalcIsLibrary(MemHandleLock(sMemoH));
+			MemHandleUnlock(sMemoH);
 			frmP = FrmGetActiveForm();
 			fldP = FrmGetObjectPtr(frmP, FrmGetObjectIndex(frmP, MemoViewEditField));
 			FldSetTextHandle(fldP, sMemoH);
@@ -1450,6 +2322,7 @@ static Boolean MemoViewHandleEvent (EventType * evtP)
 			fldP = FrmGetObjectPtr(frmP, FrmGetObjectIndex(frmP, MemoViewEditField));
 			FldSetTextHandle(fldP, NULL);
 			DmReleaseRecord(sMemoDB, sCurrentRecIndex, true);
+			MemoCalcMemoSaved(sCurrentRecIndex);
 		break;
 
 		case fldChangedEvent:
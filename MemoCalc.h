@@ -79,3 +79,19 @@
 #define EditViewEditKeyboardMenu 79
 #define EditViewOptionsHexMenu 1001
 #define EditViewOptionsDecMenu 1002
+#define EditViewOptionsGradientMenu 1003
+#define EditViewOptionsGoalSeekMenu 1004
+#define EditViewOptionsMonteCarloMenu 1005
+#define EditViewOptionsStatsMenu 1006
+#define EditViewOptionsExportMenu 1007
+#define EditViewOptionsExportInlineMenu 1008
+#define EditViewOptionsFixedMenu 1009
+#define EditViewOptionsResultsMenu 1010
+#define InfoAlert 1100
+#define GoalSeekDialog 1200
+#define GoalSeekTargetLabel 1201
+#define GoalSeekTargetField 1202
+#define GoalSeekVarsLabel 1203
+#define GoalSeekVarsList 1204
+#define GoalSeekOkButton 1205
+#define GoalSeekCancelButton 1206
@@ -0,0 +1,769 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcBatch.c
+ * 
+ * DESCRIPTION : Column evaluation for MemoCalc. The expression tree is
+ *		walked once for a whole column of variable values, each node
+ *		running its operation in a tight loop over the rows. Columns
+ *		can also run in single precision for screening, with the rows
+ *		that need it evaluated again in double.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MathLib.h"
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcBatch.h"
+#include "MemoCalcDispatch.h"
+
+extern UInt16 MathLibRef;
+
+// globals
+static BatchStats sBatchStats;
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	RecurseBatchNode
+ *
+ * DESCRIPTION: Evaluates an expression tree over a column. The left
+ *		operand column is computed in place in valueP, the right one
+ *		in workP, which is then shifted by nRows for the next level.
+ *		Row errors are or'ed in errP, as in deferred evaluation mode a
+ *		non finite operand is only flagged where it could be absorbed.
+ *
+ * PARAMETERS:  Expression node, variable columns, number of rows,
+ *		value column, row errors, work area of (depth - 1) * nRows.
+ *
+ * RETURNED:	0 if no error, or an error common to all rows
+ *
+ ***********************************************************************/
+
+static UInt8 RecurseBatchNode (ExprNode * nodeP, double ** columnP, UInt16 nRows, double * valueP, UInt8 * errP, double * workP)
+{
+	double * rightP = workP;
+	double value;
+	UInt16 i;
+	UInt8 err = 0;
+
+	switch (nodeP->token)
+	{
+		case tNumber:
+		case tName:
+			if (nodeP->varP && columnP && columnP[nodeP->varP->index])
+			{
+				MemMove(valueP, columnP[nodeP->varP->index], nRows * sizeof(double));
+				break;
+			}
+			if (nodeP->varP)
+			{
+				value = nodeP->varP->value;
+				err |= nodeP->varP->defErr;
+			}
+			else if (nodeP->dataType & mValue)
+				value = nodeP->data.value;
+			else
+			{
+				err |= missingVarError;
+				break;
+			}
+			for (i = 0; i < nRows; i++)
+				valueP[i] = value;
+		break;
+
+		case '(':
+			if ((err |= RecurseBatchNode(nodeP->leftP, columnP, nRows, valueP, errP, workP))
+			|| !(nodeP->dataType & mFunction))
+				break;
+			if (nodeP->dataType != tFunction)
+			{
+				err |= missingFuncError;
+				break;
+			}
+			for (i = 0; i < nRows; i++)
+				if (isNonFinite(valueP[i]))
+					errP[i] |= mathError;
+			if (nodeP->data.funcRef.column && GetEvalDispatch()->level >= evalLevelColumn)
+				nodeP->data.funcRef.column(valueP, errP, nRows);
+			else
+				for (i = 0; i < nRows; i++)
+					if (!errP[i])
+						valueP[i] = nodeP->data.funcRef.func(valueP[i]);
+		break;
+
+		case '~':
+			if (err |= RecurseBatchNode(nodeP->rightP, columnP, nRows, valueP, errP, workP))
+				break;
+			for (i = 0; i < nRows; i++)
+			{
+				if (!errP[i])
+					errP[i] |= EvalBitwiseOp('~', 0, valueP[i], &valueP[i]);
+			}
+		break;
+
+		case tIntPower:
+			if (err |= RecurseBatchNode(nodeP->leftP, columnP, nRows, valueP, errP, workP))
+				break;
+			for (i = 0; i < nRows; i++)
+			{
+				if (isNonFinite(valueP[i]))
+					errP[i] |= mathError;
+				if (!errP[i])
+					valueP[i] = IntPower(valueP[i], (Int16)nodeP->data.value);
+			}
+		break;
+
+		case tMulAdd:
+		case tMulSub:
+			if ((err |= RecurseBatchNode(nodeP->leftP->leftP, columnP, nRows, valueP, errP, workP))
+			|| (err |= RecurseBatchNode(nodeP->leftP->rightP, columnP, nRows, rightP, errP, workP + nRows))
+			|| (err |= RecurseBatchNode(nodeP->rightP, columnP, nRows, workP + nRows, errP, workP + 2 * nRows)))
+				break;
+			if (nodeP->token == tMulAdd)
+				for (i = 0; i < nRows; i++)
+					valueP[i] = valueP[i] * rightP[i] + workP[nRows + i];
+			else
+				for (i = 0; i < nRows; i++)
+					valueP[i] = valueP[i] * rightP[i] - workP[nRows + i];
+		break;
+
+		default:
+			if ((err |= RecurseBatchNode(nodeP->leftP, columnP, nRows, valueP, errP, workP))
+			|| (err |= RecurseBatchNode(nodeP->rightP, columnP, nRows, rightP, errP, workP + nRows)))
+				break;
+			switch (nodeP->token)
+			{
+				case '+':
+					for (i = 0; i < nRows; i++)
+						valueP[i] += rightP[i];
+				break;
+
+				case '-':
+					for (i = 0; i < nRows; i++)
+						valueP[i] -= rightP[i];
+				break;
+
+				case '*':
+					for (i = 0; i < nRows; i++)
+						valueP[i] *= rightP[i];
+				break;
+
+				case '/':
+					for (i = 0; i < nRows; i++)
+					{
+						if (isNonFinite(rightP[i]))
+							errP[i] |= mathError;
+						valueP[i] /= rightP[i];
+					}
+				break;
+
+				case '&':
+				case '|':
+				case '^':
+					for (i = 0; i < nRows; i++)
+					{
+						if (isNonFinite(valueP[i]) || isNonFinite(rightP[i]))
+							errP[i] |= mathError;
+						if (errP[i])
+							continue;
+						if (nodeP->token != '^')
+							errP[i] |= EvalBitwiseOp(nodeP->token, valueP[i], rightP[i], &valueP[i]);
+						else if (isIntPower(rightP[i]))
+							valueP[i] = IntPower(valueP[i], (Int16)rightP[i]);
+						else if (!MathLibRef)
+							errP[i] |= missingFuncError;
+						else
+							valueP[i] = pow(valueP[i], rightP[i]);
+					}
+				break;
+			}
+	}
+
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	IntPowerSingle
+ *
+ * DESCRIPTION: IntPower in single precision
+ *
+ * PARAMETERS:  x, integral exponent
+ *
+ * RETURNED:	x ^ n
+ *
+ ***********************************************************************/
+
+static float IntPowerSingle (float x, Int16 n)
+{
+	float result = 1;
+	UInt16 m = n < 0 ? -n : n;
+
+	while (m)
+	{
+		if (m & 1)
+			result *= x;
+		m >>= 1;
+		if (m)
+			x *= x;
+	}
+	return n < 0 ? 1 / result : result;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	RecurseBatchSingle
+ *
+ * DESCRIPTION: RecurseBatchNode on float columns. The operators run in
+ *		single precision, functions and non integral powers call the
+ *		double MathLib functions and round their result.
+ *
+ * PARAMETERS:  Expression node, float variable columns, number of rows,
+ *		value column, row errors, work area of (depth - 1) * nRows.
+ *
+ * RETURNED:	0 if no error, or an error common to all rows
+ *
+ ***********************************************************************/
+
+static UInt8 RecurseBatchSingle (ExprNode * nodeP, float ** columnP, UInt16 nRows, float * valueP, UInt8 * errP, float * workP)
+{
+	float * rightP = workP;
+	float value;
+	double bitwise;
+	UInt16 i;
+	UInt8 err = 0;
+
+	switch (nodeP->token)
+	{
+		case tNumber:
+		case tName:
+			if (nodeP->varP && columnP[nodeP->varP->index])
+			{
+				MemMove(valueP, columnP[nodeP->varP->index], nRows * sizeof(float));
+				break;
+			}
+			if (nodeP->varP)
+			{
+				value = (float) nodeP->varP->value;
+				err |= nodeP->varP->defErr;
+			}
+			else if (nodeP->dataType & mValue)
+				value = (float) nodeP->data.value;
+			else
+			{
+				err |= missingVarError;
+				break;
+			}
+			for (i = 0; i < nRows; i++)
+				valueP[i] = value;
+		break;
+
+		case '(':
+			if ((err |= RecurseBatchSingle(nodeP->leftP, columnP, nRows, valueP, errP, workP))
+			|| !(nodeP->dataType & mFunction))
+				break;
+			if (nodeP->dataType != tFunction)
+			{
+				err |= missingFuncError;
+				break;
+			}
+			for (i = 0; i < nRows; i++)
+			{
+				if (isNonFinite(valueP[i]))
+					errP[i] |= mathError;
+				if (!errP[i])
+					valueP[i] = (float) nodeP->data.funcRef.func(valueP[i]);
+			}
+		break;
+
+		case '~':
+			if (err |= RecurseBatchSingle(nodeP->rightP, columnP, nRows, valueP, errP, workP))
+				break;
+			for (i = 0; i < nRows; i++)
+			{
+				if (!errP[i])
+					errP[i] |= EvalBitwiseOp('~', 0, valueP[i], &bitwise);
+				if (!errP[i])
+					valueP[i] = (float) bitwise;
+			}
+		break;
+
+		case tIntPower:
+			if (err |= RecurseBatchSingle(nodeP->leftP, columnP, nRows, valueP, errP, workP))
+				break;
+			for (i = 0; i < nRows; i++)
+			{
+				if (isNonFinite(valueP[i]))
+					errP[i] |= mathError;
+				if (!errP[i])
+					valueP[i] = IntPowerSingle(valueP[i], (Int16)nodeP->data.value);
+			}
+		break;
+
+		case tMulAdd:
+		case tMulSub:
+			if ((err |= RecurseBatchSingle(nodeP->leftP->leftP, columnP, nRows, valueP, errP, workP))
+			|| (err |= RecurseBatchSingle(nodeP->leftP->rightP, columnP, nRows, rightP, errP, workP + nRows))
+			|| (err |= RecurseBatchSingle(nodeP->rightP, columnP, nRows, workP + nRows, errP, workP + 2 * nRows)))
+				break;
+			if (nodeP->token == tMulAdd)
+				for (i = 0; i < nRows; i++)
+					valueP[i] = valueP[i] * rightP[i] + workP[nRows + i];
+			else
+				for (i = 0; i < nRows; i++)
+					valueP[i] = valueP[i] * rightP[i] - workP[nRows + i];
+		break;
+
+		default:
+			if ((err |= RecurseBatchSingle(nodeP->leftP, columnP, nRows, valueP, errP, workP))
+			|| (err |= RecurseBatchSingle(nodeP->rightP, columnP, nRows, rightP, errP, workP + nRows)))
+				break;
+			switch (nodeP->token)
+			{
+				case '+':
+					for (i = 0; i < nRows; i++)
+						valueP[i] += rightP[i];
+				break;
+
+				case '-':
+					for (i = 0; i < nRows; i++)
+						valueP[i] -= rightP[i];
+				break;
+
+				case '*':
+					for (i = 0; i < nRows; i++)
+						valueP[i] *= rightP[i];
+				break;
+
+				case '/':
+					for (i = 0; i < nRows; i++)
+					{
+						if (isNonFinite(rightP[i]))
+							errP[i] |= mathError;
+						valueP[i] /= rightP[i];
+					}
+				break;
+
+				case '&':
+				case '|':
+				case '^':
+					for (i = 0; i < nRows; i++)
+					{
+						if (isNonFinite(valueP[i]) || isNonFinite(rightP[i]))
+							errP[i] |= mathError;
+						if (errP[i])
+							continue;
+						if (nodeP->token != '^')
+						{
+							if (!(errP[i] |= EvalBitwiseOp(nodeP->token, valueP[i], rightP[i], &bitwise)))
+								valueP[i] = (float) bitwise;
+						}
+						else if (isIntPower(rightP[i]))
+							valueP[i] = IntPowerSingle(valueP[i], (Int16)rightP[i]);
+						else if (!MathLibRef)
+							errP[i] |= missingFuncError;
+						else
+							valueP[i] = (float) pow(valueP[i], rightP[i]);
+					}
+				break;
+			}
+	}
+
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ReadsBatchColumn
+ *
+ * DESCRIPTION: Tell if a subtree reads a variable given as a column
+ *
+ * PARAMETERS:  Expression node, columns indexed like the variables list
+ *
+ * RETURNED:	true if some leaf reads a column
+ *
+ ***********************************************************************/
+
+static Boolean ReadsBatchColumn (ExprNode * nodeP, double ** columnP)
+{
+	if (!nodeP)
+		return false;
+	if (nodeP->varP && columnP[nodeP->varP->index])
+		return true;
+	return ReadsBatchColumn(nodeP->leftP, columnP) || ReadsBatchColumn(nodeP->rightP, columnP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	DeleteBatchDefColumns
+ *
+ * DESCRIPTION: Free the definition columns of NewBatchDefColumns, the
+ *		variable columns are the caller's
+ *
+ * PARAMETERS:  Compiled expression, variable columns or NULL, columns
+ *		with the definitions
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void DeleteBatchDefColumns (CompiledExpr * compP, double ** columnP, double ** defColumnP)
+{
+	UInt16 j;
+
+	for (j = 0; j <= compP->varL.nVars; j++)
+		if (defColumnP[j] && !(columnP && columnP[j]))
+			MemPtrFree(defColumnP[j]);
+	MemPtrFree(defColumnP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	NewBatchDefColumns
+ *
+ * DESCRIPTION: Add the definitions the expression reads to the variable
+ *		columns. A definition reading a column is evaluated once per
+ *		row in a column of its own, with its row errors or'ed in errP,
+ *		the others are evaluated once in their cells.
+ *
+ * PARAMETERS:  Compiled expression, variable columns or NULL, number of
+ *		rows, row errors.
+ *
+ * RETURNED:	columns indexed like the variables list, to free with
+ *		DeleteBatchDefColumns, or NULL if out of memory
+ *
+ ***********************************************************************/
+
+static double ** NewBatchDefColumns (CompiledExpr * compP, double ** columnP, UInt16 nRows, UInt8 * errP)
+{
+	double ** defColumnP;
+	double * workP;
+	VarCell * varP;
+	UInt16 i, nVars = compP->varL.nVars + 1;
+	UInt8 err;
+
+	defColumnP = MemPtrNew(nVars * sizeof(double *));
+	if (!defColumnP)
+		return NULL;
+	MemSet(defColumnP, nVars * sizeof(double *), 0);
+	if (columnP)
+		MemMove(defColumnP, columnP, nVars * sizeof(double *));
+
+	EvalVarDefs(compP->exprT.defsP);
+	for (varP = compP->exprT.defsP; varP; varP = varP->nextEvalP)
+	{
+		if (defColumnP[varP->index] || !ReadsBatchColumn(varP->defTreeP, defColumnP))
+			continue;
+		workP = MemPtrNew(ExprNodeDepth(varP->defTreeP) * nRows * sizeof(double));
+		defColumnP[varP->index] = MemPtrNew(nRows * sizeof(double));
+		if (!workP || !defColumnP[varP->index])
+		{
+			if (workP)
+				MemPtrFree(workP);
+			DeleteBatchDefColumns(compP, columnP, defColumnP);
+			return NULL;
+		}
+		err = RecurseBatchNode(varP->defTreeP, defColumnP, nRows, defColumnP[varP->index], errP, workP);
+		MemPtrFree(workP);
+		for (i = 0; i < nRows && err; i++)
+			errP[i] |= err;
+	}
+	return defColumnP;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalExprBatch
+ *
+ * DESCRIPTION: Evaluates a compiled expression for a column of values
+ *		of some of its variables. Each row gives the same result and
+ *		error as EvalExprTree with these variables values. The
+ *		definitions reading a column are evaluated first, as columns.
+ *
+ * PARAMETERS:  Compiled expression, columns indexed like the variables
+ *		list, a NULL column keeps the variable value. Number of rows,
+ *		result column, row errors column.
+ *
+ * RETURNED:	bitwise or of the row errors
+ *
+ ***********************************************************************/
+
+UInt8 EvalExprBatch (CompiledExpr * compP, double ** columnP, UInt16 nRows, double * resultP, UInt8 * errP)
+{
+	double ** defColumnP = columnP;
+	double * workP;
+	UInt16 i;
+	UInt8 treeErr = 0, err = 0;
+
+	MemSet(errP, nRows, 0);
+	if (!compP->exprT.rootP)
+		treeErr = parseError;
+	else if (compP->exprT.defsP && !(defColumnP = NewBatchDefColumns(compP, columnP, nRows, errP)))
+		treeErr = memoryError;
+	else
+	{
+		workP = MemPtrNew(ExprNodeDepth(compP->exprT.rootP) * nRows * sizeof(double));
+		treeErr |= RecurseBatchNode(compP->exprT.rootP, defColumnP, nRows, resultP, errP, workP);
+		MemPtrFree(workP);
+		if (defColumnP != columnP)
+			DeleteBatchDefColumns(compP, columnP, defColumnP);
+	}
+
+	for (i = 0; i < nRows; i++)
+	{
+		if (!errP[i] && isNonFinite(resultP[i]))
+			errP[i] |= mathError;
+		errP[i] |= treeErr;
+		err |= errP[i];
+	}
+
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	RecheckRow
+ *
+ * DESCRIPTION: Tell whether a single precision row is to be evaluated
+ *		again in double. Errors other than math errors would be the
+ *		same in double.
+ *
+ * PARAMETERS:  batch options, row result, row error
+ *
+ * RETURNED:	true to evaluate the row in double
+ *
+ ***********************************************************************/
+
+static Boolean RecheckRow (BatchOptions * optP, double result, UInt8 err)
+{
+	double distance = result - optP->threshold;
+
+	if (optP->recheck & batchRecheckOverflow)
+	{
+		if (err)
+			return err == mathError;
+		if (isNonFinite(result) || result >= kBatchSingleMax || result <= -kBatchSingleMax)
+			return true;
+	}
+	if (optP->recheck & batchRecheckThreshold && !err)
+		return distance <= optP->band && distance >= -optP->band;
+	return false;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalExprBatchOptions
+ *
+ * DESCRIPTION: EvalExprBatch in the precision of the batch options. In
+ *		single precision the variable columns are rounded to float and
+ *		the rows flagged by the recheck options are gathered and
+ *		evaluated again in double, so that screening results close to
+ *		the float range or to the threshold are the double ones. The
+ *		definition columns are evaluated in double before rounding.
+ *
+ * PARAMETERS:  Compiled expression, columns indexed like the variables
+ *		list, number of rows, batch options, result column, row errors.
+ *
+ * RETURNED:	bitwise or of the row errors
+ *
+ ***********************************************************************/
+
+UInt8 EvalExprBatchOptions (CompiledExpr * compP, double ** columnP, UInt16 nRows, BatchOptions * optP, double * resultP, UInt8 * errP)
+{
+	float ** singleColumnP;
+	float * valueP, * workP;
+	double ** defColumnP = columnP;
+	double ** recheckColumnP;
+	double * recheckResultP;
+	UInt16 * rowP;
+	UInt8 * recheckErrP;
+	UInt16 nVars = compP->varL.nVars + 1;
+	UInt16 i, j, nRecheck = 0;
+	UInt8 treeErr = 0, err = 0;
+
+	if (optP->precision == batchDouble)
+		return EvalExprBatch(compP, columnP, nRows, resultP, errP);
+
+	MemSet(errP, nRows, 0);
+	if (!compP->exprT.rootP)
+		treeErr = parseError;
+	else if (compP->exprT.defsP && !(defColumnP = NewBatchDefColumns(compP, columnP, nRows, errP)))
+		treeErr = memoryError;
+	else
+	{
+		singleColumnP = MemPtrNew(nVars * sizeof(float *));
+		MemSet(singleColumnP, nVars * sizeof(float *), 0);
+		for (j = 0; j < nVars && defColumnP; j++)
+		{
+			if (!defColumnP[j])
+				continue;
+			singleColumnP[j] = MemPtrNew(nRows * sizeof(float));
+			for (i = 0; i < nRows; i++)
+				singleColumnP[j][i] = (float) defColumnP[j][i];
+		}
+		if (defColumnP != columnP)
+			DeleteBatchDefColumns(compP, columnP, defColumnP);
+		valueP = MemPtrNew(nRows * sizeof(float));
+		workP = MemPtrNew(ExprNodeDepth(compP->exprT.rootP) * nRows * sizeof(float));
+		treeErr |= RecurseBatchSingle(compP->exprT.rootP, singleColumnP, nRows, valueP, errP, workP);
+		for (i = 0; i < nRows; i++)
+			resultP[i] = valueP[i];
+		MemPtrFree(workP);
+		MemPtrFree(valueP);
+		for (j = 0; j < nVars; j++)
+			if (singleColumnP[j])
+				MemPtrFree(singleColumnP[j]);
+		MemPtrFree(singleColumnP);
+	}
+
+	for (i = 0; i < nRows; i++)
+		if (!errP[i] && isNonFinite(resultP[i]))
+			errP[i] |= mathError;
+	sBatchStats.nSingleRows += nRows;
+
+	if (!treeErr && optP->recheck)
+	{
+		rowP = MemPtrNew(nRows * sizeof(UInt16));
+		for (i = 0; i < nRows; i++)
+			if (RecheckRow(optP, resultP[i], errP[i]))
+				rowP[nRecheck++] = i;
+		if (nRecheck)
+		{
+			recheckColumnP = MemPtrNew(nVars * sizeof(double *));
+			MemSet(recheckColumnP, nVars * sizeof(double *), 0);
+			for (j = 0; j < nVars && columnP; j++)
+			{
+				if (!columnP[j])
+					continue;
+				recheckColumnP[j] = MemPtrNew(nRecheck * sizeof(double));
+				for (i = 0; i < nRecheck; i++)
+					recheckColumnP[j][i] = columnP[j][rowP[i]];
+			}
+			recheckResultP = MemPtrNew(nRecheck * sizeof(double));
+			recheckErrP = MemPtrNew(nRecheck);
+			EvalExprBatch(compP, recheckColumnP, nRecheck, recheckResultP, recheckErrP);
+			for (i = 0; i < nRecheck; i++)
+			{
+				resultP[rowP[i]] = recheckResultP[i];
+				errP[rowP[i]] = recheckErrP[i];
+			}
+			MemPtrFree(recheckErrP);
+			MemPtrFree(recheckResultP);
+			for (j = 0; j < nVars; j++)
+				if (recheckColumnP[j])
+					MemPtrFree(recheckColumnP[j]);
+			MemPtrFree(recheckColumnP);
+			sBatchStats.nRechecked += nRecheck;
+		}
+		MemPtrFree(rowP);
+	}
+
+	for (i = 0; i < nRows; i++)
+	{
+		errP[i] |= treeErr;
+		err |= errP[i];
+	}
+
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CompareBatchPrecision
+ *
+ * DESCRIPTION: Evaluate a column in double and in single precision
+ *		without recheck, and accumulate the error of the single
+ *		precision results against the double ones. The relative error
+ *		of a row is taken against max(|double result|, 1).
+ *
+ * PARAMETERS:  Compiled expression, columns indexed like the variables
+ *		list, number of rows, accumulated error
+ *
+ * RETURNED:	bitwise or of the double row errors
+ *
+ ***********************************************************************/
+
+UInt8 CompareBatchPrecision (CompiledExpr * compP, double ** columnP, UInt16 nRows, BatchError * errorP)
+{
+	BatchOptions opt;
+	double * doubleP, * singleP;
+	UInt8 * doubleErrP, * singleErrP;
+	double absError, magnitude;
+	UInt16 i;
+	UInt8 err = 0;
+
+	MemSet(&opt, sizeof(BatchOptions), 0);
+	opt.precision = batchSingle;
+	doubleP = MemPtrNew(nRows * sizeof(double));
+	singleP = MemPtrNew(nRows * sizeof(double));
+	doubleErrP = MemPtrNew(nRows);
+	singleErrP = MemPtrNew(nRows);
+
+	err |= EvalExprBatch(compP, columnP, nRows, doubleP, doubleErrP);
+	EvalExprBatchOptions(compP, columnP, nRows, &opt, singleP, singleErrP);
+
+	for (i = 0; i < nRows; i++)
+	{
+		if (doubleErrP[i] || singleErrP[i])
+		{
+			if (!doubleErrP[i] != !singleErrP[i])
+				errorP->nErrorDiffs++;
+			continue;
+		}
+		absError = singleP[i] - doubleP[i];
+		if (absError < 0)
+			absError = -absError;
+		magnitude = doubleP[i] < 0 ? -doubleP[i] : doubleP[i];
+		if (magnitude < 1)
+			magnitude = 1;
+		if (absError > errorP->maxAbsError)
+			errorP->maxAbsError = absError;
+		if (absError / magnitude > errorP->maxRelError)
+			errorP->maxRelError = absError / magnitude;
+		errorP->sumRelError += absError / magnitude;
+		errorP->nRows++;
+	}
+
+	MemPtrFree(singleErrP);
+	MemPtrFree(doubleErrP);
+	MemPtrFree(singleP);
+	MemPtrFree(doubleP);
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetBatchStats
+ *
+ * DESCRIPTION: Single precision rows and rows evaluated again in double
+ *		since started
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	batch stats
+ *
+ ***********************************************************************/
+
+BatchStats * GetBatchStats (void)
+{
+	return &sBatchStats;
+}
@@ -0,0 +1,57 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcBatch.h
+ * 
+ * DESCRIPTION : Column evaluation headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCBATCH_H
+#define MEMOCALCBATCH_H
+
+// batch precision
+
+#define batchDouble				0
+#define batchSingle				1		// float columns, functions rounded from double
+
+// rows of a single precision batch evaluated again in double
+
+#define batchRecheckOverflow	0x01	// non finite, or close to the float range
+#define batchRecheckThreshold	0x02	// within band of the threshold
+
+#define kBatchSingleMax			1.0e37	// an order of magnitude below FLT_MAX
+
+// structures
+
+typedef struct BatchOptions {
+	double threshold;		// screening threshold of batchRecheckThreshold
+	double band;			// distance to the threshold rechecked
+	UInt8 precision;
+	UInt8 recheck;
+} BatchOptions;
+
+typedef struct BatchStats {
+	UInt32 nSingleRows;		// rows evaluated in single precision
+	UInt32 nRechecked;		// of which evaluated again in double
+} BatchStats;
+
+typedef struct BatchError {
+	UInt32 nRows;			// rows evaluated without error in both precisions
+	UInt32 nErrorDiffs;		// rows with an error in only one precision
+	double maxAbsError;
+	double maxRelError;
+	double sumRelError;		// over nRows, for the mean relative error
+} BatchError;
+
+// functions
+
+UInt8 EvalExprBatch (CompiledExpr * compP, double ** columnP, UInt16 nRows, double * resultP, UInt8 * errP);
+UInt8 EvalExprBatchOptions (CompiledExpr * compP, double ** columnP, UInt16 nRows, BatchOptions * optP, double * resultP, UInt8 * errP);
+UInt8 CompareBatchPrecision (CompiledExpr * compP, double ** columnP, UInt16 nRows, BatchError * errorP);
+BatchStats * GetBatchStats (void);
+
+#endif // MEMOCALCBATCH_H
@@ -0,0 +1,472 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcBytecode.c
+ * 
+ * DESCRIPTION : Bytecode and tiered evaluation for MemoCalc. The tree
+ *		is flattened in postfix order into an array of operations run
+ *		on a value stack, without a function call per node, which the
+ *		fixed point evaluator also translates to its own operations. A
+ *		tiered expression is walked on the tree while it is cold, runs
+ *		its bytecode once warm, and is evaluated incrementally once hot.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MathLib.h"
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcIncremental.h"
+#include "MemoCalcBytecode.h"
+
+// globals
+static TierStats sTierStats;
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CountNodes
+ *
+ * DESCRIPTION: Number of nodes of a subtree, an upper bound of the
+ *		number of operations
+ *
+ * PARAMETERS:  node
+ *
+ * RETURNED:	nodes count
+ *
+ ***********************************************************************/
+
+static UInt16 CountNodes (ExprNode * nodeP)
+{
+	if (!nodeP)
+		return 0;
+	return 1 + CountNodes(nodeP->leftP) + CountNodes(nodeP->rightP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EmitOp
+ *
+ * DESCRIPTION: Append an operation and track the stack depth
+ *
+ * PARAMETERS:  bytecode, operation, stack depth change, current depth
+ *
+ * RETURNED:	new operation
+ *
+ ***********************************************************************/
+
+static ByteOp * EmitOp (Bytecode * codeP, UInt8 op, Int16 push, UInt16 * depthP)
+{
+	ByteOp * opP = codeP->opsP + codeP->nOps++;
+
+	MemSet(opP, sizeof(ByteOp), 0);
+	opP->op = op;
+	* depthP += push;
+	if (* depthP > codeP->stackSize)
+		codeP->stackSize = * depthP;
+	return opP;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CompileNode
+ *
+ * DESCRIPTION: Emit the operations of a subtree in postfix order,
+ *		which is the order the tree evaluates and checks its nodes.
+ *		Missing variables and functions are left to the tree.
+ *
+ * PARAMETERS:  node, bytecode, current stack depth
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+static UInt8 CompileNode (ExprNode * nodeP, Bytecode * codeP, UInt16 * depthP)
+{
+	ByteOp * opP;
+	UInt8 err = 0;
+
+	switch (nodeP->token)
+	{
+		case tNumber:
+		case tName:
+			if (nodeP->varP)
+				EmitOp(codeP, opVar, 1, depthP)->varP = nodeP->varP;
+			else if (nodeP->dataType & mValue)
+				EmitOp(codeP, opConst, 1, depthP)->value = nodeP->data.value;
+			else
+				err |= missingVarError;
+		break;
+
+		case '(':
+			if (nodeP->dataType & mFunction && nodeP->dataType != tFunction)
+				return missingFuncError;
+			err |= CompileNode(nodeP->leftP, codeP, depthP);
+			if (!err && nodeP->dataType & mFunction)
+				EmitOp(codeP, opFunc, 0, depthP)->func = nodeP->data.funcRef.func;
+		break;
+
+		case '~':
+			if (!(err |= CompileNode(nodeP->rightP, codeP, depthP)))
+				EmitOp(codeP, opNot, 0, depthP);
+		break;
+
+		case tIntPower:
+			if (!(err |= CompileNode(nodeP->leftP, codeP, depthP)))
+				EmitOp(codeP, opIntPow, 0, depthP)->n = (Int16)nodeP->data.value;
+		break;
+
+		case tMulAdd:
+		case tMulSub:
+			if (!((err |= CompileNode(nodeP->leftP->leftP, codeP, depthP))
+			|| (err |= CompileNode(nodeP->leftP->rightP, codeP, depthP))
+			|| (err |= CompileNode(nodeP->rightP, codeP, depthP))))
+				EmitOp(codeP, nodeP->token == tMulAdd ? opMulAdd : opMulSub, -2, depthP);
+		break;
+
+		default:
+			if ((err |= CompileNode(nodeP->leftP, codeP, depthP))
+			|| (err |= CompileNode(nodeP->rightP, codeP, depthP)))
+				break;
+			opP = EmitOp(codeP, opAdd, -1, depthP);
+			switch (nodeP->token)
+			{
+				case '+': opP->op = opAdd; break;
+				case '-': opP->op = opSub; break;
+				case '*': opP->op = opMul; break;
+				case '/': opP->op = opDiv; break;
+				case '&': opP->op = opAnd; break;
+				case '|': opP->op = opOr; break;
+				case '^': opP->op = opPow; break;
+				default: err |= parseError;
+			}
+	}
+
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CompileBytecode
+ *
+ * DESCRIPTION: Flatten an expression tree into bytecode
+ *
+ * PARAMETERS:  expression tree, bytecode
+ *
+ * RETURNED:	0 if no error, the bytecode is then to be deleted
+ *
+ ***********************************************************************/
+
+UInt8 CompileBytecode (ExprTree * exprT, Bytecode * codeP)
+{
+	UInt16 depth = 0;
+	UInt8 err = 0;
+
+	MemSet(codeP, sizeof(Bytecode), 0);
+	if (!exprT->rootP)
+		return parseError;
+
+	codeP->opsP = MemPtrNew(CountNodes(exprT->rootP) * sizeof(ByteOp));
+	err |= CompileNode(exprT->rootP, codeP, &depth);
+	if (err)
+	{
+		DeleteBytecode(codeP);
+		return err;
+	}
+	codeP->stackP = MemPtrNew(codeP->stackSize * sizeof(double));
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalBytecode
+ *
+ * DESCRIPTION: Run bytecode on its value stack. Results are checked
+ *		where the tree checks them in the current evaluation mode,
+ *		so the result and the error are the tree's. The definitions
+ *		read are to be evaluated before.
+ *
+ * PARAMETERS:  bytecode, result
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 EvalBytecode (Bytecode * codeP, double * resultP)
+{
+	ByteOp * opP = codeP->opsP, * endP = codeP->opsP + codeP->nOps;
+	double * topP = codeP->stackP - 1;
+	Boolean deferred = GetEvalMode() == evalCheckDeferred;
+	UInt8 err;
+
+	for (; opP < endP; opP++)
+	{
+		switch (opP->op)
+		{
+			case opConst:
+				* ++topP = opP->value;
+			break;
+
+			case opVar:
+				if (opP->varP->defErr)
+					return opP->varP->defErr;
+				* ++topP = opP->varP->value;
+			break;
+
+			case opAdd:
+				topP--;
+				topP[0] += topP[1];
+			break;
+
+			case opSub:
+				topP--;
+				topP[0] -= topP[1];
+			break;
+
+			case opMul:
+				topP--;
+				topP[0] *= topP[1];
+			break;
+
+			case opDiv:
+				topP--;
+				if (deferred && isNonFinite(topP[1]))
+					return mathError;
+				topP[0] /= topP[1];
+			break;
+
+			case opAnd:
+			case opOr:
+				topP--;
+				if ((err = EvalBitwiseOp(opP->op == opAnd ? '&' : '|', topP[0], topP[1], topP)) != 0)
+					return err;
+			break;
+
+			case opNot:
+				if ((err = EvalBitwiseOp('~', 0, topP[0], topP)) != 0)
+					return err;
+			break;
+
+			case opPow:
+				topP--;
+				if (deferred && (isNonFinite(topP[0]) || isNonFinite(topP[1])))
+					return mathError;
+				if (isIntPower(topP[1]))
+					topP[0] = IntPower(topP[0], (Int16)topP[1]);
+				else if (!MathLibRef)
+					return missingFuncError;
+				else
+					topP[0] = pow(topP[0], topP[1]);
+			break;
+
+			case opIntPow:
+				if (deferred && isNonFinite(topP[0]))
+					return mathError;
+				topP[0] = IntPower(topP[0], opP->n);
+			break;
+
+			case opMulAdd:
+				topP -= 2;
+				topP[0] = topP[0] * topP[1] + topP[2];
+			break;
+
+			case opMulSub:
+				topP -= 2;
+				topP[0] = topP[0] * topP[1] - topP[2];
+			break;
+
+			case opFunc:
+				if (deferred && isNonFinite(topP[0]))
+					return mathError;
+				topP[0] = opP->func(topP[0]);
+			break;
+		}
+		if (!deferred && isNonFinite(topP[0]))
+			return mathError;
+	}
+
+	* resultP = topP[0];
+	if (deferred && isNonFinite(* resultP))
+		return mathError;
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	DeleteBytecode
+ *
+ * DESCRIPTION: Free bytecode memory
+ *
+ * PARAMETERS:  bytecode
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void DeleteBytecode (Bytecode * codeP)
+{
+	if (codeP->opsP)
+		MemPtrFree(codeP->opsP);
+	if (codeP->stackP)
+		MemPtrFree(codeP->stackP);
+	MemSet(codeP, sizeof(Bytecode), 0);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ReadsIntLane
+ *
+ * DESCRIPTION: Whether a subtree evaluates integer results on 64 bits
+ *		from other integer results, which the bytecode would round to
+ *		doubles in between. A single typed operation of double
+ *		operands gives the same bits on both.
+ *
+ * PARAMETERS:  node
+ *
+ * RETURNED:	true if the subtree is to stay on the tree
+ *
+ ***********************************************************************/
+
+static Boolean ReadsIntLane (ExprNode * nodeP)
+{
+	if (!nodeP)
+		return false;
+	if (nodeP->dataType & mInteger
+	&& (nodeP->token == '+' || nodeP->token == '-'
+	|| (nodeP->leftP && nodeP->leftP->dataType & mInteger)
+	|| (nodeP->rightP && nodeP->rightP->dataType & mInteger)))
+		return true;
+	return ReadsIntLane(nodeP->leftP) || ReadsIntLane(nodeP->rightP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	InitTieredExpr
+ *
+ * DESCRIPTION: Start a compiled expression on the tree tier
+ *
+ * PARAMETERS:  tiered expression, compiled expression
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void InitTieredExpr (TieredExpr * tierP, CompiledExpr * compP)
+{
+	MemSet(tierP, sizeof(TieredExpr), 0);
+	tierP->compP = compP;
+	tierP->tier = tierTree;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalTieredExpr
+ *
+ * DESCRIPTION: Evaluate on the current tier, after moving up when the
+ *		expression gets warm, at kTierBytecodeEvals evaluations, or
+ *		hot, at kTierIncrEvals. Compiling costs about one tree walk,
+ *		so it is done in line at the threshold. Trees the bytecode
+ *		does not cover stay on the tree until hot. Native code is not
+ *		generated on the device: the hot tier evaluates again only the
+ *		nodes reading the variables changed since the last evaluation.
+ *
+ * PARAMETERS:  tiered expression, result
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 EvalTieredExpr (TieredExpr * tierP, double * resultP)
+{
+	ExprTree * exprT = &(tierP->compP->exprT);
+
+	tierP->nEvals++;
+	if (tierP->tier == tierTree && tierP->nEvals == kTierBytecodeEvals)
+	{
+		if (ReadsIntLane(exprT->rootP) || CompileBytecode(exprT, &(tierP->code)))
+			sTierStats.nTierFails++;
+		else
+		{
+			tierP->tier = tierBytecode;
+			sTierStats.nTierUps++;
+		}
+	}
+	else if (tierP->tier != tierIncremental && tierP->nEvals == kTierIncrEvals)
+	{
+		if (InitIncrExpr(tierP->compP, &(tierP->incr)))
+			sTierStats.nTierFails++;
+		else
+		{
+			DeleteBytecode(&(tierP->code));
+			tierP->tier = tierIncremental;
+			sTierStats.nTierUps++;
+		}
+	}
+
+	switch (tierP->tier)
+	{
+		case tierBytecode:
+			sTierStats.nBytecodeEvals++;
+			EvalVarDefs(exprT->defsP);
+			return EvalBytecode(&(tierP->code), resultP);
+
+		case tierIncremental:
+			sTierStats.nIncrEvals++;
+			return EvalIncrExpr(&(tierP->incr), resultP);
+	}
+	sTierStats.nTreeEvals++;
+	return EvalExprTree(exprT, resultP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	DeleteTieredExpr
+ *
+ * DESCRIPTION: Free the tiers, the compiled expression is kept
+ *
+ * PARAMETERS:  tiered expression
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void DeleteTieredExpr (TieredExpr * tierP)
+{
+	DeleteBytecode(&(tierP->code));
+	DeleteIncrExpr(&(tierP->incr));
+	tierP->tier = tierTree;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetTierStats
+ *
+ * DESCRIPTION: Evaluations per tier and tier changes since started
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	tier stats
+ *
+ ***********************************************************************/
+
+TierStats * GetTierStats (void)
+{
+	return &sTierStats;
+}
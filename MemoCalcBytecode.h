@@ -0,0 +1,85 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcBytecode.h
+ * 
+ * DESCRIPTION : Bytecode and tiered evaluation headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCBYTECODE_H
+#define MEMOCALCBYTECODE_H
+
+// bytecode operations
+
+#define opConst				0x00	// push value
+#define opVar				0x01	// push varP->value
+#define opAdd				0x02
+#define opSub				0x03
+#define opMul				0x04
+#define opDiv				0x05
+#define opAnd				0x06
+#define opOr				0x07
+#define opNot				0x08
+#define opPow				0x09
+#define opIntPow			0x0A	// top ^ n
+#define opMulAdd			0x0B	// a * b + c, c on top
+#define opMulSub			0x0C	// a * b - c, c on top
+#define opFunc				0x0D	// func(top)
+
+// execution tiers, from cold to hot
+
+#define tierTree			0		// walk the expression tree
+#define tierBytecode		1		// run the bytecode
+#define tierIncremental		2		// evaluate the nodes reading changed variables
+
+#define kTierBytecodeEvals	8		// evaluations on the tree before bytecode
+#define kTierIncrEvals		64		// evaluations before the incremental tier
+
+// structures
+
+typedef struct ByteOp {
+	double value;			// opConst value
+	VarCell * varP;			// opVar cell
+	FuncType * func;		// opFunc function
+	Int16 n;				// opIntPow exponent
+	UInt8 op;
+} ByteOp;
+
+typedef struct Bytecode {
+	ByteOp * opsP;
+	double * stackP;		// evaluation stack of stackSize values
+	UInt16 nOps;
+	UInt16 stackSize;		// values on the stack at most
+} Bytecode;
+
+typedef struct TieredExpr {
+	CompiledExpr * compP;
+	Bytecode code;
+	IncrExpr incr;
+	UInt32 nEvals;			// evaluations of this expression
+	UInt8 tier;
+} TieredExpr;
+
+typedef struct TierStats {
+	UInt32 nTreeEvals;
+	UInt32 nBytecodeEvals;
+	UInt32 nIncrEvals;
+	UInt16 nTierUps;
+	UInt16 nTierFails;		// expressions left on a colder tier
+} TierStats;
+
+// functions
+
+UInt8 CompileBytecode (ExprTree * exprT, Bytecode * codeP);
+UInt8 EvalBytecode (Bytecode * codeP, double * resultP);
+void DeleteBytecode (Bytecode * codeP);
+void InitTieredExpr (TieredExpr * tierP, CompiledExpr * compP);
+UInt8 EvalTieredExpr (TieredExpr * tierP, double * resultP);
+void DeleteTieredExpr (TieredExpr * tierP);
+TierStats * GetTierStats (void);
+
+#endif // MEMOCALCBYTECODE_H
@@ -0,0 +1,288 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcCache.c
+ * 
+ * DESCRIPTION : Evaluation results cache for MemoCalc. Eval looks up
+ *		a key hashed from the expression tokens and the variables
+ *		values before compiling, so the same memo with the same values
+ *		is only evaluated once. Results and errors are both cached, in
+ *		a small table whose least recently used entry is evicted. The
+ *		key of the intern table is hashed in the same pass.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcLibrary.h"
+#include "MemoCalcCache.h"
+
+// globals
+static EvalCacheEntry sEvalCache[kEvalCacheSize];
+static EvalCacheStats sEvalCacheStats;
+static UInt32 sEvalCacheClock;
+static Char * sLastExprStr;			// expression of the last tokens hashed
+static EvalKey sLastTokensKey;
+static UInt32 sLastSignature;
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	HashBytes
+ *
+ * DESCRIPTION: Add bytes to a key, FNV-1a for the hash and a shift-add
+ *		hash for the check, so that a false hit needs both to collide
+ *
+ * PARAMETERS:  key, bytes, number of bytes
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void HashBytes (EvalKey * keyP, const void * dataP, UInt16 len)
+{
+	const UInt8 * byteP = dataP;
+
+	keyP->hash = HashFnvBytes(keyP->hash, dataP, len);
+	keyP->len += len;
+	while (len--)
+		keyP->check = (keyP->check << 5) + keyP->check + * byteP++;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	HashTokens
+ *
+ * DESCRIPTION: Start a key with the token stream of an expression,
+ *		which leaves out separators, and the constants library if any.
+ *		The key of the last expression is kept, so evaluating the same
+ *		text again, as the editor does for each new value, compares it
+ *		instead of tokenizing it.
+ *
+ * PARAMETERS:  expression, key
+ *
+ * RETURNED:	0 if the expression tokenizes
+ *
+ ***********************************************************************/
+
+static UInt8 HashTokens (Char * exprStr, EvalKey * keyP)
+{
+	TokenList tokL;
+	TokenCell * tokP;
+	UInt32 signature = GetLibrarySignature();
+	UInt8 err = 0;
+
+	MemSet(keyP, sizeof(EvalKey), 0);
+	keyP->hash = kFnvOffset;
+	keyP->check = 5381;
+	if (!exprStr)
+		return parseError;
+	if (sLastExprStr && signature == sLastSignature && !StrCompare(exprStr, sLastExprStr))
+	{
+		* keyP = sLastTokensKey;
+		return 0;
+	}
+	if (signature)
+		HashBytes(keyP, &signature, sizeof(UInt32));
+
+	MemSet(&tokL, sizeof(TokenList), 0);
+	tokL.exprStr = exprStr;
+	if (TokenizeExpression(&tokL))
+		err |= parseError;
+	for (tokP = tokL.headP; tokP && !err; tokP = tokP->nextP)
+	{
+		HashBytes(keyP, &(tokP->token), 1);
+		if (tokP->token == tNumber || tokP->token == tName)
+			HashBytes(keyP, exprStr + tokP->data.indexPair.iStart,
+				tokP->data.indexPair.iEnd - tokP->data.indexPair.iStart + 1);
+	}
+	while (tokL.headP)
+	{
+		tokL.cellP = tokL.headP;
+		tokL.headP = tokL.headP->nextP;
+		MemPtrFree(tokL.cellP);
+	}
+
+	if (!err)
+	{
+		if (sLastExprStr)
+			MemPtrFree(sLastExprStr);
+		sLastExprStr = MemPtrNew(1 + StrLen(exprStr));
+		StrCopy(sLastExprStr, exprStr);
+		sLastTokensKey = * keyP;
+		sLastSignature = signature;
+	}
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MakeEvalKeys
+ *
+ * DESCRIPTION: Hash the token stream of an expression with the names
+ *		of the variables and their definitions, which decide what the
+ *		tree is, for the expression key. The results key goes on with
+ *		the evaluation mode and the values of the variables. The
+ *		expression is tokenized once for both. Expressions that do not
+ *		tokenize get no key.
+ *
+ * PARAMETERS:  expression, parsed variables list, expression key,
+ *		results key
+ *
+ * RETURNED:	0 if the keys can be used
+ *
+ ***********************************************************************/
+
+UInt8 MakeEvalKeys (Char * exprStr, VarList * varL, EvalKey * exprKeyP, EvalKey * evalKeyP)
+{
+	VarCell * varP;
+	UInt8 mode = GetEvalMode();
+	UInt8 err = 0;
+
+	err |= HashTokens(exprStr, exprKeyP);
+	if (err)
+		return err;
+	for (varP = varL->headP; varP; varP = varP->nextP)
+	{
+		HashBytes(exprKeyP, varP->name, StrLen(varP->name) + 1);
+		if (varP->defStr)
+			HashBytes(exprKeyP, varP->defStr, StrLen(varP->defStr) + 1);
+	}
+
+	* evalKeyP = * exprKeyP;
+	HashBytes(evalKeyP, &mode, 1);
+	for (varP = varL->headP; varP; varP = varP->nextP)
+	{
+		HashBytes(evalKeyP, &(varP->value), sizeof(double));
+		HashBytes(evalKeyP, &(varP->distType), 1);
+		if (varP->distType != distNone)
+		{
+			HashBytes(evalKeyP, &(varP->distA), sizeof(double));
+			HashBytes(evalKeyP, &(varP->distB), sizeof(double));
+		}
+	}
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	LookupEvalCache
+ *
+ * DESCRIPTION: Find a key in the cache, and count the hit or the miss
+ *
+ * PARAMETERS:  key, result, error
+ *
+ * RETURNED:	true if found, result and error are then set
+ *
+ ***********************************************************************/
+
+Boolean LookupEvalCache (EvalKey * keyP, double * resultP, UInt8 * errP)
+{
+	EvalCacheEntry * entryP;
+
+	for (entryP = sEvalCache; entryP < sEvalCache + kEvalCacheSize; entryP++)
+	{
+		if (entryP->used && entryP->key.hash == keyP->hash
+		&& entryP->key.check == keyP->check && entryP->key.len == keyP->len)
+		{
+			entryP->lastUse = ++sEvalCacheClock;
+			* resultP = entryP->result;
+			* errP = entryP->err;
+			sEvalCacheStats.nHits++;
+			return true;
+		}
+	}
+	sEvalCacheStats.nMisses++;
+	return false;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	StoreEvalCache
+ *
+ * DESCRIPTION: Store a result in a free entry, or in place of the least
+ *		recently used one
+ *
+ * PARAMETERS:  key, result, error
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void StoreEvalCache (EvalKey * keyP, double result, UInt8 err)
+{
+	EvalCacheEntry * entryP, * lruP = sEvalCache;
+
+	for (entryP = sEvalCache; entryP < sEvalCache + kEvalCacheSize; entryP++)
+	{
+		if (!entryP->used)
+		{
+			lruP = entryP;
+			break;
+		}
+		if (entryP->lastUse < lruP->lastUse)
+			lruP = entryP;
+	}
+	if (lruP->used)
+		sEvalCacheStats.nEvictions++;
+
+	lruP->key = * keyP;
+	lruP->result = result;
+	lruP->err = err;
+	lruP->lastUse = ++sEvalCacheClock;
+	lruP->used = true;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FlushEvalCache
+ *
+ * DESCRIPTION: Empty the cache, when results would no longer be the
+ *		same for the same keys, and forget the last expression. The
+ *		counters are kept.
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void FlushEvalCache (void)
+{
+	MemSet(sEvalCache, sizeof(sEvalCache), 0);
+	sEvalCacheClock = 0;
+	if (sLastExprStr)
+		MemPtrFree(sLastExprStr);
+	sLastExprStr = NULL;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetEvalCacheStats
+ *
+ * DESCRIPTION: Cache hits, misses and evictions since started
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	cache stats
+ *
+ ***********************************************************************/
+
+EvalCacheStats * GetEvalCacheStats (void)
+{
+	return &sEvalCacheStats;
+}
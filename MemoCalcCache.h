@@ -0,0 +1,50 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcCache.h
+ * 
+ * DESCRIPTION : Evaluation results cache headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCCACHE_H
+#define MEMOCALCCACHE_H
+
+// cache size
+
+#define kEvalCacheSize		16		// entries, the least recently used is evicted
+
+// structures
+
+typedef struct EvalKey {
+	UInt32 hash;			// FNV-1a of the tokens and variables
+	UInt32 check;			// second hash of the same bytes
+	UInt16 len;				// bytes hashed
+} EvalKey;
+
+typedef struct EvalCacheEntry {
+	EvalKey key;
+	double result;
+	UInt32 lastUse;			// cache clock at the last hit or store
+	UInt8 err;
+	Boolean used;
+} EvalCacheEntry;
+
+typedef struct EvalCacheStats {
+	UInt32 nHits;
+	UInt32 nMisses;
+	UInt32 nEvictions;
+} EvalCacheStats;
+
+// functions
+
+UInt8 MakeEvalKeys (Char * exprStr, VarList * varL, EvalKey * exprKeyP, EvalKey * evalKeyP);
+Boolean LookupEvalCache (EvalKey * keyP, double * resultP, UInt8 * errP);
+void StoreEvalCache (EvalKey * keyP, double result, UInt8 err);
+void FlushEvalCache (void);
+EvalCacheStats * GetEvalCacheStats (void);
+
+#endif // MEMOCALCCACHE_H
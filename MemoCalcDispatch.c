@@ -0,0 +1,81 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcDispatch.c
+ * 
+ * DESCRIPTION : Evaluation kernels selection for MemoCalc. The kernels
+ *		and batch sizes used by column evaluation are chosen once at
+ *		application start, from the processor and MathLib availability,
+ *		unless a level is forced for testing.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+
+#include "MemoCalcDispatch.h"
+
+extern UInt16 MathLibRef;
+
+// globals
+static EvalDispatch sDispatch = { 0, kBatchRowsMax, evalLevelColumn, false };
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SelectEvalDispatch
+ *
+ * DESCRIPTION: Select the evaluation level and batch size. Column
+ *		kernels need MathLib, batches are kept small on the early
+ *		DragonBall devices whose dynamic heap is the tightest. MathLib
+ *		must be open before this is called. A forced level is only
+ *		used if it is supported, unknown levels and column kernels
+ *		without MathLib are ignored.
+ *
+ * PARAMETERS:  evalLevelAuto, or a level to force
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void SelectEvalDispatch (UInt8 forcedLevel)
+{
+	UInt32 processorID = 0;
+
+	if (FtrGet(sysFtrCreator, sysFtrNumProcessorID, &processorID))
+		processorID = 0;
+	sDispatch.processorID = processorID;
+
+	if (sysFtrNumProcessorIsARM(processorID))
+		sDispatch.batchRows = kBatchRowsLarge;
+	else if ((processorID & sysFtrNumProcessorMask) >= sysFtrNumProcessorVZ)
+		sDispatch.batchRows = kBatchRowsMedium;
+	else
+		sDispatch.batchRows = kBatchRowsSmall;
+
+	sDispatch.level = MathLibRef ? evalLevelColumn : evalLevelScalar;
+	sDispatch.forced = (forcedLevel >= evalLevelScalar && forcedLevel <= sDispatch.level);
+	if (sDispatch.forced)
+		sDispatch.level = forcedLevel;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetEvalDispatch
+ *
+ * DESCRIPTION: Current evaluation level and batch size
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	selected dispatch
+ *
+ ***********************************************************************/
+
+EvalDispatch * GetEvalDispatch (void)
+{
+	return &sDispatch;
+}
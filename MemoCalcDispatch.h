@@ -0,0 +1,43 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcDispatch.h
+ * 
+ * DESCRIPTION : Evaluation kernels selection headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCDISPATCH_H
+#define MEMOCALCDISPATCH_H
+
+// evaluation levels
+
+#define evalLevelAuto		0	// select from the processor and MathLib
+#define evalLevelScalar		1	// function wrappers called value by value
+#define evalLevelColumn		2	// function column kernels
+
+// batch rows per column evaluation
+
+#define kBatchRowsSmall		16	// 68328 and EZ, small dynamic heap
+#define kBatchRowsMedium	32	// VZ and SuperVZ
+#define kBatchRowsLarge		64	// ARM
+#define kBatchRowsMax		kBatchRowsLarge
+
+// structures
+
+typedef struct EvalDispatch {
+	UInt32 processorID;		// sysFtrNumProcessorID feature value
+	UInt16 batchRows;		// rows per column evaluation
+	UInt8 level;			// selected evaluation level
+	UInt8 forced;			// true if the level was not selected from the hardware
+} EvalDispatch;
+
+// functions
+
+void SelectEvalDispatch (UInt8 forcedLevel);
+EvalDispatch * GetEvalDispatch (void);
+
+#endif // MEMOCALCDISPATCH_H
@@ -0,0 +1,507 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcExport.c
+ * 
+ * DESCRIPTION : C source export for MemoCalc. A compiled expression is
+ *		written as a standalone function double f(const double *vars),
+ *		or as an inline function to include from a header, for a
+ *		desktop C or C++ compiler to optimize. Constants are written as
+ *		hexadecimal literals so the exported function reads the same
+ *		bits as the tree. Compiled as C++14 or later, an inline function
+ *		without calls to libm is constexpr.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcExport.h"
+
+// structures
+typedef struct ExportBuf {
+	Char * bufP;		// NULL to only count the length
+	UInt32 len;
+	UInt8 flags;
+} ExportBuf;
+
+// globals
+static const Char hexDigits[] = "0123456789abcdef";
+
+static const Char exportIncludes[] =
+"#include <math.h>\n"
+"#include <stdint.h>\n"
+"\n";
+
+// same squaring sequence as IntPower, and same integral test for '^',
+// guarded for several exported headers in one compilation unit
+static const Char exportHelpers[] =
+"#ifndef MC_EXPORT_HELPERS\n"
+"#define MC_EXPORT_HELPERS\n"
+"\n"
+"#if defined(__cplusplus) && __cplusplus >= 201402L\n"
+"#define MC_CONSTEXPR constexpr\n"
+"#else\n"
+"#define MC_CONSTEXPR static inline\n"
+"#endif\n"
+"\n"
+"MC_CONSTEXPR double mc_ipow (double x, int n)\n"
+"{\n"
+"\tdouble result = 1;\n"
+"\tunsigned m = n < 0 ? -n : n;\n"
+"\n"
+"\twhile (m)\n"
+"\t{\n"
+"\t\tif (m & 1)\n"
+"\t\t\tresult *= x;\n"
+"\t\tm >>= 1;\n"
+"\t\tif (m)\n"
+"\t\t\tx *= x;\n"
+"\t}\n"
+"\treturn n < 0 ? 1 / result : result;\n"
+"}\n"
+"\n"
+"static inline double mc_pow (double x, double y)\n"
+"{\n"
+"\tif (y >= -64 && y <= 64 && y == (int16_t)y)\n"
+"\t\treturn mc_ipow(x, (int)y);\n"
+"\treturn pow(x, y);\n"
+"}\n"
+"\n"
+"#endif\n"
+"\n";
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ExportStr
+ *
+ * DESCRIPTION: Append a string to the export buffer
+ *
+ * PARAMETERS:  export buffer, null terminated string
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void ExportStr (ExportBuf * outP, const Char * str)
+{
+	UInt16 len = StrLen(str);
+
+	if (outP->bufP)
+		MemMove(outP->bufP + outP->len, str, len);
+	outP->len += len;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FormatHexDouble
+ *
+ * DESCRIPTION: Write a double as a C99 hexadecimal literal. The value
+ *		is scaled by powers of two and the mantissa read 4 bits at a
+ *		time, which is exact and does not need MathLib.
+ *
+ * PARAMETERS:  value, buffer of kExportNumBufSize chars
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void FormatHexDouble (double x, Char * bufP)
+{
+	Int16 exponent = 0;
+	UInt16 i;
+	UInt8 digit;
+	Boolean negative = x < 0;
+
+	if (x != x)
+	{
+		StrCopy(bufP, "NAN");
+		return;
+	}
+	if (x - x != 0)
+	{
+		StrCopy(bufP, x < 0 ? "(-HUGE_VAL)" : "HUGE_VAL");
+		return;
+	}
+	if (x == 0)
+	{
+		StrCopy(bufP, "0.0");
+		return;
+	}
+
+	if (negative)
+	{
+		* bufP++ = '(';
+		* bufP++ = '-';
+		x = -x;
+	}
+	while (x >= 2)
+	{
+		x /= 2;
+		exponent++;
+	}
+	while (x < 1 && exponent > -1022)
+	{
+		x *= 2;
+		exponent--;
+	}
+	* bufP++ = '0';
+	* bufP++ = 'x';
+	* bufP++ = x >= 1 ? '1' : '0';
+	* bufP++ = '.';
+	if (x >= 1)
+		x -= 1;
+	for (i = 0; i < 13; i++)
+	{
+		x *= 16;
+		digit = (UInt8) x;
+		x -= digit;
+		* bufP++ = hexDigits[digit];
+	}
+	StrPrintF(bufP, "p%d", exponent);
+	if (negative)
+		StrCat(bufP, ")");
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ExportNode
+ *
+ * DESCRIPTION: Write an expression subtree as a C expression, fully
+ *		parenthesized so the evaluation order is the tree's.
+ *
+ * PARAMETERS:  export buffer, node
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+static UInt8 ExportNode (ExportBuf * outP, ExprNode * nodeP)
+{
+	Char numBuf[kExportNumBufSize];
+	Char opBuf[2];
+	UInt8 err = 0;
+
+	switch (nodeP->token)
+	{
+		case tNumber:
+		case tName:
+			if (nodeP->varP && (outP->flags & exportInline || nodeP->varP->defTreeP))
+			{
+				ExportStr(outP, kExportVarPrefix);
+				ExportStr(outP, nodeP->varP->name);
+			}
+			else if (nodeP->varP)
+			{
+				StrPrintF(numBuf, "vars[%d]", nodeP->varP->index);
+				ExportStr(outP, numBuf);
+			}
+			else if (nodeP->dataType & mValue)
+			{
+				FormatHexDouble(nodeP->data.value, numBuf);
+				ExportStr(outP, numBuf);
+			}
+			else
+				err |= missingVarError;
+		break;
+
+		case '(':
+			if (nodeP->dataType & mFunction)
+			{
+				if (nodeP->dataType != tFunction)
+					return missingFuncError;
+				ExportStr(outP, nodeP->data.funcRef.name);
+			}
+			ExportStr(outP, "(");
+			err |= ExportNode(outP, nodeP->leftP);
+			ExportStr(outP, ")");
+		break;
+
+		case '&':
+		case '|':
+			ExportStr(outP, "((double) ((int64_t)");
+			err |= ExportNode(outP, nodeP->leftP);
+			ExportStr(outP, nodeP->token == '&' ? " & (int64_t)" : " | (int64_t)");
+			err |= ExportNode(outP, nodeP->rightP);
+			ExportStr(outP, "))");
+		break;
+
+		case '~':
+			ExportStr(outP, "((double) (~(int64_t)");
+			err |= ExportNode(outP, nodeP->rightP);
+			ExportStr(outP, "))");
+		break;
+
+		case '^':
+			ExportStr(outP, "mc_pow(");
+			err |= ExportNode(outP, nodeP->leftP);
+			ExportStr(outP, ", ");
+			err |= ExportNode(outP, nodeP->rightP);
+			ExportStr(outP, ")");
+		break;
+
+		case tIntPower:
+			ExportStr(outP, "mc_ipow(");
+			err |= ExportNode(outP, nodeP->leftP);
+			StrPrintF(numBuf, ", %d)", (Int16)nodeP->data.value);
+			ExportStr(outP, numBuf);
+		break;
+
+		case tMulAdd:
+		case tMulSub:
+			ExportStr(outP, "(");
+			err |= ExportNode(outP, nodeP->leftP);
+			ExportStr(outP, nodeP->token == tMulAdd ? " + " : " - ");
+			err |= ExportNode(outP, nodeP->rightP);
+			ExportStr(outP, ")");
+		break;
+
+		default:
+			opBuf[0] = nodeP->token;
+			opBuf[1] = 0;
+			ExportStr(outP, "(");
+			err |= ExportNode(outP, nodeP->leftP);
+			ExportStr(outP, " ");
+			ExportStr(outP, opBuf);
+			ExportStr(outP, " ");
+			err |= ExportNode(outP, nodeP->rightP);
+			ExportStr(outP, ")");
+		break;
+	}
+
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	IsConstexprNode
+ *
+ * DESCRIPTION: Tell if an exported subtree only uses arithmetic, the
+ *		bitwise operators and integral powers, which a C++ compiler can
+ *		evaluate at compile time. Functions and '^' call libm.
+ *
+ * PARAMETERS:  node
+ *
+ * RETURNED:	true if the exported C++ can be constexpr
+ *
+ ***********************************************************************/
+
+static Boolean IsConstexprNode (ExprNode * nodeP)
+{
+	if (!nodeP)
+		return true;
+	if ((nodeP->token == '(' && nodeP->dataType & mFunction) || nodeP->token == '^')
+		return false;
+	return IsConstexprNode(nodeP->leftP) && IsConstexprNode(nodeP->rightP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ExportFuncName
+ *
+ * DESCRIPTION: Make a C identifier from the first line of the title,
+ *		prefixed with kExportFuncPrefix so no title gives a keyword or
+ *		the name of a libm function. Each run of other chars than
+ *		letters and digits becomes one underscore. Without title the
+ *		function is kExportFuncName.
+ *
+ * PARAMETERS:  title or NULL, name buffer of kExportNameSize chars
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void ExportFuncName (Char * titleStr, Char * nameP)
+{
+	UInt16 prefixLen = StrLen(kExportFuncPrefix);
+	UInt16 len = prefixLen;
+	Char c;
+
+	StrCopy(nameP, kExportFuncPrefix);
+	while (titleStr && (c = * titleStr++) && c != '\n' && len < kExportNameSize - 1)
+	{
+		if (isLetter(c) || isNumber(c))
+			nameP[len++] = c;
+		else if (len > prefixLen && nameP[len - 1] != '_')
+			nameP[len++] = '_';
+	}
+	while (len > prefixLen && nameP[len - 1] == '_')
+		len--;
+	nameP[len] = nullChr;
+	if (len == prefixLen)
+		StrCopy(nameP, kExportFuncName);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ExportComment
+ *
+ * DESCRIPTION: Append the title inside the source comment. Each line
+ *		goes on a comment line of its own, and a star followed by a
+ *		slash is split so the title cannot close the comment.
+ *
+ * PARAMETERS:  export buffer, title
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void ExportComment (ExportBuf * outP, Char * titleStr)
+{
+	Char charBuf[2];
+
+	charBuf[1] = nullChr;
+	while ((charBuf[0] = * titleStr++) != nullChr)
+	{
+		if (charBuf[0] == '\n')
+			ExportStr(outP, "\n * ");
+		else if (charBuf[0] == '*' && * titleStr == '/')
+			ExportStr(outP, "* ");
+		else if (charBuf[0] != '\r')
+			ExportStr(outP, charBuf);
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ExportSource
+ *
+ * DESCRIPTION: Write the whole C source: a comment with the title and
+ *		the variables layout, the helpers and the exported function.
+ *		Inline functions take the variables as parameters, in the
+ *		order of the list, each prefixed with kExportVarPrefix so a
+ *		variable named int or sin stays a valid parameter. The
+ *		definitions are local constants with the same prefix, each
+ *		after the ones it reads.
+ *
+ * PARAMETERS:  export buffer, compiled expression, title or NULL
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+static UInt8 ExportSource (ExportBuf * outP, CompiledExpr * compP, Char * titleStr)
+{
+	Char numBuf[kExportNumBufSize];
+	Char nameBuf[kExportNameSize];
+	VarCell * varP;
+	Boolean isConstexpr, first = true;
+	UInt8 err = 0;
+
+	ExportStr(outP, "/* ");
+	ExportComment(outP, titleStr ? titleStr : "MemoCalc export");
+	ExportStr(outP, "\n");
+	for (varP = compP->varL.headP; varP; varP = varP->nextP)
+	{
+		if (varP->defStr)
+		{
+			ExportStr(outP, " * ");
+			ExportStr(outP, varP->name);
+			ExportStr(outP, " = ");
+			ExportComment(outP, varP->defStr);
+			ExportStr(outP, "\n");
+			continue;
+		}
+		StrPrintF(numBuf, " * vars[%d] ", varP->index);
+		ExportStr(outP, numBuf);
+		ExportStr(outP, varP->name);
+		ExportStr(outP, "\n");
+	}
+	ExportStr(outP, " */\n\n");
+	ExportStr(outP, exportIncludes);
+	ExportStr(outP, exportHelpers);
+
+	if (outP->flags & exportInline)
+	{
+		ExportFuncName(titleStr, nameBuf);
+		isConstexpr = IsConstexprNode(compP->exprT.rootP);
+		for (varP = compP->exprT.defsP; varP; varP = varP->nextEvalP)
+			isConstexpr = isConstexpr && IsConstexprNode(varP->defTreeP);
+		ExportStr(outP, isConstexpr ? "MC_CONSTEXPR double " : "static inline double ");
+		ExportStr(outP, nameBuf);
+		ExportStr(outP, " (");
+		for (varP = compP->varL.headP; varP; varP = varP->nextP)
+		{
+			if (varP->defStr)
+				continue;
+			if (!first)
+				ExportStr(outP, ", ");
+			ExportStr(outP, "double " kExportVarPrefix);
+			ExportStr(outP, varP->name);
+			first = false;
+		}
+		ExportStr(outP, first ? "void)\n{\n" : ")\n{\n");
+	}
+	else
+		ExportStr(outP, "double " kExportFuncName " (const double *vars)\n{\n");
+	for (varP = compP->exprT.defsP; varP; varP = varP->nextEvalP)
+	{
+		ExportStr(outP, "\tconst double " kExportVarPrefix);
+		ExportStr(outP, varP->name);
+		ExportStr(outP, " = ");
+		err |= ExportNode(outP, varP->defTreeP);
+		ExportStr(outP, ";\n");
+	}
+	ExportStr(outP, "\treturn ");
+	err |= ExportNode(outP, compP->exprT.rootP);
+	ExportStr(outP, ";\n}\n");
+
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ExportExprC
+ *
+ * DESCRIPTION: Export a compiled expression as C source. vars[i] holds
+ *		the value of the variable of index i, or with exportInline the
+ *		function is named after the title and takes the variables as
+ *		parameters, so a compiler folds it where they are constant.
+ *		The exported function returns NaN or Inf where the tree would
+ *		report a math error.
+ *
+ * PARAMETERS:  compiled expression, title or NULL, export flags,
+ *		returned source string to free with MemPtrFree
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 ExportExprC (CompiledExpr * compP, Char * titleStr, UInt8 flags, Char ** srcStrP)
+{
+	ExportBuf out;
+	UInt8 err = 0;
+
+	* srcStrP = NULL;
+	if (!compP->exprT.rootP)
+		return parseError;
+
+	MemSet(&out, sizeof(ExportBuf), 0);
+	out.flags = flags;
+	err |= ExportSource(&out, compP, titleStr);
+	if (err)
+		return err;
+
+	out.bufP = MemPtrNew(out.len + 1);
+	out.len = 0;
+	ExportSource(&out, compP, titleStr);
+	out.bufP[out.len] = 0;
+	* srcStrP = out.bufP;
+
+	return 0;
+}
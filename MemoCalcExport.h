@@ -0,0 +1,32 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcExport.h
+ * 
+ * DESCRIPTION : C source export headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCEXPORT_H
+#define MEMOCALCEXPORT_H
+
+// export flags
+
+#define exportInline		0x01	// static inline function of one parameter per variable
+
+// exported function
+
+#define kExportFuncName		"f"		// double f(const double *vars)
+#define kExportFuncPrefix	"memo_"	// inline function named memo_<title>
+#define kExportVarPrefix	"v_"	// inline function parameter v_<variable>
+#define kExportNumBufSize	32		// hexadecimal double literal
+#define kExportNameSize		32		// function name taken from the title
+
+// functions
+
+UInt8 ExportExprC (CompiledExpr * compP, Char * titleStr, UInt8 flags, Char ** srcStrP);
+
+#endif // MEMOCALCEXPORT_H
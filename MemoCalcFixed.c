@@ -0,0 +1,549 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcFixed.c
+ * 
+ * DESCRIPTION : Fixed point evaluation for MemoCalc. Values are 64 bit
+ *		integers scaled by 10^scale, so devices without a floating
+ *		point unit evaluate with integer instructions instead of the
+ *		soft float library. The expression is flattened as bytecode,
+ *		constants are scaled once when compiled, and variables when
+ *		their value changes. Products and quotients are rounded to the
+ *		nearest, and results out of range either saturate or fail.
+ *		Functions other than powers are left to the double engines.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcIncremental.h"
+#include "MemoCalcBytecode.h"
+#include "MemoCalcFixed.h"
+
+#define kFixedMax		((Int64Value)0x7FFFFFFFFFFFFFFFLL)
+#define kFixedMin		(-kFixedMax - 1)
+#define kFixedMaxDouble	9.2233720368547748e18	// 2^63, first double out of range
+#define kFixedMaxPower	64						// exponents of opPow taken as integral
+#define kFixedGuardBits	16						// extra bits of the powers intermediates
+
+#define fixedAbs(x)		((x) < 0 ? (UInt64Value)0 - (UInt64Value)(x) : (UInt64Value)(x))
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	DoubleToFixed
+ *
+ * DESCRIPTION: Scale a double, rounded to the nearest. A value out of
+ *		range is clamped with fixedSaturate, as an operation result.
+ *
+ * PARAMETERS:  fixed expression, value, result
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+static UInt8 DoubleToFixed (FixedExpr * fixP, double x, Int64Value * resultP)
+{
+	x *= (double) fixP->one;
+	if (x != x)
+		return mathError;
+	x = x < 0 ? x - 0.5 : x + 0.5;
+	if (x >= kFixedMaxDouble || x <= -kFixedMaxDouble)
+	{
+		if (!(fixP->flags & fixedSaturate))
+			return overflowError;
+		fixP->nOverflows++;
+		* resultP = x < 0 ? kFixedMin : kFixedMax;
+		return 0;
+	}
+	* resultP = (Int64Value) x;
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FixedAdd
+ *
+ * DESCRIPTION: a + b or a - b, clamped to the largest value of the
+ *		sign of the exact result on overflow
+ *
+ * PARAMETERS:  a, b, true to subtract, result
+ *
+ * RETURNED:	false if the result is out of range
+ *
+ ***********************************************************************/
+
+static Boolean FixedAdd (Int64Value a, Int64Value b, Boolean subtract, Int64Value * resultP)
+{
+	Int64Value r;
+
+	r = (Int64Value) (subtract ? (UInt64Value)a - (UInt64Value)b : (UInt64Value)a + (UInt64Value)b);
+	if ((subtract ? (a < 0) != (b < 0) : (a < 0) == (b < 0)) && (r < 0) != (a < 0))
+	{
+		* resultP = a < 0 ? kFixedMin : kFixedMax;
+		return false;
+	}
+	* resultP = r;
+	return true;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MulDiv
+ *
+ * DESCRIPTION: a * b / c rounded half away from zero, with a 128 bit
+ *		intermediate product. Operands under 2^31, which is most values
+ *		at the default scale, take a single 64 bit multiply.
+ *
+ * PARAMETERS:  a, b, c not null, result
+ *
+ * RETURNED:	false if the result is out of range
+ *
+ ***********************************************************************/
+
+static Boolean MulDiv (Int64Value a, Int64Value b, Int64Value c, Int64Value * resultP)
+{
+	UInt64Value ua = fixedAbs(a), ub = fixedAbs(b), uc = fixedAbs(c);
+	UInt64Value hi = 0, lo, mid, q, r;
+	Boolean negative = (a < 0) != (b < 0) ? (c > 0) : (c < 0);
+	Int16 i;
+
+	if (ua <= 0x7FFFFFFFL && ub <= 0x7FFFFFFFL)
+		lo = ua * ub;
+	else
+	{
+		lo = (ua & 0xFFFFFFFFL) * (ub & 0xFFFFFFFFL);
+		mid = (ua >> 32) * (ub & 0xFFFFFFFFL) + (lo >> 32);
+		hi = mid >> 32;
+		mid = (mid & 0xFFFFFFFFL) + (ua & 0xFFFFFFFFL) * (ub >> 32);
+		hi += (mid >> 32) + (ua >> 32) * (ub >> 32);
+		lo = (mid << 32) | (lo & 0xFFFFFFFFL);
+	}
+
+	if (hi >= uc)
+		return false;
+	if (!hi)
+	{
+		q = lo / uc;
+		r = lo % uc;
+	}
+	else
+	{
+		// r < uc <= 2^63 never loses its top bit
+		q = 0;
+		r = hi;
+		for (i = 63; i >= 0; i--)
+		{
+			r = (r << 1) | ((lo >> i) & 1);
+			q <<= 1;
+			if (r >= uc)
+			{
+				r -= uc;
+				q |= 1;
+			}
+		}
+	}
+	if (r >= uc - r)
+		q++;
+
+	if (q > (UInt64Value)kFixedMax + negative)
+		return false;
+	* resultP = (Int64Value) (negative ? (UInt64Value)0 - q : q);
+	return true;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ScaledIntPower
+ *
+ * DESCRIPTION: Same squaring sequence as IntPower on values scaled by
+ *		scale, negative exponents taking the inverse of the result
+ *
+ * PARAMETERS:  scale, x, n, result
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+static UInt8 ScaledIntPower (Int64Value scale, Int64Value x, Int16 n, Int64Value * resultP)
+{
+	Int64Value result = scale;
+	UInt16 m = n < 0 ? -n : n;
+
+	while (m)
+	{
+		if (m & 1 && !MulDiv(result, x, scale, &result))
+			return overflowError;
+		m >>= 1;
+		if (m && !MulDiv(x, x, scale, &x))
+			return overflowError;
+	}
+	if (n < 0)
+	{
+		if (!result)
+			return mathError;
+		if (!MulDiv(scale, scale, result, &result))
+			return overflowError;
+	}
+	* resultP = result;
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FixedIntPower
+ *
+ * DESCRIPTION: x^n with kFixedGuardBits more bits than the scale kept
+ *		through the squarings, so the result is rounded to the scale
+ *		once instead of at every multiply. When the guarded values
+ *		overflow, fewer guard bits are tried, down to none.
+ *
+ * PARAMETERS:  fixed expression, x, n, result
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+static UInt8 FixedIntPower (FixedExpr * fixP, Int64Value x, Int16 n, Int64Value * resultP)
+{
+	Int64Value guarded;
+	Int16 bits;
+	UInt8 err = 0;
+
+	for (bits = kFixedGuardBits; bits; bits >>= 1)
+	{
+		if (fixedAbs(x) >= ((UInt64Value)1 << (62 - bits)) || fixP->one >= ((Int64Value)1 << (62 - bits)))
+			continue;
+		err = ScaledIntPower(fixP->one << bits, x * ((Int64Value)1 << bits), n, &guarded);
+		if (err == mathError)
+			return err;
+		if (!err && MulDiv(guarded, 1, (Int64Value)1 << bits, resultP))
+			return 0;
+	}
+	return ScaledIntPower(fixP->one, x, n, resultP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FixedIntPart
+ *
+ * DESCRIPTION: Integer part of a scaled value as the bitwise operators
+ *		see it, truncated toward zero like the double to integer cast
+ *
+ * PARAMETERS:  fixed expression, value
+ *
+ * RETURNED:	integer part
+ *
+ ***********************************************************************/
+
+static Int64Value FixedIntPart (FixedExpr * fixP, Int64Value x)
+{
+	return x / fixP->one;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CompileFixedExpr
+ *
+ * DESCRIPTION: Compile an expression for fixed point evaluation. Any
+ *		function call, or a definition read, gives missingFuncError,
+ *		to evaluate in double.
+ *
+ * PARAMETERS:  compiled expression, decimal scale, fixed point flags,
+ *		fixed expression
+ *
+ * RETURNED:	0 if no error, the fixed expression is then to be deleted
+ *
+ ***********************************************************************/
+
+UInt8 CompileFixedExpr (CompiledExpr * compP, UInt8 scale, UInt8 flags, FixedExpr * fixP)
+{
+	Bytecode code;
+	FixedOp * opP;
+	UInt16 i, nVars = compP->varL.nVars + 1;
+	UInt8 err = 0;
+
+	MemSet(fixP, sizeof(FixedExpr), 0);
+	if (scale > kFixedMaxScale)
+		scale = kFixedMaxScale;
+	fixP->scale = scale;
+	fixP->flags = flags;
+	for (fixP->one = 1; scale; scale--)
+		fixP->one *= 10;
+	if (compP->exprT.defsP)
+		return missingFuncError;
+
+	err |= CompileBytecode(&(compP->exprT), &code);
+	if (err)
+		return err;
+
+	fixP->opsP = MemPtrNew(code.nOps * sizeof(FixedOp));
+	fixP->nOps = code.nOps;
+	for (i = 0; i < code.nOps && !err; i++)
+	{
+		opP = fixP->opsP + i;
+		MemSet(opP, sizeof(FixedOp), 0);
+		opP->op = code.opsP[i].op;
+		opP->varP = code.opsP[i].varP;
+		opP->n = code.opsP[i].n;
+		if (opP->op == opFunc)
+			err |= missingFuncError;
+		else if (opP->op == opConst)
+			err |= DoubleToFixed(fixP, code.opsP[i].value, &(opP->value));
+	}
+	fixP->stackP = MemPtrNew(code.stackSize * sizeof(Int64Value));
+	DeleteBytecode(&code);
+
+	fixP->varValueP = MemPtrNew(nVars * sizeof(double));
+	fixP->varFixedP = MemPtrNew(nVars * sizeof(Int64Value));
+	fixP->varCachedP = MemPtrNew(nVars * sizeof(Boolean));
+	MemSet(fixP->varCachedP, nVars * sizeof(Boolean), 0);
+
+	if (err)
+		DeleteFixedExpr(fixP);
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalFixedExpr
+ *
+ * DESCRIPTION: Run a fixed point expression. With fixedSaturate an
+ *		overflow clamps the operation to the largest value of its sign
+ *		and is counted in nOverflows, else it is an overflowError.
+ *		Division by zero is a mathError either way.
+ *
+ * PARAMETERS:  fixed expression, scaled result
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 EvalFixedExpr (FixedExpr * fixP, Int64Value * resultP)
+{
+	FixedOp * opP = fixP->opsP, * endP = fixP->opsP + fixP->nOps;
+	Int64Value * topP = fixP->stackP - 1;
+	Int64Value a, b;
+	VarCell * varP;
+	Boolean overflow;
+	UInt8 err = 0;
+
+	for (; opP < endP; opP++)
+	{
+		overflow = false;
+		switch (opP->op)
+		{
+			case opConst:
+				* ++topP = opP->value;
+			break;
+
+			case opVar:
+				varP = opP->varP;
+				if (!fixP->varCachedP[varP->index] || fixP->varValueP[varP->index] != varP->value)
+				{
+					err |= DoubleToFixed(fixP, varP->value, fixP->varFixedP + varP->index);
+					if (err)
+						return err;
+					fixP->varValueP[varP->index] = varP->value;
+					fixP->varCachedP[varP->index] = true;
+				}
+				* ++topP = fixP->varFixedP[varP->index];
+			break;
+
+			case opAdd:
+			case opSub:
+				topP--;
+				overflow = !FixedAdd(topP[0], topP[1], opP->op == opSub, topP);
+			break;
+
+			case opMul:
+				topP--;
+				a = topP[0];
+				overflow = !MulDiv(a, topP[1], fixP->one, topP);
+				if (overflow)
+					topP[0] = (a < 0) != (topP[1] < 0) ? kFixedMin : kFixedMax;
+			break;
+
+			case opDiv:
+				topP--;
+				if (!topP[1])
+					return mathError;
+				a = topP[0];
+				overflow = !MulDiv(a, fixP->one, topP[1], topP);
+				if (overflow)
+					topP[0] = (a < 0) != (topP[1] < 0) ? kFixedMin : kFixedMax;
+			break;
+
+			case opAnd:
+			case opOr:
+				topP--;
+				a = FixedIntPart(fixP, topP[0]);
+				b = FixedIntPart(fixP, topP[1]);
+				a = opP->op == opAnd ? a & b : a | b;
+				overflow = !MulDiv(a, fixP->one, 1, topP);
+				if (overflow)
+					topP[0] = a < 0 ? kFixedMin : kFixedMax;
+			break;
+
+			case opNot:
+				a = ~FixedIntPart(fixP, topP[0]);
+				overflow = !MulDiv(a, fixP->one, 1, topP);
+				if (overflow)
+					topP[0] = a < 0 ? kFixedMin : kFixedMax;
+			break;
+
+			case opPow:
+				topP--;
+				b = FixedIntPart(fixP, topP[1]);
+				if (topP[1] % fixP->one || b < -kFixedMaxPower || b > kFixedMaxPower)
+					return missingFuncError;
+				a = topP[0];
+				err |= FixedIntPower(fixP, a, (Int16) b, topP);
+				overflow = err == overflowError;
+				if (overflow)
+					topP[0] = a < 0 && b & 1 ? kFixedMin : kFixedMax;
+			break;
+
+			case opIntPow:
+				a = topP[0];
+				err |= FixedIntPower(fixP, a, opP->n, topP);
+				overflow = err == overflowError;
+				if (overflow)
+					topP[0] = a < 0 && opP->n & 1 ? kFixedMin : kFixedMax;
+			break;
+
+			case opMulAdd:
+			case opMulSub:
+				topP -= 2;
+				a = topP[0];
+				overflow = !MulDiv(a, topP[1], fixP->one, topP);
+				if (overflow)
+					topP[0] = (a < 0) != (topP[1] < 0) ? kFixedMin : kFixedMax;
+				else
+					overflow = !FixedAdd(topP[0], topP[2], opP->op == opMulSub, topP);
+			break;
+
+			default:
+				return missingFuncError;
+		}
+		if (err & ~overflowError)
+			return err;
+		err = 0;
+		if (overflow)
+		{
+			if (!(fixP->flags & fixedSaturate))
+				return overflowError;
+			fixP->nOverflows++;
+		}
+	}
+
+	* resultP = topP[0];
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FixedToDouble
+ *
+ * DESCRIPTION: Scaled value as a double
+ *
+ * PARAMETERS:  fixed expression, scaled value
+ *
+ * RETURNED:	value
+ *
+ ***********************************************************************/
+
+double FixedToDouble (FixedExpr * fixP, Int64Value value)
+{
+	return (double) value / (double) fixP->one;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FixedToA
+ *
+ * DESCRIPTION: Format a scaled value in decimal with integer arithmetic
+ *		only, trailing zero decimals removed
+ *
+ * PARAMETERS:  fixed expression, scaled value, buffer of kFixedBufSize
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void FixedToA (FixedExpr * fixP, Int64Value value, Char * bufP)
+{
+	Char digits[kFixedBufSize];
+	UInt64Value u = fixedAbs(value);
+	UInt64Value intPart = u / fixP->one, fracPart = u % fixP->one;
+	Int16 i, n = 0, nFrac = fixP->scale;
+
+	while (nFrac && !(fracPart % 10))
+	{
+		fracPart /= 10;
+		nFrac--;
+	}
+
+	for (i = 0; i < nFrac; i++)
+	{
+		digits[n++] = '0' + (Char) (fracPart % 10);
+		fracPart /= 10;
+	}
+	if (nFrac)
+		digits[n++] = '.';
+	do {
+		digits[n++] = '0' + (Char) (intPart % 10);
+		intPart /= 10;
+	} while (intPart);
+
+	if (value < 0)
+		* bufP++ = '-';
+	while (n)
+		* bufP++ = digits[--n];
+	* bufP = nullChr;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	DeleteFixedExpr
+ *
+ * DESCRIPTION: Free fixed expression memory
+ *
+ * PARAMETERS:  fixed expression
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void DeleteFixedExpr (FixedExpr * fixP)
+{
+	if (fixP->opsP)
+		MemPtrFree(fixP->opsP);
+	if (fixP->stackP)
+		MemPtrFree(fixP->stackP);
+	if (fixP->varValueP)
+		MemPtrFree(fixP->varValueP);
+	if (fixP->varFixedP)
+		MemPtrFree(fixP->varFixedP);
+	if (fixP->varCachedP)
+		MemPtrFree(fixP->varCachedP);
+	MemSet(fixP, sizeof(FixedExpr), 0);
+}
@@ -0,0 +1,56 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcFixed.h
+ * 
+ * DESCRIPTION : Fixed point evaluation headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCFIXED_H
+#define MEMOCALCFIXED_H
+
+// fixed point flags
+
+#define fixedSaturate		0x01	// clamp overflows to the largest value instead of failing
+
+// decimal scale, 10^scale must fit in 32 bits
+
+#define kFixedMaxScale		9
+#define kFixedDefaultScale	8
+#define kFixedBufSize		24		// sign, 19 digits, point, null char
+
+// structures
+
+typedef struct FixedOp {
+	Int64Value value;		// opConst value, scaled
+	VarCell * varP;			// opVar cell
+	Int16 n;				// opIntPow exponent
+	UInt8 op;				// bytecode operation
+} FixedOp;
+
+typedef struct FixedExpr {
+	FixedOp * opsP;
+	Int64Value * stackP;
+	double * varValueP;		// variable values last converted, by index
+	Int64Value * varFixedP;	// and their scaled values
+	Boolean * varCachedP;
+	Int64Value one;			// 10^scale
+	UInt32 nOverflows;		// saturated results since compiled
+	UInt16 nOps;
+	UInt8 scale;
+	UInt8 flags;
+} FixedExpr;
+
+// functions
+
+UInt8 CompileFixedExpr (CompiledExpr * compP, UInt8 scale, UInt8 flags, FixedExpr * fixP);
+UInt8 EvalFixedExpr (FixedExpr * fixP, Int64Value * resultP);
+double FixedToDouble (FixedExpr * fixP, Int64Value value);
+void FixedToA (FixedExpr * fixP, Int64Value value, Char * bufP);
+void DeleteFixedExpr (FixedExpr * fixP);
+
+#endif // MEMOCALCFIXED_H
@@ -17,6 +17,8 @@
 
 extern UInt16 MathLibRef;
 
+#define kMinNormal			2.2250738585072014e-308	// smallest normal double
+
 /***********************************************************************
  *
  *	Function names and references at the same indices
@@ -85,6 +87,143 @@ static FuncType * funcRefs[] = {
 };
 
 
+/***********************************************************************
+ *
+ *	Function derivatives, at the same indices as funcRefs
+ *
+ ***********************************************************************/
+
+#define kLn10				2.302585092994046
+#define kLn2				0.6931471805599453
+
+static double DAcos (double x)	{ return -1 / sqrt(1 - x * x); }
+static double DAsin (double x)	{ return 1 / sqrt(1 - x * x); }
+static double DAtan (double x)	{ return 1 / (1 + x * x); }
+static double DCos (double x)	{ return -sin(x); }
+static double DSin (double x)	{ return cos(x); }
+static double DTan (double x)	{ double t = tan(x); return 1 + t * t; }
+static double DCosh (double x)	{ return sinh(x); }
+static double DSinh (double x)	{ return cosh(x); }
+static double DTanh (double x)	{ double t = tanh(x); return 1 - t * t; }
+static double DAcosh (double x)	{ return 1 / sqrt(x * x - 1); }
+static double DAsinh (double x)	{ return 1 / sqrt(x * x + 1); }
+static double DAtanh (double x)	{ return 1 / (1 - x * x); }
+static double DExp (double x)	{ return exp(x); }
+static double DLog (double x)	{ return 1 / x; }
+static double DLog10 (double x)	{ return 1 / (x * kLn10); }
+static double DLog2 (double x)	{ return 1 / (x * kLn2); }
+
+static FuncType * funcDerivs[] = {
+/***************************
+ * Trigonometric functions *
+ ***************************/
+&DAcos,				// -1 / sqrt(1 - x^2)
+&DAsin,				// 1 / sqrt(1 - x^2)
+&DAtan,				// 1 / (1 + x^2)
+&DCos,				// -sin(x)
+&DSin,				// cos(x)
+&DTan,				// 1 + tan(x)^2
+
+/************************
+ * Hyperbolic functions	*
+ ************************/
+&DCosh,				// sinh(x)
+&DSinh,				// cosh(x)
+&DTanh,				// 1 - tanh(x)^2
+&DAcosh,			// 1 / sqrt(x^2 - 1)
+&DAsinh,			// 1 / sqrt(x^2 + 1)
+&DAtanh,			// 1 / (1 - x^2)
+
+/*****************************************
+ * Exponential and logarithmic functions *
+ *****************************************/
+&DExp,				// exp(x)
+&DLog,				// 1 / x
+&DLog10,			// 1 / (x ln(10))
+&DLog2				// 1 / (x ln(2))
+};
+
+
+/***********************************************************************
+ *
+ *	Column kernels, at the same indices as funcRefs. A kernel loops
+ *	over a column calling the MathLib trap directly, instead of going
+ *	through the funcRefs wrapper for each value. The traps are the ones
+ *	the wrappers call, so kernel results are bit identical to funcRefs
+ *	results (0 ulp apart) and share MathLib error bounds.
+ *
+ ***********************************************************************/
+
+#define ColumnKernel(kernel, trap)	\
+static void kernel (double * valueP, UInt8 * errP, UInt16 nRows)	\
+{	\
+	UInt16 refNum = MathLibRef;	\
+	UInt16 i;	\
+	for (i = 0; i < nRows; i++)	\
+		if (!errP[i])	\
+			trap(refNum, valueP[i], valueP + i);	\
+}
+
+ColumnKernel(CAcos, MathLibACos)
+ColumnKernel(CAsin, MathLibASin)
+ColumnKernel(CAtan, MathLibATan)
+ColumnKernel(CCos, MathLibCos)
+ColumnKernel(CSin, MathLibSin)
+ColumnKernel(CTan, MathLibTan)
+ColumnKernel(CCosh, MathLibCosH)
+ColumnKernel(CSinh, MathLibSinH)
+ColumnKernel(CTanh, MathLibTanH)
+ColumnKernel(CAcosh, MathLibACosH)
+ColumnKernel(CAsinh, MathLibASinH)
+ColumnKernel(CAtanh, MathLibATanH)
+ColumnKernel(CExp, MathLibExp)
+ColumnKernel(CLog, MathLibLog)
+ColumnKernel(CLog10, MathLibLog10)
+ColumnKernel(CLog2, MathLibLog2)
+
+static ColumnFuncType * funcColumns[] = {
+/***************************
+ * Trigonometric functions *
+ ***************************/
+&CAcos,				// Arc cosine of x
+&CAsin,				// Arc sine of x
+&CAtan,				// Arc tangent of x
+&CCos,				// Cosine of x
+&CSin,				// Sine of x
+&CTan,				// Tangent of x
+
+/************************
+ * Hyperbolic functions	*
+ ************************/
+&CCosh,				// Hyperbolic cosine of x
+&CSinh,				// Hyperbolic sine of x
+&CTanh,				// Hyperbolic tangent of x
+&CAcosh,			// Hyperbolic arc cosine of x
+&CAsinh,			// Hyperbolic arc sine of x
+&CAtanh,			// Hyperbolic arc tangent of x
+
+/*****************************************
+ * Exponential and logarithmic functions *
+ *****************************************/
+&CExp,				// Exponential function of x [pow(e,x)]
+&CLog,				// Natural logarithm of x
+&CLog10,			// Base 10 logarithm of x
+&CLog2				// Base 2 logarithm of x
+};
+
+
+/***********************************************************************
+ *
+ *	Square root, substituted for x^0.5 by the optimizer and not part
+ *	of the functions list
+ *
+ ***********************************************************************/
+
+static Char sqrtName[] = "sqrt";
+static double DSqrt (double x)	{ return 0.5 / sqrt(x); }
+ColumnKernel(CSqrt, MathLibSqrt)
+
+
 /***********************************************************************
  *
  *	Constants names and values at the same indices
@@ -125,7 +264,7 @@ UInt8 GetConst (double * valueP, Char * constName, UInt16 len)
 
 	while (constNames[i])
 	{
-		if (StrNCompare(constName, constNames[i], len) == 0)
+		if (StrNCompare(constName, constNames[i], len) == 0 && !constNames[i][len])
 		{
 			* valueP = constValues[i];
 			return 0;
@@ -158,10 +297,12 @@ UInt8 GetFunc (FuncRef * funcRefP, Char * funcName, UInt16 len)
 
 	while (funcNames[i])
 	{
-		if (StrNCompare(funcName, funcNames[i], len) == 0)
+		if (StrNCompare(funcName, funcNames[i], len) == 0 && !funcNames[i][len])
 		{
 			funcRefP->name = funcNames[i];
 			funcRefP->func = funcRefs[i];
+			funcRefP->deriv = funcDerivs[i];
+			funcRefP->column = funcColumns[i];
 			return 0;
 		}
 		++i;
@@ -171,6 +312,208 @@ UInt8 GetFunc (FuncRef * funcRefP, Char * funcName, UInt16 len)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	GetSqrtFunc
+ *
+ * DESCRIPTION: Returns the square root function
+ *
+ * PARAMETERS:  a funcRef struct (O name / func)
+ *
+ * RETURNED:	0 if found
+ *
+ ***********************************************************************/
+
+UInt8 GetSqrtFunc (FuncRef * funcRefP)
+{
+	if (!MathLibRef)
+		 return 1;
+
+	funcRefP->name = sqrtName;
+	funcRefP->func = &sqrt;
+	funcRefP->deriv = &DSqrt;
+	funcRefP->column = &CSqrt;
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetFuncIndex
+ *
+ * DESCRIPTION: Index of a function, to refer to it outside of the
+ *		application, kSqrtFuncIndex for the square root
+ *
+ * PARAMETERS:  function pointer
+ *
+ * RETURNED:	index, kNoFuncIndex if not found
+ *
+ ***********************************************************************/
+
+Int16 GetFuncIndex (FuncType * func)
+{
+	Int16 i=0;
+
+	if (func == &sqrt)
+		return kSqrtFuncIndex;
+	while (funcNames[i])
+	{
+		if (funcRefs[i] == func)
+			return i;
+		++i;
+	}
+
+	return kNoFuncIndex;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetFuncByIndex
+ *
+ * DESCRIPTION: Returns a function from its GetFuncIndex index
+ *
+ * PARAMETERS:  a funcRef struct (O name / func), index
+ *
+ * RETURNED:	0 if found
+ *
+ ***********************************************************************/
+
+UInt8 GetFuncByIndex (FuncRef * funcRefP, Int16 index)
+{
+	Int16 i=0;
+
+	if (!MathLibRef)
+		 return 1;
+	if (index == kSqrtFuncIndex)
+		return GetSqrtFunc(funcRefP);
+
+	while (funcNames[i] && i < index)
+		++i;
+	if (index < 0 || !funcNames[i])
+		return 1;
+
+	funcRefP->name = funcNames[i];
+	funcRefP->func = funcRefs[i];
+	funcRefP->deriv = funcDerivs[i];
+	funcRefP->column = funcColumns[i];
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetFuncTableSignature
+ *
+ * DESCRIPTION: Hash of the function names in index order and of
+ *		MathLib availability, which changes when function indices
+ *		saved by an earlier version would no longer be valid
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	signature
+ *
+ ***********************************************************************/
+
+UInt32 GetFuncTableSignature (void)
+{
+	UInt8 mathLib = MathLibRef != 0;
+	UInt32 hash;
+	UInt16 i;
+
+	hash = HashFnvBytes(kFnvOffset, &mathLib, 1);
+	for (i = 0; funcNames[i]; i++)
+		hash = HashFnvBytes(hash, funcNames[i], StrLen(funcNames[i]) + 1);
+	return HashFnvBytes(hash, sqrtName, StrLen(sqrtName));
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	HashFnvBytes
+ *
+ * DESCRIPTION: FNV-1a hash of bytes, for the keys and tables of the
+ *		evaluation engines
+ *
+ * PARAMETERS:  hash so far, kFnvOffset to start, bytes, length
+ *
+ * RETURNED:	new hash
+ *
+ ***********************************************************************/
+
+UInt32 HashFnvBytes (UInt32 hash, const void * dataP, UInt16 len)
+{
+	const UInt8 * byteP = dataP;
+
+	while (len--)
+		hash = (hash ^ * byteP++) * kFnvPrime;
+	return hash;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SquarePower
+ *
+ * DESCRIPTION: x ^ m by squaring
+ *
+ * PARAMETERS:  x, positive exponent
+ *
+ * RETURNED:	x ^ m
+ *
+ ***********************************************************************/
+
+static double SquarePower (double x, UInt16 m)
+{
+	double result = 1;
+
+	while (m)
+	{
+		if (m & 1)
+			result *= x;
+		m >>= 1;
+		if (m)
+			x *= x;
+	}
+	return result;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	IntPower
+ *
+ * DESCRIPTION: x ^ n by squaring, without MathLib. x^2 is x*x as with
+ *		pow, higher powers may differ from pow in the last bits.
+ *		x ^ -n is 1 / x^n while x^n is a normal number, otherwise the
+ *		reciprocal would underflow to 0 or lose bits where pow gives
+ *		a subnormal: pow is called then, or without MathLib 1 / x is
+ *		raised instead.
+ *
+ * PARAMETERS:  x, integral exponent
+ *
+ * RETURNED:	x ^ n
+ *
+ ***********************************************************************/
+
+double IntPower (double x, Int16 n)
+{
+	UInt16 m = n < 0 ? -n : n;
+	double result = SquarePower(x, m);
+	double magnitude = result < 0 ? -result : result;
+
+	if (n < 0 ? (magnitude < kMinNormal || magnitude > 1 / kMinNormal)
+	: (magnitude < kMinNormal && x != 0))
+	{
+		if (MathLibRef)
+			return pow(x, n);
+		if (n < 0 && x != 0)
+			return SquarePower(1 / x, m);
+	}
+	return n < 0 ? 1 / result : result;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	GetFuncsStringList
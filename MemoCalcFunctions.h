@@ -13,13 +13,31 @@
 #ifndef MEMOCALCFUNCTIONS_H
 #define MEMOCALCFUNCTIONS_H
 
+// integer powers by squaring, n multiplications give up to n ulp error
+
+#define kMaxIntPower		64
+#define isIntPower(y)		((y) >= -kMaxIntPower && (y) <= kMaxIntPower && (y) == (Int16)(y))
+
+// FNV-1a hash
+
+#define kFnvOffset			2166136261UL
+#define kFnvPrime			16777619UL
+
+// function indices, sqrt is not in the functions list
+
+#define kSqrtFuncIndex		0x7FFF
+#define kNoFuncIndex		-1
+
 // types and structures
 
 typedef double FuncType (double x);
+typedef void ColumnFuncType (double * valueP, UInt8 * errP, UInt16 nRows);
 
 typedef struct FuncRef {
 	Char * name;
 	FuncType * func;
+	FuncType * deriv;		// first derivative of func
+	ColumnFuncType * column;	// func in place over the rows without error
 } FuncRef ;
 
 
@@ -27,6 +45,12 @@ typedef struct FuncRef {
 
 UInt8 GetConst (double * valueP, Char * constName, UInt16 len);
 UInt8 GetFunc (FuncRef * funcRefP, Char * funcName, UInt16 len);
+UInt8 GetSqrtFunc (FuncRef * funcRefP);
+Int16 GetFuncIndex (FuncType * func);
+UInt8 GetFuncByIndex (FuncRef * funcRefP, Int16 index);
+UInt32 GetFuncTableSignature (void);
+UInt32 HashFnvBytes (UInt32 hash, const void * dataP, UInt16 len);
+double IntPower (double x, Int16 n);
 UInt8 GetFuncsStringList (Char *** strTblP, Int16 * nStr);
 
 #endif // MEMOCALCFUNCTIONS_H
@@ -0,0 +1,387 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcGradient.c
+ * 
+ * DESCRIPTION : Forward mode differentiation for MemoCalc. Each node
+ *		evaluates to a dual number: its value, and its partial
+ *		derivatives with respect to every variable of the VarList.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MathLib.h"
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcGradient.h"
+
+extern UInt16 MathLibRef;
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	PowerDeriv
+ *
+ * DESCRIPTION: n u^(n-1), the derivative of u^n with respect to u.
+ *		u^0 is constant: at u = 0, u^-1 is infinite and the product
+ *		would be NaN instead of 0.
+ *
+ * PARAMETERS:  base, exponent
+ *
+ * RETURNED:	derivative
+ *
+ ***********************************************************************/
+
+static double PowerDeriv (double u, double n)
+{
+	if (n == 0)
+		return 0;
+	if (isIntPower(n))
+		return n * IntPower(u, (Int16)n - 1);
+	return n * pow(u, n - 1);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	RecurseGradientNode
+ *
+ * DESCRIPTION: Evaluates an expression tree and its gradient. The left
+ *		operand gradient is computed in place in gradP, the right one
+ *		in workP, which is then shifted by nVars for the next level.
+ *		The leaf of a defined variable reads the value and gradient of
+ *		its definition, evaluated before, unless the solver set it free.
+ *
+ * PARAMETERS:  Expression node, number of variables, value, gradient,
+ *		work area of (depth - 1) * nVars doubles, gradients of the
+ *		definitions, nVars doubles by variable index.
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+static UInt8 RecurseGradientNode (ExprNode * nodeP, UInt16 nVars, double * valueP, double * gradP, double * workP, double * defGradP)
+{
+	double left, right, tmp;
+	UInt16 i;
+	UInt8 err = 0;
+
+	switch (nodeP->token)
+	{
+		case tNumber:
+			* valueP = nodeP->data.value;
+			MemSet(gradP, nVars * sizeof(double), 0);
+		break;
+
+		case tName:
+			if (!(nodeP->dataType & mValue))
+			{
+				err |= missingVarError;
+				break;
+			}
+			if (nodeP->varP && nodeP->varP->defTreeP && !(nodeP->varP->defState & varDefFree))
+			{
+				// chain rule through the definition
+				* valueP = nodeP->varP->value;
+				MemMove(gradP, defGradP + nodeP->varP->index * nVars, nVars * sizeof(double));
+				err |= nodeP->varP->defErr;
+				break;
+			}
+			MemSet(gradP, nVars * sizeof(double), 0);
+			if (nodeP->varP)
+			{
+				* valueP = nodeP->varP->value;
+				gradP[nodeP->varP->index] = 1;
+			}
+			else
+				* valueP = nodeP->data.value;
+		break;
+
+		case '(':
+			if ((err |= RecurseGradientNode(nodeP->leftP, nVars, valueP, gradP, workP, defGradP))
+			|| !(nodeP->dataType & mFunction))
+				break;
+			if (nodeP->dataType != tFunction)
+				err |= missingFuncError;
+			else if (isNonFinite(* valueP))
+				err |= mathError;
+			else
+			{
+				// chain rule : f(u)' = f'(u) u'
+				tmp = nodeP->data.funcRef.deriv(* valueP);
+				* valueP = nodeP->data.funcRef.func(* valueP);
+				for (i = 0; i < nVars; i++)
+					gradP[i] = gradP[i] ? tmp * gradP[i] : 0;
+			}
+		break;
+
+		case '~':
+			if (!(err |= RecurseGradientNode(nodeP->rightP, nVars, &right, gradP, workP, defGradP)))
+			{
+				err |= EvalBitwiseOp('~', 0, right, valueP);
+				MemSet(gradP, nVars * sizeof(double), 0);
+			}
+		break;
+
+		case tIntPower:
+			if (err |= RecurseGradientNode(nodeP->leftP, nVars, &left, gradP, workP, defGradP))
+				break;
+			if (isNonFinite(left))
+			{
+				err |= mathError;
+				break;
+			}
+			// (u ^ n)' = n u^(n-1) u'
+			* valueP = IntPower(left, (Int16)nodeP->data.value);
+			tmp = PowerDeriv(left, nodeP->data.value);
+			for (i = 0; i < nVars; i++)
+				gradP[i] = gradP[i] ? tmp * gradP[i] : 0;
+		break;
+
+		default:
+			if ((err |= RecurseGradientNode(nodeP->leftP, nVars, &left, gradP, workP, defGradP))
+			|| (err |= RecurseGradientNode(nodeP->rightP, nVars, &right, workP, workP + nVars, defGradP)))
+				break;
+			switch (nodeP->token)
+			{
+				case '+':
+				case tMulAdd:
+					* valueP = left + right;
+					for (i = 0; i < nVars; i++)
+						gradP[i] += workP[i];
+				break;
+
+				case '-':
+				case tMulSub:
+					* valueP = left - right;
+					for (i = 0; i < nVars; i++)
+						gradP[i] -= workP[i];
+				break;
+
+				case '*':
+					* valueP = left * right;
+					for (i = 0; i < nVars; i++)
+						gradP[i] = gradP[i] * right + left * workP[i];
+				break;
+
+				case '/':
+					if (isNonFinite(right))
+					{
+						err |= mathError;
+						break;
+					}
+					// (u / v)' = (u' - (u / v) v') / v
+					* valueP = left / right;
+					for (i = 0; i < nVars; i++)
+						gradP[i] = (gradP[i] - * valueP * workP[i]) / right;
+				break;
+
+				case '&':
+				case '|':
+					// piecewise constant
+					if (err |= EvalBitwiseOp(nodeP->token, left, right, valueP))
+						break;
+					MemSet(gradP, nVars * sizeof(double), 0);
+				break;
+
+				case '^':
+					if (isNonFinite(left) || isNonFinite(right))
+					{
+						err |= mathError;
+						break;
+					}
+					// the ln(u) term needs MathLib if the exponent is variable
+					for (i = 0; i < nVars && !workP[i]; i++)
+						;
+					if (!MathLibRef && (i < nVars || !isIntPower(right)))
+					{
+						err |= missingFuncError;
+						break;
+					}
+					if (isIntPower(right))
+						* valueP = IntPower(left, (Int16)right);
+					else
+						* valueP = pow(left, right);
+					tmp = PowerDeriv(left, right);
+					// (u ^ v)' = v u^(v-1) u' + u^v ln(u) v', the ln(u) term
+					// vanishes with u^v at u = 0 where ln(u) is infinite
+					for (i = 0; i < nVars; i++)
+					{
+						gradP[i] = gradP[i] ? tmp * gradP[i] : 0;
+						if (workP[i] && * valueP)
+							gradP[i] += * valueP * log(left) * workP[i];
+					}
+				break;
+			}
+	}
+
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalExprGradient
+ *
+ * DESCRIPTION: Evaluates a compiled expression and its partial
+ *		derivatives in a single pass over the tree. The definitions it
+ *		reads are evaluated first, each one with its own gradient, and
+ *		a defined variable has a null derivative unless the solver set
+ *		it free.
+ *
+ * PARAMETERS:  Compiled expression, result, gradient array of
+ *		compP->varL.nVars doubles, in variables list order.
+ *
+ * RETURNED:	0 if no error, mathError if the result or one of the
+ *		derivatives is not finite.
+ *
+ ***********************************************************************/
+
+UInt8 EvalExprGradient (CompiledExpr * compP, double * resultP, double * gradP)
+{
+	double * workP = NULL, * defGradP = NULL;
+	VarCell * varP;
+	UInt16 i, nVars, depth;
+	UInt8 err = 0;
+
+	if (!compP->exprT.rootP)
+		return parseError;
+
+	nVars = compP->varL.nVars;
+	depth = ExprNodeDepth(compP->exprT.rootP);
+	for (varP = compP->exprT.defsP; varP; varP = varP->nextEvalP)
+		if (ExprNodeDepth(varP->defTreeP) > depth)
+			depth = ExprNodeDepth(varP->defTreeP);
+	if (nVars)
+	{
+		workP = MemPtrNew(depth * nVars * sizeof(double));
+		if (!workP)
+			return memoryError;
+	}
+	if (compP->exprT.defsP)
+	{
+		defGradP = MemPtrNew(nVars * nVars * sizeof(double));
+		if (!defGradP)
+		{
+			MemPtrFree(workP);
+			return memoryError;
+		}
+	}
+
+	for (varP = compP->exprT.defsP; varP; varP = varP->nextEvalP)
+	{
+		if (varP->defState & varDefFree)
+			varP->defErr = 0;
+		else if ((varP->defErr = RecurseGradientNode(varP->defTreeP, nVars, &(varP->value),
+			defGradP + varP->index * nVars, workP, defGradP)) != 0)
+			varP->value = 0;
+	}
+	err |= RecurseGradientNode(compP->exprT.rootP, nVars, resultP, gradP, workP, defGradP);
+
+	if (!err && isNonFinite(* resultP))
+		err |= mathError;
+	for (i = 0; i < nVars && !err; i++)
+		if (isNonFinite(gradP[i]))
+			err |= mathError;
+
+	if (defGradP)
+		MemPtrFree(defGradP);
+	if (workP)
+		MemPtrFree(workP);
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MakeExprGradientStringList
+ *
+ * DESCRIPTION: Evaluates the partial derivatives of a compiled
+ *		expression and formats them as a "name=value" string list, in
+ *		the same way as MakeVarsStringList does for the variables. The
+ *		defined variables are left out.
+ *
+ * PARAMETERS:  Compiled expression, string table, number of strings.
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 MakeExprGradientStringList (CompiledExpr * compP, Char *** strTblP, Int16 * nStr)
+{
+	FlpCompDouble tmpF;
+	VarCell * varP;
+	double result, * gradP = NULL;
+	Int16 len;
+	UInt8 err = 0;
+
+	* strTblP = NULL;
+	* nStr = 0;
+	if (!compP->varL.nVars)
+		return 0;
+
+	gradP = MemPtrNew(compP->varL.nVars * sizeof(double));
+	if (!gradP)
+		return memoryError;
+	err |= EvalExprGradient(compP, &result, gradP);
+	if (err)
+		goto CleanUp;
+
+	* strTblP = MemPtrNew(compP->varL.nVars * sizeof(Char**));
+	for (varP = compP->varL.headP; varP; varP = varP->nextP)
+	{
+		if (varP->defStr)
+			continue;
+		len = StrLen(varP->name);
+		(* strTblP)[* nStr] = MemPtrNew(len + 4 + kFlpBufSize);
+		MemSet((* strTblP)[* nStr], len + 4 + kFlpBufSize, 0);
+		StrCopy((* strTblP)[* nStr], "d/d");
+		StrCopy((* strTblP)[* nStr] + 3, varP->name);
+		(* strTblP)[* nStr][len + 3] = '=';
+		tmpF.d = gradP[varP->index];
+		FlpCmpDblToA(&tmpF, (* strTblP)[* nStr] + len + 4);
+		(* nStr)++;
+	}
+
+CleanUp:
+	MemPtrFree(gradP);
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MakeGradientStringList
+ *
+ * DESCRIPTION: Compile an expression and make the string list of its
+ *		partial derivatives
+ *
+ * PARAMETERS:  Expression, variables assignations, string table,
+ *		number of strings.
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 MakeGradientStringList (Char * exprStr, Char * varsStr, Char *** strTblP, Int16 * nStr)
+{
+	CompiledExpr comp;
+	UInt8 err = 0;
+
+	* strTblP = NULL;
+	* nStr = 0;
+
+	err |= CompileExpr(exprStr, varsStr, &comp);
+	if (!err)
+		err |= MakeExprGradientStringList(&comp, strTblP, nStr);
+
+	DeleteCompiledExpr(&comp);
+	return err;
+}
@@ -0,0 +1,22 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcGradient.h
+ * 
+ * DESCRIPTION : Forward mode differentiation headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCGRADIENT_H
+#define MEMOCALCGRADIENT_H
+
+// functions
+
+UInt8 EvalExprGradient (CompiledExpr * compP, double * resultP, double * gradP);
+UInt8 MakeExprGradientStringList (CompiledExpr * compP, Char *** strTblP, Int16 * nStr);
+UInt8 MakeGradientStringList (Char * exprStr, Char * varsStr, Char *** strTblP, Int16 * nStr);
+
+#endif // MEMOCALCGRADIENT_H
@@ -0,0 +1,489 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcIncremental.c
+ * 
+ * DESCRIPTION : Incremental evaluation for MemoCalc. Each node keeps
+ *		its last result, and each variable the list of nodes reading
+ *		it. When some variable values change, only the nodes on their
+ *		paths to the root are evaluated again, the other operands are
+ *		read from the cached results. Integer subtrees are evaluated as
+ *		one node, and the product of a multiply-add is not cached, so
+ *		results and errors are the tree's.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MathLib.h"
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcIncremental.h"
+
+extern UInt16 MathLibRef;
+
+// globals
+static IncrStats sIncrStats;
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetIncrArgs
+ *
+ * DESCRIPTION: Operands of a node, in the order the tree evaluates them.
+ *		Leaves and integer subtrees have none.
+ *
+ * PARAMETERS:  node, returned operands
+ *
+ * RETURNED:	number of operands
+ *
+ ***********************************************************************/
+
+UInt8 GetIncrArgs (ExprNode * nodeP, ExprNode ** argsP)
+{
+	if (nodeP->dataType & mInteger)
+		return 0;
+
+	switch (nodeP->token)
+	{
+		case tNumber:
+		case tName:
+			return 0;
+
+		case '(':
+		case tIntPower:
+			argsP[0] = nodeP->leftP;
+			return 1;
+
+		case '~':
+			argsP[0] = nodeP->rightP;
+			return 1;
+
+		case tMulAdd:
+		case tMulSub:
+			argsP[0] = nodeP->leftP->leftP;
+			argsP[1] = nodeP->leftP->rightP;
+			argsP[2] = nodeP->rightP;
+			return 3;
+	}
+	argsP[0] = nodeP->leftP;
+	argsP[1] = nodeP->rightP;
+	return 2;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CountIncrNodes
+ *
+ * DESCRIPTION: Number of nodes with a cached result in a subtree
+ *
+ * PARAMETERS:  node
+ *
+ * RETURNED:	nodes count
+ *
+ ***********************************************************************/
+
+static UInt16 CountIncrNodes (ExprNode * nodeP)
+{
+	ExprNode * argsP[kIncrMaxArgs];
+	UInt16 count = 1;
+	UInt8 i, nArgs;
+
+	nArgs = GetIncrArgs(nodeP, argsP);
+	for (i = 0; i < nArgs; i++)
+		count += CountIncrNodes(argsP[i]);
+	return count;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	AddIncrNode
+ *
+ * DESCRIPTION: Add the nodes of a subtree in postfix order
+ *
+ * PARAMETERS:  incremental expression, node
+ *
+ * RETURNED:	index of the node
+ *
+ ***********************************************************************/
+
+static UInt16 AddIncrNode (IncrExpr * incrP, ExprNode * nodeP)
+{
+	ExprNode * argsP[kIncrMaxArgs];
+	UInt16 args[kIncrMaxArgs];
+	IncrNode * incrNodeP;
+	UInt16 index;
+	UInt8 i, nArgs;
+
+	nArgs = GetIncrArgs(nodeP, argsP);
+	for (i = 0; i < nArgs; i++)
+		args[i] = AddIncrNode(incrP, argsP[i]);
+
+	index = incrP->nNodes++;
+	incrNodeP = incrP->nodesP + index;
+	MemSet(incrNodeP, sizeof(IncrNode), 0);
+	incrNodeP->nodeP = nodeP;
+	incrNodeP->parent = kNoIncrNode;
+	incrNodeP->dirty = true;
+	for (i = 0; i < kIncrMaxArgs; i++)
+		incrNodeP->args[i] = i < nArgs ? args[i] : kNoIncrNode;
+	for (i = 0; i < nArgs; i++)
+		incrP->nodesP[args[i]].parent = index;
+	return index;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	AddIncrDeps
+ *
+ * DESCRIPTION: Count, or list, a node as reading the variables of a
+ *		subtree. The subtree is the node itself but for integer
+ *		subtrees, evaluated as one node.
+ *
+ * PARAMETERS:  incremental expression, subtree, node index, cursor
+ *		by variable or NULL to count
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void AddIncrDeps (IncrExpr * incrP, ExprNode * nodeP, UInt16 index, UInt16 * cursorP)
+{
+	if (!nodeP)
+		return;
+	if (nodeP->varP)
+	{
+		if (cursorP)
+			incrP->depsP[cursorP[nodeP->varP->index]++] = index;
+		else
+			incrP->depStartP[nodeP->varP->index + 1]++;
+	}
+	AddIncrDeps(incrP, nodeP->leftP, index, cursorP);
+	AddIncrDeps(incrP, nodeP->rightP, index, cursorP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	InitIncrExpr
+ *
+ * DESCRIPTION: Index the nodes of a compiled expression and the
+ *		variables they read. Every node is dirty until evaluated.
+ *
+ * PARAMETERS:  compiled expression, incremental expression
+ *
+ * RETURNED:	0 if no error, the incremental expression is then to be
+ *		deleted before the compiled expression
+ *
+ ***********************************************************************/
+
+UInt8 InitIncrExpr (CompiledExpr * compP, IncrExpr * incrP)
+{
+	VarCell * varP;
+	UInt16 * cursorP;
+	IncrNode * incrNodeP;
+	UInt16 i;
+
+	MemSet(incrP, sizeof(IncrExpr), 0);
+	if (!compP->exprT.rootP)
+		return parseError;
+
+	incrP->compP = compP;
+	incrP->evalMode = GetEvalMode();
+	for (varP = compP->varL.headP; varP; varP = varP->nextP)
+		incrP->nVars++;
+	incrP->nodesP = MemPtrNew(CountIncrNodes(compP->exprT.rootP) * sizeof(IncrNode));
+	AddIncrNode(incrP, compP->exprT.rootP);
+
+	// variables to nodes index, leaves but for integer subtrees
+	incrP->depStartP = MemPtrNew((incrP->nVars + 1) * sizeof(UInt16));
+	MemSet(incrP->depStartP, (incrP->nVars + 1) * sizeof(UInt16), 0);
+	for (i = 0, incrNodeP = incrP->nodesP; i < incrP->nNodes; i++, incrNodeP++)
+		if (incrNodeP->args[0] == kNoIncrNode)
+			AddIncrDeps(incrP, incrNodeP->nodeP, i, NULL);
+	for (i = 0; i < incrP->nVars; i++)
+		incrP->depStartP[i + 1] += incrP->depStartP[i];
+
+	cursorP = MemPtrNew((incrP->nVars + 1) * sizeof(UInt16));
+	MemMove(cursorP, incrP->depStartP, (incrP->nVars + 1) * sizeof(UInt16));
+	incrP->depsP = MemPtrNew((incrP->depStartP[incrP->nVars] + 1) * sizeof(UInt16));
+	for (i = 0, incrNodeP = incrP->nodesP; i < incrP->nNodes; i++, incrNodeP++)
+		if (incrNodeP->args[0] == kNoIncrNode)
+			AddIncrDeps(incrP, incrNodeP->nodeP, i, cursorP);
+	MemPtrFree(cursorP);
+
+	incrP->varValueP = MemPtrNew((incrP->nVars + 1) * sizeof(double));
+	incrP->varErrP = MemPtrNew(incrP->nVars + 1);
+	for (i = 0, varP = compP->varL.headP; varP; i++, varP = varP->nextP)
+	{
+		incrP->varValueP[i] = varP->value;
+		incrP->varErrP[i] = varP->defErr;
+	}
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalIncrOp
+ *
+ * DESCRIPTION: Evaluate an operator node from the values of its
+ *		operands, with the operations and checks of the tree in an
+ *		evaluation mode
+ *
+ * PARAMETERS:  node, operands values in GetIncrArgs order, evaluation
+ *		mode, result
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 EvalIncrOp (ExprNode * nodeP, double * args, UInt8 evalMode, double * resultP)
+{
+	double result = * resultP;
+	Boolean deferred = evalMode == evalCheckDeferred;
+	UInt8 err = 0;
+
+	switch (nodeP->token)
+	{
+		case '(':
+			result = args[0];
+			if (nodeP->dataType & mFunction)
+			{
+				if (nodeP->dataType != tFunction)
+					err |= missingFuncError;
+				else if (deferred && isNonFinite(result))
+					err |= mathError;
+				else
+					result = nodeP->data.funcRef.func(result);
+			}
+		break;
+
+		case '+':
+			result = args[0] + args[1];
+		break;
+
+		case '-':
+			result = args[0] - args[1];
+		break;
+
+		case '*':
+			result = args[0] * args[1];
+		break;
+
+		case '/':
+			if (deferred && isNonFinite(args[1]))
+				err |= mathError;
+			else
+				result = args[0] / args[1];
+		break;
+
+		case '&':
+		case '|':
+			err |= EvalBitwiseOp(nodeP->token, args[0], args[1], &result);
+		break;
+
+		case '~':
+			err |= EvalBitwiseOp('~', 0, args[0], &result);
+		break;
+
+		case '^':
+			if (deferred && (isNonFinite(args[0]) || isNonFinite(args[1])))
+				err |= mathError;
+			else if (isIntPower(args[1]))
+				result = IntPower(args[0], (Int16)args[1]);
+			else if (!MathLibRef)
+				err |= missingFuncError;
+			else
+				result = pow(args[0], args[1]);
+		break;
+
+		case tIntPower:
+			if (deferred && isNonFinite(args[0]))
+				err |= mathError;
+			else
+				result = IntPower(args[0], (Int16)nodeP->data.value);
+		break;
+
+		case tMulAdd:
+			result = args[0] * args[1] + args[2];
+		break;
+
+		case tMulSub:
+			result = args[0] * args[1] - args[2];
+		break;
+	}
+
+	if (!deferred && isNonFinite(result))
+		err |= mathError;
+	* resultP = result;
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalIncrNode
+ *
+ * DESCRIPTION: Evaluate a dirty node from the results of its operands,
+ *		evaluating the dirty operands first. All of them are evaluated
+ *		even after an error, so the parents of a dirty node are always
+ *		dirty. The error reported is the first operand's, as the tree's.
+ *		Leaves and integer subtrees are evaluated on the tree.
+ *
+ * PARAMETERS:  incremental expression, node index
+ *
+ * RETURNED:	nothing, the result and error are in the node
+ *
+ ***********************************************************************/
+
+static void EvalIncrNode (IncrExpr * incrP, UInt16 index)
+{
+	IncrNode * incrNodeP = incrP->nodesP + index, * argP;
+	ExprNode * nodeP = incrNodeP->nodeP;
+	double args[kIncrMaxArgs];
+	UInt8 i, err = 0;
+
+	incrNodeP->dirty = false;
+	if (incrNodeP->args[0] == kNoIncrNode)
+	{
+		sIncrStats.nRecomputed++;
+		incrNodeP->err = RecurseExprNode(nodeP, &(incrNodeP->value));
+		return;
+	}
+
+	for (i = 0; i < kIncrMaxArgs && incrNodeP->args[i] != kNoIncrNode; i++)
+	{
+		argP = incrP->nodesP + incrNodeP->args[i];
+		if (argP->dirty)
+			EvalIncrNode(incrP, incrNodeP->args[i]);
+		else
+			sIncrStats.nReused++;
+		if (!err)
+			err = argP->err;
+		args[i] = argP->value;
+	}
+	sIncrStats.nRecomputed++;
+	incrNodeP->err = err;
+	if (!err)
+		incrNodeP->err = EvalIncrOp(nodeP, args, incrP->evalMode, &(incrNodeP->value));
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalIncrExpr
+ *
+ * DESCRIPTION: Evaluate again the nodes reading the variables changed
+ *		since the last evaluation, and their parents. Values are
+ *		compared bitwise, so a change of sign of zero or a NaN is
+ *		seen. The definitions are evaluated first, and compared with
+ *		their errors. Changing the evaluation mode makes every node
+ *		dirty.
+ *
+ * PARAMETERS:  incremental expression, result
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 EvalIncrExpr (IncrExpr * incrP, double * resultP)
+{
+	IncrNode * rootP = incrP->nodesP + incrP->nNodes - 1;
+	VarCell * varP;
+	UInt16 i, j, index;
+	UInt8 err = 0;
+
+	if (!incrP->nodesP)
+		return parseError;
+	sIncrStats.nEvals++;
+
+	if (incrP->evalMode != GetEvalMode())
+	{
+		incrP->evalMode = GetEvalMode();
+		for (i = 0; i < incrP->nNodes; i++)
+			incrP->nodesP[i].dirty = true;
+	}
+
+	EvalVarDefs(incrP->compP->exprT.defsP);
+	for (i = 0, varP = incrP->compP->varL.headP; varP; i++, varP = varP->nextP)
+	{
+		if (!MemCmp(&(varP->value), incrP->varValueP + i, sizeof(double))
+		&& varP->defErr == incrP->varErrP[i])
+			continue;
+		incrP->varValueP[i] = varP->value;
+		incrP->varErrP[i] = varP->defErr;
+		for (j = incrP->depStartP[i]; j < incrP->depStartP[i + 1]; j++)
+			for (index = incrP->depsP[j];
+				index != kNoIncrNode && !incrP->nodesP[index].dirty;
+				index = incrP->nodesP[index].parent)
+				incrP->nodesP[index].dirty = true;
+	}
+
+	if (rootP->dirty)
+		EvalIncrNode(incrP, incrP->nNodes - 1);
+	else
+		sIncrStats.nReused++;
+
+	err = rootP->err;
+	* resultP = rootP->value;
+	if (!err && incrP->evalMode == evalCheckDeferred && isNonFinite(* resultP))
+		err |= mathError;
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	DeleteIncrExpr
+ *
+ * DESCRIPTION: Free the nodes and variables index, the compiled
+ *		expression is kept
+ *
+ * PARAMETERS:  incremental expression
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void DeleteIncrExpr (IncrExpr * incrP)
+{
+	if (incrP->nodesP)
+		MemPtrFree(incrP->nodesP);
+	if (incrP->depsP)
+		MemPtrFree(incrP->depsP);
+	if (incrP->depStartP)
+		MemPtrFree(incrP->depStartP);
+	if (incrP->varValueP)
+		MemPtrFree(incrP->varValueP);
+	if (incrP->varErrP)
+		MemPtrFree(incrP->varErrP);
+	MemSet(incrP, sizeof(IncrExpr), 0);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetIncrStats
+ *
+ * DESCRIPTION: Nodes evaluated again and reused since started
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	incremental stats
+ *
+ ***********************************************************************/
+
+IncrStats * GetIncrStats (void)
+{
+	return &sIncrStats;
+}
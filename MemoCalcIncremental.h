@@ -0,0 +1,57 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcIncremental.h
+ * 
+ * DESCRIPTION : Incremental evaluation headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCINCREMENTAL_H
+#define MEMOCALCINCREMENTAL_H
+
+#define kNoIncrNode			0xFFFF
+#define kIncrMaxArgs		3		// tMulAdd and tMulSub operands
+
+// structures
+
+typedef struct IncrNode {
+	ExprNode * nodeP;
+	double value;			// result at the last evaluation
+	UInt16 parent;			// kNoIncrNode for the root
+	UInt16 args[kIncrMaxArgs];	// operands, kNoIncrNode after the last one
+	UInt8 err;
+	Boolean dirty;			// to evaluate again
+} IncrNode;
+
+typedef struct IncrExpr {
+	CompiledExpr * compP;
+	IncrNode * nodesP;		// evaluated nodes in postfix order, root last
+	UInt16 * depsP;			// nodes reading variable i, from depStartP[i] to depStartP[i + 1]
+	UInt16 * depStartP;
+	double * varValueP;		// variable values at the last evaluation, by index
+	UInt8 * varErrP;		// definition errors at the last evaluation, by index
+	UInt16 nNodes;
+	UInt16 nVars;
+	UInt8 evalMode;			// errors cached in this mode
+} IncrExpr;
+
+typedef struct IncrStats {
+	UInt32 nEvals;
+	UInt32 nRecomputed;		// nodes evaluated again
+	UInt32 nReused;			// nodes whose cached value was used
+} IncrStats;
+
+// functions
+
+UInt8 GetIncrArgs (ExprNode * nodeP, ExprNode ** argsP);
+UInt8 EvalIncrOp (ExprNode * nodeP, double * args, UInt8 evalMode, double * resultP);
+UInt8 InitIncrExpr (CompiledExpr * compP, IncrExpr * incrP);
+UInt8 EvalIncrExpr (IncrExpr * incrP, double * resultP);
+void DeleteIncrExpr (IncrExpr * incrP);
+IncrStats * GetIncrStats (void);
+
+#endif // MEMOCALCINCREMENTAL_H
@@ -0,0 +1,398 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcIntern.c
+ * 
+ * DESCRIPTION : Compiled expressions intern table for MemoCalc. Memos
+ *		sharing an expression, with only their title or variables
+ *		values differing, share one compiled tree. A memo is first
+ *		looked up by its tokens and variable names, which avoids the
+ *		compilation, then by its canonical tree, in which the operands
+ *		of + * & | are ordered by hash so that a+b and b+a are one
+ *		entry, which then keeps the tokens of b+a as its alias. The
+ *		variables values of the memo are copied in the shared variable
+ *		cells before each evaluation. Trees reading definitions are
+ *		only shared by their tokens, which include the definitions.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcCache.h"
+#include "MemoCalcIncremental.h"
+#include "MemoCalcBytecode.h"
+#include "MemoCalcIntern.h"
+#include "MemoCalcPersist.h"
+
+#define isCommutative(t)	((t) == '+' || (t) == '*' || (t) == '&' || (t) == '|')
+
+// globals
+static InternEntry sInternTable[kInternTableSize];
+static InternStats sInternStats;
+static UInt32 sInternClock;
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CanonicalNode
+ *
+ * DESCRIPTION: Order the operands of commutative operators by hash,
+ *		operands first, and hash the subtree. Variables hash by name
+ *		and constants by value, so equal trees from different memos
+ *		get equal hashes.
+ *
+ * PARAMETERS:  node, count of nodes to increment
+ *
+ * RETURNED:	subtree hash
+ *
+ ***********************************************************************/
+
+static UInt32 CanonicalNode (ExprNode * nodeP, UInt16 * nNodesP)
+{
+	ExprNode * swapP;
+	UInt32 hash = kFnvOffset, leftHash, rightHash, swapHash;
+
+	if (!nodeP)
+		return 0;
+	(* nNodesP)++;
+	leftHash = CanonicalNode(nodeP->leftP, nNodesP);
+	rightHash = CanonicalNode(nodeP->rightP, nNodesP);
+	if (isCommutative(nodeP->token) && leftHash > rightHash)
+	{
+		swapP = nodeP->leftP;
+		nodeP->leftP = nodeP->rightP;
+		nodeP->rightP = swapP;
+		swapHash = leftHash;
+		leftHash = rightHash;
+		rightHash = swapHash;
+	}
+
+	hash = HashFnvBytes(hash, &(nodeP->token), 1);
+	hash = HashFnvBytes(hash, &(nodeP->dataType), 1);
+	if (nodeP->varP)
+		hash = HashFnvBytes(hash, nodeP->varP->name, StrLen(nodeP->varP->name));
+	else if (nodeP->token == '(' && nodeP->dataType & mFunction)
+		hash = HashFnvBytes(hash, &(nodeP->data.funcRef.func), sizeof(FuncType *));
+	else if (nodeP->dataType & mValue || nodeP->token == tIntPower)
+		hash = HashFnvBytes(hash, &(nodeP->data.value), sizeof(double));
+	hash = HashFnvBytes(hash, &leftHash, sizeof(UInt32));
+	return HashFnvBytes(hash, &rightHash, sizeof(UInt32));
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SameNodes
+ *
+ * DESCRIPTION: Compare canonical subtrees, variables by name. Leaves
+ *		of missing variables, or of definitions, never compare equal.
+ *
+ * PARAMETERS:  nodes
+ *
+ * RETURNED:	true if equal
+ *
+ ***********************************************************************/
+
+static Boolean SameNodes (ExprNode * aP, ExprNode * bP)
+{
+	if (!aP || !bP)
+		return aP == bP;
+	if (aP->token != bP->token || aP->dataType != bP->dataType
+	|| !aP->varP != !bP->varP)
+		return false;
+
+	if (aP->varP)
+	{
+		if (aP->varP->defTreeP || bP->varP->defTreeP
+		|| StrCompare(aP->varP->name, bP->varP->name))
+			return false;
+	}
+	else if (aP->token == '(' && aP->dataType & mFunction)
+	{
+		if (aP->data.funcRef.func != bP->data.funcRef.func)
+			return false;
+	}
+	else if (aP->dataType & mValue || aP->token == tIntPower)
+	{
+		if (MemCmp(&(aP->data.value), &(bP->data.value), sizeof(double)))
+			return false;
+	}
+	else if (aP->token == tNumber || aP->token == tName)
+		return false;
+
+	return SameNodes(aP->leftP, bP->leftP) && SameNodes(aP->rightP, bP->rightP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	BindVars
+ *
+ * DESCRIPTION: Copy variables values by name into shared cells
+ *
+ * PARAMETERS:  shared variables list, memo variables list
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void BindVars (VarList * sharedL, VarList * varL)
+{
+	VarCell * sharedP, * varP;
+
+	for (sharedP = sharedL->headP; sharedP; sharedP = sharedP->nextP)
+	{
+		varP = GetVarCell(varL, sharedP->name);
+		if (!varP)
+			continue;
+		sharedP->value = varP->value;
+		sharedP->distA = varP->distA;
+		sharedP->distB = varP->distB;
+		sharedP->distType = varP->distType;
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SameKey
+ *
+ * DESCRIPTION: Compare expression keys
+ *
+ * PARAMETERS:  keys
+ *
+ * RETURNED:	true if equal
+ *
+ ***********************************************************************/
+
+static Boolean SameKey (EvalKey * aP, EvalKey * bP)
+{
+	return aP->hash == bP->hash && aP->check == bP->check && aP->len == bP->len;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	UseEntry
+ *
+ * DESCRIPTION: Mark an entry used and bind the memo variables
+ *
+ * PARAMETERS:  entry, memo variables list
+ *
+ * RETURNED:	shared compiled expression
+ *
+ ***********************************************************************/
+
+static CompiledExpr * UseEntry (InternEntry * entryP, VarList * varL)
+{
+	entryP->lastUse = ++sInternClock;
+	BindVars(&(entryP->comp.varL), varL);
+	return &(entryP->comp);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	InternExpr
+ *
+ * DESCRIPTION: Get the shared compiled expression of a memo, with the
+ *		memo variables values bound. A new expression takes a free
+ *		entry or the least recently used one. The returned expression
+ *		is owned by the table, it is valid until the next call and
+ *		must not be modified.
+ *
+ * PARAMETERS:  expression, parsed variables list, moved into the
+ *		table when the expression is compiled or loaded, expression
+ *		key, returned compiled expression
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 InternExpr (Char * exprStr, VarList * varL, EvalKey * keyP, CompiledExpr ** compP)
+{
+	CompiledExpr comp;
+	InternEntry * entryP, * lruP = sInternTable;
+	UInt32 hash;
+	UInt16 nNodes = 0;
+	UInt8 err = 0;
+
+	* compP = NULL;
+	sInternStats.nLookups++;
+	for (entryP = sInternTable; entryP < sInternTable + kInternTableSize; entryP++)
+	{
+		if (entryP->used && (SameKey(&(entryP->key), keyP) || SameKey(&(entryP->aliasKey), keyP)))
+		{
+			sInternStats.nHits++;
+			* compP = UseEntry(entryP, varL);
+			return 0;
+		}
+	}
+
+	// saved by a previous run, or compiled
+	if (!LoadPersistExpr(keyP, varL, &comp))
+	{
+		err = CompileParsedExpr(exprStr, varL, &comp);
+		if (err)
+		{
+			DeleteCompiledExpr(&comp);
+			return err;
+		}
+	}
+	hash = CanonicalNode(comp.exprT.rootP, &nNodes);
+
+	for (entryP = sInternTable; entryP < sInternTable + kInternTableSize; entryP++)
+	{
+		if (entryP->used && entryP->hash == hash
+		&& SameNodes(entryP->comp.exprT.rootP, comp.exprT.rootP))
+		{
+			// a second expression, whose tree is not kept, found by
+			// its own tokens from now on
+			sInternStats.nCanonicalHits++;
+			sInternStats.nodesShared += nNodes;
+			entryP->aliasKey = * keyP;
+			* compP = UseEntry(entryP, &(comp.varL));
+			DeleteCompiledExpr(&comp);
+			return 0;
+		}
+		if (!entryP->used)
+		{
+			if (lruP->used)
+				lruP = entryP;
+		}
+		else if (lruP->used && entryP->lastUse < lruP->lastUse)
+			lruP = entryP;
+	}
+
+	if (lruP->used)
+	{
+		sInternStats.nEvictions++;
+		DeleteTieredExpr(&(lruP->tier));
+		DeleteCompiledExpr(&(lruP->comp));
+	}
+	else
+		sInternStats.nEntries++;
+	lruP->comp = comp;
+	lruP->key = * keyP;
+	lruP->aliasKey = * keyP;
+	lruP->hash = hash;
+	lruP->nNodes = nNodes;
+	lruP->lastUse = ++sInternClock;
+	lruP->used = true;
+	InitTieredExpr(&(lruP->tier), &(lruP->comp));
+	* compP = &(lruP->comp);
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalInternExpr
+ *
+ * DESCRIPTION: Evaluate a shared compiled expression on its tier.
+ *		Memos sharing it bind their own values, and count as
+ *		evaluations of the one tree. Once hot, only the nodes reading
+ *		the variables that differ from the last evaluation are
+ *		evaluated again, which is a single path when one variable was
+ *		edited.
+ *
+ * PARAMETERS:  compiled expression returned by InternExpr, result
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 EvalInternExpr (CompiledExpr * compP, double * resultP)
+{
+	InternEntry * entryP;
+
+	for (entryP = sInternTable; entryP < sInternTable + kInternTableSize; entryP++)
+	{
+		if (entryP->used && &(entryP->comp) == compP)
+			return EvalTieredExpr(&(entryP->tier), resultP);
+	}
+	return EvalExprTree(&(compP->exprT), resultP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetInternTier
+ *
+ * DESCRIPTION: Find the shared expression of a memo, by its tokens and
+ *		variable names, for its tier and evaluations count
+ *
+ * PARAMETERS:  expression, parsed variables list
+ *
+ * RETURNED:	tiered expression, NULL if not shared
+ *
+ ***********************************************************************/
+
+TieredExpr * GetInternTier (Char * exprStr, VarList * varL)
+{
+	InternEntry * entryP;
+	EvalKey exprKey, evalKey;
+
+	if (MakeEvalKeys(exprStr, varL, &exprKey, &evalKey))
+		return NULL;
+	for (entryP = sInternTable; entryP < sInternTable + kInternTableSize; entryP++)
+		if (entryP->used && (SameKey(&(entryP->key), &exprKey) || SameKey(&(entryP->aliasKey), &exprKey)))
+			return &(entryP->tier);
+	return NULL;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FlushInternTable
+ *
+ * DESCRIPTION: Free the shared expressions, when they would no longer
+ *		compile to the same trees. The counters are kept.
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void FlushInternTable (void)
+{
+	InternEntry * entryP;
+
+	for (entryP = sInternTable; entryP < sInternTable + kInternTableSize; entryP++)
+		if (entryP->used)
+		{
+			DeleteTieredExpr(&(entryP->tier));
+			DeleteCompiledExpr(&(entryP->comp));
+		}
+	MemSet(sInternTable, sizeof(sInternTable), 0);
+	sInternStats.nEntries = 0;
+	sInternClock = 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetInternStats
+ *
+ * DESCRIPTION: Intern table lookups, hits and shared nodes since
+ *		started
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	intern stats
+ *
+ ***********************************************************************/
+
+InternStats * GetInternStats (void)
+{
+	return &sInternStats;
+}
@@ -0,0 +1,50 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcIntern.h
+ * 
+ * DESCRIPTION : Compiled expressions intern table headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCINTERN_H
+#define MEMOCALCINTERN_H
+
+// table size
+
+#define kInternTableSize	16		// expressions, the least recently used is evicted
+
+// structures
+
+typedef struct InternEntry {
+	CompiledExpr comp;		// canonical tree and the variables it refers to
+	TieredExpr tier;		// evaluations and tier of the tree
+	EvalKey key;			// tokens and variable names it was compiled from
+	EvalKey aliasKey;		// last other tokens compiled to the same tree
+	UInt32 hash;			// canonical tree hash
+	UInt32 lastUse;			// intern clock at the last use
+	UInt16 nNodes;
+	Boolean used;
+} InternEntry;
+
+typedef struct InternStats {
+	UInt32 nLookups;
+	UInt32 nHits;			// same tokens and variable names, compile avoided
+	UInt32 nCanonicalHits;	// other tokens compiled to the same canonical tree
+	UInt32 nEvictions;
+	UInt32 nodesShared;		// tree nodes of the canonical hits, not kept twice
+	UInt16 nEntries;
+} InternStats;
+
+// functions
+
+UInt8 InternExpr (Char * exprStr, VarList * varL, EvalKey * keyP, CompiledExpr ** compP);
+UInt8 EvalInternExpr (CompiledExpr * compP, double * resultP);
+TieredExpr * GetInternTier (Char * exprStr, VarList * varL);
+void FlushInternTable (void);
+InternStats * GetInternStats (void);
+
+#endif // MEMOCALCINTERN_H
@@ -19,6 +19,7 @@
 #include "MemoCalcFunctions.h"
 #include "MemoCalcLexer.h"
 #include "MemoCalcParser.h"
+#include "MemoCalcLibrary.h"
 
 /***********************************************************************
  *
@@ -38,10 +39,11 @@ enum {
 	qOpen			,	// read an open parenthesis
 	qClose			,	// read a close parenthesis
 	qOperator		,	// read an operator
-	qInvalidState
+	qInvalidState	,
+	qRef				// parsed an @reference to a memo title, last so qInvalidState keeps its value
 };
 
-#define dataState(q)		(q >= qInteger && q <= qName)
+#define dataState(q)		((q >= qInteger && q <= qName) || q == qRef)
 #define tokenState(q)		(q >= qOpen && q <= qOperator)
 
 /***********************************************************************
@@ -69,6 +71,8 @@ static UInt8 GetNextState (UInt8 q, Char c)
 				return qInteger;
 			if (isLetter(c)) 
 				return qName;
+			if (isRef(c))
+				return qRef;
 			if (isOpen(c)) 
 				return qOpen;
 			if (isOperator(c)) 
@@ -119,11 +123,24 @@ static UInt8 GetNextState (UInt8 q, Char c)
 				return qClose;
 		break;
 
+		// a title runs to the next operator or parenthesis, blanks included,
+		// on its line
+		case qRef:
+			if (isOperator(c)) 
+				return qOperator;
+			if (isClose(c)) 
+				return qClose;
+			if (!isOpen(c))
+				return qRef;
+		break;
+
 		case qOpen:
 			if (isNumber(c))
 				return qInteger;
 			if (isLetter(c)) 
 				return qName;
+			if (isRef(c))
+				return qRef;
 			if (isOpen(c)) 
 				return qOpen;
 			if (isOperator(c)) 
@@ -142,6 +159,8 @@ static UInt8 GetNextState (UInt8 q, Char c)
 				return qInteger;
 			if (isLetter(c)) 
 				return qName;
+			if (isRef(c))
+				return qRef;
 			if (isOpen(c)) 
 				return qOpen;
 			if (isOperator(c)) 
@@ -172,6 +191,7 @@ UInt8 TokenizeExpression (TokenList * tokL)
 	TokenCell * exprP, * lastP;
 	UInt16 iStart, iNext, iEnd;
 	UInt8 lastState, nextState;
+	Boolean newLine;
 
 	if (!tokL || !tokL->exprStr)
 		return qInvalidState ;
@@ -183,10 +203,14 @@ UInt8 TokenizeExpression (TokenList * tokL)
 	while (nextState != qStop && nextState != qInvalidState)
 	{
 		// eat separators
+		newLine = false;
 		while(isSeparator(tokL->exprStr[iNext]))
-			++iNext;
+			newLine |= tokL->exprStr[iNext++] == '\n';
 
 		nextState = GetNextState(lastState, tokL->exprStr[iNext]);
+		// a title ends at the end of its line
+		if (lastState == qRef && nextState == qRef && newLine)
+			nextState = qInvalidState;
 
 		// character at iStart begins the string value in exprStr
 		if (!dataState(lastState) && dataState(nextState))
@@ -198,6 +222,7 @@ UInt8 TokenizeExpression (TokenList * tokL)
 		{
 			exprP = MemPtrNew(sizeof(TokenCell));
 			exprP->nextP = NULL;
+			exprP->varP = NULL;
 			if (!lastP)
 				lastP = tokL->headP = exprP;
 			else 
@@ -213,6 +238,7 @@ UInt8 TokenizeExpression (TokenList * tokL)
 					exprP->token = tNumber;
 				break;
 				case qName:
+				case qRef:
 					exprP->token = tName;
 				break;
 			}
@@ -226,6 +252,7 @@ UInt8 TokenizeExpression (TokenList * tokL)
 		{
 			exprP = MemPtrNew(sizeof(TokenCell));
 			exprP->nextP = NULL;
+			exprP->varP = NULL;
 			if (!lastP)
 				lastP = tokL->headP = exprP;
 			else 
@@ -251,6 +278,308 @@ UInt8 TokenizeExpression (TokenList * tokL)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	ReadVarNumber 
+ *
+ * DESCRIPTION: Read a number in a vars declaration string, decimal
+ *		-?[0-9]+\.?[0-9]* or hexadecimal 0x[0-9A-Fa-f]*
+ *
+ * PARAMETERS:  vars string, index of the first char, updated to the
+ *		char following the number, value.
+ *
+ * RETURNED:	0 if no error occurred
+ *
+ ***********************************************************************/
+
+static UInt8 ReadVarNumber (Char * varsStr, UInt16 * iNextP, double * valueP)
+{
+	FlpCompDouble tmpF;
+	UInt16 iStart, iNext;
+	Char tmpC;
+
+	iStart = iNext = * iNextP;
+	if (varsStr[iNext] == '0' && (varsStr[iNext+1] == 'x' || varsStr[iNext+1] == 'X')) {
+		iNext += 2;
+		while (isHexNumber(varsStr[iNext]))
+			++iNext;
+	}
+	else {
+		if (varsStr[iNext] == '-')
+			++iNext;
+		if (!isNumber(varsStr[iNext]))
+			return parseError;
+		while (isNumber(varsStr[iNext]))
+			++iNext;
+		if (isDot(varsStr[iNext])) {
+			++iNext;
+			while (isNumber(varsStr[iNext]))
+				++iNext;
+		}
+	}
+
+	// set a temporary null char to read the number string
+	tmpC = varsStr[iNext];
+	varsStr[iNext] = nullChr;
+//	FlpBufferAToF(&(tmpF.fd), varsStr + iStart);
+	AToFlpCmpDbl(&tmpF, varsStr + iStart);
+	varsStr[iNext] = tmpC;
+
+	* valueP = tmpF.d;
+	* iNextP = iNext;
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ReadVarDistribution 
+ *
+ * DESCRIPTION: Read a distribution in a vars declaration string,
+ *		(normal|uniform)\s*\(\s*number\s*,\s*number\s*\)
+ *		The variable value is set to the distribution mean.
+ *
+ * PARAMETERS:  vars string, index of the first char, updated to the
+ *		char following the distribution, variable cell.
+ *
+ * RETURNED:	0 if no error occurred
+ *
+ ***********************************************************************/
+
+static UInt8 ReadVarDistribution (Char * varsStr, UInt16 * iNextP, VarCell * varP)
+{
+	UInt16 iNext = * iNextP;
+
+	if (StrNCompare(varsStr + iNext, kDistNormalName, StrLen(kDistNormalName)) == 0)
+	{
+		varP->distType = distNormal;
+		iNext += StrLen(kDistNormalName);
+	}
+	else if (StrNCompare(varsStr + iNext, kDistUniformName, StrLen(kDistUniformName)) == 0)
+	{
+		varP->distType = distUniform;
+		iNext += StrLen(kDistUniformName);
+	}
+	else
+		return parseError;
+
+	while(isSeparator(varsStr[iNext]))
+		++iNext;
+	if (!isOpen(varsStr[iNext]))
+		return parseError;
+	++iNext;
+	while(isSeparator(varsStr[iNext]))
+		++iNext;
+	if (ReadVarNumber(varsStr, &iNext, &(varP->distA)))
+		return parseError;
+	while(isSeparator(varsStr[iNext]))
+		++iNext;
+	if (varsStr[iNext] != ',')
+		return parseError;
+	++iNext;
+	while(isSeparator(varsStr[iNext]))
+		++iNext;
+	if (ReadVarNumber(varsStr, &iNext, &(varP->distB)))
+		return parseError;
+	while(isSeparator(varsStr[iNext]))
+		++iNext;
+	if (!isClose(varsStr[iNext]))
+		return parseError;
+	++iNext;
+
+	if (varP->distType == distNormal)
+		varP->value = varP->distA;
+	else
+		varP->value = (varP->distA + varP->distB) / 2;
+
+	* iNextP = iNext;
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	IsVarValueEnd 
+ *
+ * DESCRIPTION: Check a number is the whole value of a variable, and not
+ *		the start of a definition: it ends the line, or is followed
+ *		by blanks and the next variable name.
+ *
+ * PARAMETERS:  vars string, index of the char following the number
+ *
+ * RETURNED:	true if the value ends there
+ *
+ ***********************************************************************/
+
+static Boolean IsVarValueEnd (Char * varsStr, UInt16 iNext)
+{
+	UInt16 iStart = iNext;
+
+	while (varsStr[iNext] == ' ' || varsStr[iNext] == '\t')
+		++iNext;
+	if (!varsStr[iNext] || varsStr[iNext] == '\n' || varsStr[iNext] == 0x0d)
+		return true;
+	return iNext > iStart && isLetter(varsStr[iNext]);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ReadVarDefinition 
+ *
+ * DESCRIPTION: Read a variable defined by an expression of the other
+ *		variables, up to the end of the line. A null char is set at
+ *		the end of the expression, which is compiled when the variable
+ *		is referenced.
+ *
+ * PARAMETERS:  vars string, index of the first char, updated to the
+ *		next line, variable cell.
+ *
+ * RETURNED:	0 if no error occurred
+ *
+ ***********************************************************************/
+
+static UInt8 ReadVarDefinition (Char * varsStr, UInt16 * iNextP, VarCell * varP)
+{
+	UInt16 iStart, iNext, iEnd;
+
+	iStart = iNext = * iNextP;
+	while (varsStr[iNext] && varsStr[iNext] != '\n' && varsStr[iNext] != 0x0d)
+	{
+		// another declaration, the definition is missing
+		if (varsStr[iNext] == '=')
+			return parseError;
+		++iNext;
+	}
+	iEnd = iNext;
+	while (iEnd > iStart && (varsStr[iEnd-1] == ' ' || varsStr[iEnd-1] == '\t'))
+		--iEnd;
+	if (iEnd == iStart)
+		return parseError;
+
+	if (iEnd == iNext && varsStr[iNext])
+		++iNext;
+	varsStr[iEnd] = nullChr;
+	varP->defStr = varsStr + iStart;
+	* iNextP = iNext;
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SortVarDefinition 
+ *
+ * DESCRIPTION: Depth first visit of the variables a definition refers
+ *		to. Names followed by an open parenthesis are functions, and
+ *		names that are not variables are left to the compiler. The
+ *		definition is inserted in the list once all the definitions it
+ *		refers to are, so each one comes before its dependencies.
+ *		Definitions in a cycle, or referring to one, stay visiting and
+ *		are left out of the list.
+ *
+ * PARAMETERS:  variables list, variable defined by an expression
+ *
+ * RETURNED:	0 if no error occurred, cycleError if the definition
+ *		refers to itself through other variables
+ *
+ ***********************************************************************/
+
+static UInt8 SortVarDefinition (VarList * varL, VarCell * varP)
+{
+	VarCell * depP;
+	Char * defStr = varP->defStr;
+	UInt16 iStart, iNext = 0, iParen, len;
+	UInt8 err = 0;
+
+	if (varP->defState & varDefSorted)
+		return 0;
+	if (varP->defState & varDefVisiting)
+		return cycleError;
+	varP->defState |= varDefVisiting;
+
+	while (defStr[iNext] && !err)
+	{
+		// references to other memos are not variables
+		if (isRef(defStr[iNext]))
+		{
+			while (defStr[iNext] && defStr[iNext] != '\n'
+			&& !isOperator(defStr[iNext]) && !isOpen(defStr[iNext]) && !isClose(defStr[iNext]))
+				++iNext;
+			continue;
+		}
+		// numbers, hexadecimal ones included, are skipped as a whole
+		if (isNumber(defStr[iNext]) || isDot(defStr[iNext]))
+		{
+			while (isLetter(defStr[iNext]) || isNumber(defStr[iNext]) || isDot(defStr[iNext]))
+				++iNext;
+			continue;
+		}
+		if (!isLetter(defStr[iNext]))
+		{
+			++iNext;
+			continue;
+		}
+
+		iStart = iNext;
+		while (isLetter(defStr[iNext]) || isNumber(defStr[iNext]))
+			++iNext;
+		iParen = iNext;
+		while (isSeparator(defStr[iParen]))
+			++iParen;
+		if (isOpen(defStr[iParen]))
+			continue;
+
+		len = iNext - iStart;
+		for (depP = varL->headP; depP; depP = depP->nextP)
+			if (depP->defStr && StrLen(depP->name) == len
+			&& StrNCompare(depP->name, defStr + iStart, len) == 0)
+				err |= SortVarDefinition(varL, depP);
+	}
+	if (err)
+		return err;
+
+	varP->defState = varDefSorted;
+	varP->nextDefP = varL->defHeadP;
+	varL->defHeadP = varP;
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SortVarDefinitions 
+ *
+ * DESCRIPTION: Sort all the definitions of a variables list again, after
+ *		definitions were added to it. The definitions out of a cycle
+ *		are all sorted, the compiler reports a cycle only when an
+ *		expression refers to a definition left out.
+ *
+ * PARAMETERS:  variables list
+ *
+ * RETURNED:	0 if no error occurred, cycleError if definitions refer
+ *		to each other
+ *
+ ***********************************************************************/
+
+UInt8 SortVarDefinitions (VarList * varL)
+{
+	VarCell * varP;
+	UInt8 err = 0;
+
+	varL->defHeadP = NULL;
+	for (varP = varL->headP; varP; varP = varP->nextP)
+	{
+		varP->defState = 0;
+		varP->nextDefP = NULL;
+	}
+	for (varP = varL->headP; varP; varP = varP->nextP)
+		if (varP->defStr)
+			err |= SortVarDefinition(varL, varP);
+	return err;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	ParseVariables 
@@ -259,6 +588,12 @@ UInt8 TokenizeExpression (TokenList * tokL)
  *		variables declaration automata is simple enough there's no need
  *		for a transition function. The corresponding regexp is :
  *		[A-Za-z]+\s*\=\s*\-?\s+[0-9]+\.?[0-9]*
+ *		A variable can also be declared with a distribution for Monte
+ *		Carlo evaluation, see ReadVarDistribution :
+ *		[A-Za-z]+\s*\~\s*(normal|uniform)\(a,b\)
+ *		or defined by an expression up to the end of the line, see
+ *		ReadVarDefinition. Definitions are then sorted in dependency
+ *		order, cycles are only errors for the expressions reading them.
  *
  * PARAMETERS:  Pointer to a VarList structure. The vars string
  *		must be set, and the list empty.
@@ -273,10 +608,9 @@ UInt8 TokenizeExpression (TokenList * tokL)
 
 UInt8 ParseVariables (VarList * varL)
 {
-	FlpCompDouble tmpF;
 	VarCell * varP, * lastP;
 	UInt16 iStart, iNext, iEnd;
-	Char tmpC;
+	Char affectC;
 	UInt8 err = 0;
 
 	if (! varL->varsStr)
@@ -300,6 +634,14 @@ UInt8 ParseVariables (VarList * varL)
 		// add a new varCell
 		varP = MemPtrNew(sizeof(VarCell));
 		varP->nextP = NULL;
+		varP->index = varL->nVars++;
+		varP->distType = distNone;
+		varP->defStr = NULL;
+		varP->nextDefP = NULL;
+		varP->nextEvalP = NULL;
+		varP->defTreeP = NULL;
+		varP->defState = 0;
+		varP->defErr = 0;
 		if (!lastP)
 			lastP = varL->headP = varP;
 		else 
@@ -315,8 +657,9 @@ UInt8 ParseVariables (VarList * varL)
 		while(isSeparator(varL->varsStr[iNext]))
 			++iNext;
 
-		// check '=' for affectation
-		if (varL->varsStr[iNext] != '=')
+		// check '=' for affectation, '~' for a distribution
+		affectC = varL->varsStr[iNext];
+		if (affectC != '=' && affectC != '~')
 			break;
 		++iNext;
 		while(isSeparator(varL->varsStr[iNext]))
@@ -327,38 +670,29 @@ UInt8 ParseVariables (VarList * varL)
 		varP->name = varL->varsStr + iStart;
 
 		// read variable value
-		iStart = iNext;
-		if (varL->varsStr[iNext] == '0' && (varL->varsStr[iNext+1] == 'x' || varL->varsStr[iNext+1] == 'X')) {
-			iNext += 2;
-			while (isHexNumber(varL->varsStr[iNext]))
-				++iNext;
-		}
-		else {
-			if (varL->varsStr[iNext] == '-')
-				++iNext;
-			if (!isNumber(varL->varsStr[iNext]))
+		if (affectC == '~')
+		{
+			if (ReadVarDistribution(varL->varsStr, &iNext, varP))
 				break;
-			while (isNumber(varL->varsStr[iNext]))
-				++iNext;
-			if (isDot(varL->varsStr[iNext])) {
-				++iNext;
-				while (isNumber(varL->varsStr[iNext]))
-					++iNext;
+		}
+		else
+		{
+			iStart = iNext;
+			if (ReadVarNumber(varL->varsStr, &iNext, &(varP->value))
+			|| !IsVarValueEnd(varL->varsStr, iNext))
+			{
+				iNext = iStart;
+				varP->value = 0;
+				if (ReadVarDefinition(varL->varsStr, &iNext, varP))
+					break;
 			}
- 		}
-		iEnd = iNext;
-
-		// set a temporary null char to read the number string
-		tmpC = varL->varsStr[iEnd];
-		varL->varsStr[iEnd] = nullChr;
-//		FlpBufferAToF(&(tmpF.fd), varL->varsStr + iStart);
-		AToFlpCmpDbl(&tmpF, varL->varsStr + iStart);
-
-		varP->value = tmpF.d;
-		varL->varsStr[iEnd] = tmpC;
+		}
 
 		err = 0;
 	}
+
+	if (!err)
+		SortVarDefinitions(varL);
 	
 	// reset current cell and return end of buffer
 	varL->cellP = varL->headP;
@@ -422,17 +756,22 @@ UInt8 AssignTokenValue (TokenList * tokL, VarList * varL)
 					while (varL->cellP)
 					{
 						if (StrNCompare(varL->cellP->name, tokL->exprStr + tokL->cellP->data.indexPair.iStart,
-							1 + tokL->cellP->data.indexPair.iEnd - tokL->cellP->data.indexPair.iStart) == 0)
+							1 + tokL->cellP->data.indexPair.iEnd - tokL->cellP->data.indexPair.iStart) == 0
+						&& !varL->cellP->name[1 + tokL->cellP->data.indexPair.iEnd - tokL->cellP->data.indexPair.iStart])
 						{
 							tokL->cellP->data.value = varL->cellP->value;
+							tokL->cellP->varP = varL->cellP;
 							tokL->cellP->dataType |= mValue;
 							break;
 						}
 						varL->cellP = varL->cellP->nextP;
 					}
+					// names the memo does not declare are library or built-in constants
 					if (!(tokL->cellP->dataType & mValue))
 					{
-						if (GetConst(&(tokL->cellP->data.value), tokL->exprStr + tokL->cellP->data.indexPair.iStart,
+						if (GetLibraryConst(&(tokL->cellP->data.value), tokL->exprStr + tokL->cellP->data.indexPair.iStart,
+							1 + tokL->cellP->data.indexPair.iEnd - tokL->cellP->data.indexPair.iStart) == 0
+						|| GetConst(&(tokL->cellP->data.value), tokL->exprStr + tokL->cellP->data.indexPair.iStart,
 							1 + tokL->cellP->data.indexPair.iEnd - tokL->cellP->data.indexPair.iStart) == 0)
 							tokL->cellP->dataType = tConstant;
 						else
@@ -448,3 +787,61 @@ UInt8 AssignTokenValue (TokenList * tokL, VarList * varL)
 	return err;
 }
 
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetVarCell 
+ *
+ * DESCRIPTION: Find a variable by name in a parsed variables list
+ *
+ * PARAMETERS:  variables list, null terminated variable name.
+ *
+ * RETURNED:	variable cell, NULL if not found
+ *
+ ***********************************************************************/
+
+VarCell * GetVarCell (VarList * varL, Char * varName)
+{
+	VarCell * varP;
+
+	for (varP = varL->headP; varP; varP = varP->nextP)
+		if (StrCompare(varP->name, varName) == 0)
+			return varP;
+
+	return NULL;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	AddVarCell 
+ *
+ * DESCRIPTION: Append a variable to a parsed variables list, with a
+ *		null value and no definition
+ *
+ * PARAMETERS:  variables list, null terminated variable name, kept by
+ *		the cell.
+ *
+ * RETURNED:	new variable cell
+ *
+ ***********************************************************************/
+
+VarCell * AddVarCell (VarList * varL, Char * varName)
+{
+	VarCell * varP, * lastP;
+
+	varP = MemPtrNew(sizeof(VarCell));
+	MemSet(varP, sizeof(VarCell), 0);
+	varP->name = varName;
+	varP->index = varL->nVars++;
+	varP->distType = distNone;
+
+	for (lastP = varL->headP; lastP && lastP->nextP; lastP = lastP->nextP)
+		;
+	if (!lastP)
+		varL->headP = varP;
+	else
+		lastP->nextP = varP;
+	return varP;
+}
+
@@ -19,6 +19,10 @@
 #define missingVarError		0x02
 #define missingFuncError	0x04
 #define mathError			0x08
+#define noSolutionError		0x10
+#define overflowError		0x20	// fixed point result out of range
+#define cycleError			0x40	// variables defined in terms of each other
+#define memoryError			0x80	// dynamic heap exhausted
 
 // unassigned data masks
 
@@ -26,6 +30,7 @@
 #define mConstant  			0x02
 #define mVariable			0x10
 #define mFunction			0x20
+#define mInteger			0x40	// operator node evaluated on 64 bit integers
 
 // data types
 
@@ -37,10 +42,32 @@
 // tokens
 #define tName				(mConstant | mVariable | mFunction)
 
+// variable distributions
+
+#define distNone			0
+#define distNormal			1
+#define distUniform			2
+
+#define kDistNormalName		"normal"
+#define kDistUniformName	"uniform"
+
+// variable definition states
+
+#define varDefVisiting		0x01	// dependencies being sorted
+#define varDefSorted		0x02
+#define varDefUsed			0x04	// referenced by the expression being compiled
+#define varDefFree			0x08	// value set by the solver, the definition is not evaluated
+
 // atof, ftoa
 #define kFlpBufSize			80
 
 // types and structures
+typedef long long Int64Value;	// integer lane of bitwise operations
+typedef unsigned long long UInt64Value;
+
+// doubles converted to Int64Value without overflow, false for NaN
+#define isInt64Range(x)		((x) > -9.2e18 && (x) < 9.2e18)
+
 typedef union {
 	struct IndexPair {
 		UInt16 iStart;		// start index of token associated value in TokenList expression string
@@ -53,6 +80,7 @@ typedef union {
 
 typedef struct TokenCell {
 	struct TokenCell * nextP;	// next token in the list
+	struct VarCell * varP;		// variable cell for tVariable tokens
 	TokenData data;
 	UInt8 dataType;				// assigned or unassigned data
 	UInt8 token;				// token defined above or char matched (no associated value)
@@ -67,13 +95,26 @@ typedef struct TokenList {
 typedef struct VarCell {
 	struct VarCell * nextP;
 	Char * name;
-	double value;
+	double value;				// value, or distribution mean
+	double distA;				// normal mean, uniform lower bound
+	double distB;				// normal standard deviation, uniform upper bound
+	Char * defStr;				// defining expression, NULL for a value
+	struct VarCell * nextDefP;	// next definition in dependency order
+	struct VarCell * nextEvalP;	// next compiled definition, dependencies first
+	struct ExprNode * defTreeP;	// compiled definition, once referenced
+	UInt16 index;				// position in the list
+	UInt8 distType;				// distNone for a plain value
+	UInt8 defState;
+	UInt8 defErr;				// error of the definition at its last evaluation
 } VarCell;
 
 typedef struct VarList {
 	VarCell * headP;			// head of list
 	VarCell * cellP;			// current cell
+	VarCell * defHeadP;			// definitions, each before the ones it refers to
+	VarCell * evalHeadP;		// compiled definitions, each after the ones it refers to
 	Char * varsStr;				// variables declaration string
+	UInt16 nVars;				// number of cells in the list
 } VarList;
 
 
@@ -81,7 +122,10 @@ typedef struct VarList {
 
 UInt8 TokenizeExpression (TokenList * tokL);
 UInt8 ParseVariables (VarList * varL);
+UInt8 SortVarDefinitions (VarList * varL);
 UInt8 AssignTokenValue (TokenList * tokL, VarList * varL);
+VarCell * GetVarCell (VarList * varL, Char * varName);
+VarCell * AddVarCell (VarList * varL, Char * varName);
 
 // transitions
 
@@ -93,6 +137,7 @@ UInt8 AssignTokenValue (TokenList * tokL, VarList * varL);
 #define isDot(c)		(c == '.')
 #define isOpen(c)		(c == '(')
 #define isClose(c)		(c == ')')
+#define isRef(c)		(c == '@')
 #define isArithmetic(c)	(c == '+' || c == '-' || c == '*' || c == '/' || c == '^')
 #define isBoolean(c)	(c == '&' || c == '|' || c == '~')
 #define isOperator(c)	(isBoolean(c) || isArithmetic(c))
@@ -0,0 +1,230 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcLibrary.c
+ * 
+ * DESCRIPTION : Shared constants library for MemoCalc. The vars of the
+ *		memo titled kLibraryTitle are parsed once into a hash table,
+ *		which is not modified until the library memo is saved again.
+ *		Names a memo does not declare are looked up in the library
+ *		before the built-in constants, so the memo vars overlay the
+ *		library without copying it.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcLibrary.h"
+
+// globals
+static Char * sLibraryStr;			// parsed library vars, holding the names
+static LibraryConst * sLibraryP;	// open addressing table of sLibraryMask + 1 slots
+static UInt16 sLibraryMask;
+static UInt32 sLibrarySignature;
+static LibraryStats sLibraryStats;
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FindConstSlot
+ *
+ * DESCRIPTION: Find the slot of a name in the library table
+ *
+ * PARAMETERS:  name, length
+ *
+ * RETURNED:	slot of the name, or the free slot ending its probe
+ *
+ ***********************************************************************/
+
+static LibraryConst * FindConstSlot (Char * constName, UInt16 len)
+{
+	LibraryConst * slotP;
+	UInt16 index;
+
+	for (index = (UInt16) HashFnvBytes(kFnvOffset, constName, len) & sLibraryMask; ; index = (index + 1) & sLibraryMask)
+	{
+		slotP = sLibraryP + index;
+		if (!slotP->name
+		|| (StrNCompare(slotP->name, constName, len) == 0 && !slotP->name[len]))
+			return slotP;
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	LoadConstLibrary
+ *
+ * DESCRIPTION: Parse the library vars and hash them. Variables defined
+ *		by expressions are compiled on the parsed vars, each definition
+ *		once, then evaluated once in dependency order, and left out if
+ *		they do not compile or evaluate. The first declaration of a
+ *		name is kept.
+ *
+ * PARAMETERS:  library vars string
+ *
+ * RETURNED:	0 if no error, the previous library is unloaded anyway
+ *
+ ***********************************************************************/
+
+UInt8 LoadConstLibrary (Char * varsStr)
+{
+	ExprTree defT;
+	VarList varL;
+	VarCell * varP;
+	LibraryConst * slotP;
+	UInt32 hash = kFnvOffset;
+	UInt16 nSlots = 1;
+	UInt8 err = 0;
+
+	UnloadConstLibrary();
+	if (!varsStr)
+		return 0;
+
+	MemSet(&varL, sizeof(VarList), 0);
+	varL.varsStr = MemPtrNew(1 + StrLen(varsStr));
+	StrCopy(varL.varsStr, varsStr);
+	err |= ParseVariables(&varL);
+
+	// definitions first, the table is empty while they are compiled,
+	// a definition that does not compile keeps its error in the cell
+	for (varP = varL.headP; varP && !err; varP = varP->nextP)
+	{
+		if (!varP->defStr)
+			continue;
+		varP->defErr = CompileExprTree(varP->name, &varL, &defT);
+		DeleteNodes(defT.rootP);
+	}
+	if (!err)
+	{
+		EvalVarDefs(varL.evalHeadP);
+		while (nSlots < 2 * varL.nVars)
+			nSlots <<= 1;
+		sLibraryMask = nSlots - 1;
+		sLibraryP = MemPtrNew(nSlots * sizeof(LibraryConst));
+		MemSet(sLibraryP, nSlots * sizeof(LibraryConst), 0);
+		sLibraryStr = varL.varsStr;
+		varL.varsStr = NULL;
+	}
+	for (varP = varL.headP; varP && !err; varP = varP->nextP)
+	{
+		if (varP->defErr)
+			continue;
+		slotP = FindConstSlot(varP->name, StrLen(varP->name));
+		if (slotP->name)
+			continue;
+		slotP->name = varP->name;
+		slotP->value = varP->value;
+		sLibraryStats.nConsts++;
+		// cached trees hold the constants folded, their keys need the values
+		hash = HashFnvBytes(hash, varP->name, StrLen(varP->name) + 1);
+		hash = HashFnvBytes(hash, &(varP->value), sizeof(double));
+	}
+
+	DeleteVarList(&varL);
+	if (err)
+		return err;
+
+	sLibrarySignature = hash | 1;
+	sLibraryStats.nLoads++;
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	UnloadConstLibrary
+ *
+ * DESCRIPTION: Free the library, names are then built-in constants only
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void UnloadConstLibrary (void)
+{
+	if (sLibraryP)
+		MemPtrFree(sLibraryP);
+	if (sLibraryStr)
+		MemPtrFree(sLibraryStr);
+	sLibraryP = NULL;
+	sLibraryStr = NULL;
+	sLibraryMask = 0;
+	sLibrarySignature = 0;
+	sLibraryStats.nConsts = 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetLibraryConst
+ *
+ * DESCRIPTION: Look a name up in the library, same as GetConst
+ *
+ * PARAMETERS:  value, name, length
+ *
+ * RETURNED:	0 if found
+ *
+ ***********************************************************************/
+
+UInt8 GetLibraryConst (double * valueP, Char * constName, UInt16 len)
+{
+	LibraryConst * slotP;
+
+	if (!sLibraryP)
+		return 1;
+	sLibraryStats.nLookups++;
+	slotP = FindConstSlot(constName, len);
+	if (!slotP->name)
+		return 1;
+	sLibraryStats.nHits++;
+	* valueP = slotP->value;
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetLibrarySignature
+ *
+ * DESCRIPTION: Hash of the library names and values, for the keys of
+ *		cached results and trees
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	signature, 0 without library
+ *
+ ***********************************************************************/
+
+UInt32 GetLibrarySignature (void)
+{
+	return sLibrarySignature;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetLibraryStats
+ *
+ * DESCRIPTION: Library size and lookups since started
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	library stats
+ *
+ ***********************************************************************/
+
+LibraryStats * GetLibraryStats (void)
+{
+	return &sLibraryStats;
+}
@@ -0,0 +1,40 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcLibrary.h
+ * 
+ * DESCRIPTION : Shared constants library headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCLIBRARY_H
+#define MEMOCALCLIBRARY_H
+
+#define kLibraryTitle		"Constants"		// title of the library memo
+
+// structures
+
+typedef struct LibraryConst {
+	Char * name;			// NULL for a free slot
+	double value;
+} LibraryConst;
+
+typedef struct LibraryStats {
+	UInt32 nLookups;		// names looked up in the library
+	UInt32 nHits;
+	UInt16 nConsts;
+	UInt16 nLoads;			// library memo parsed since started
+} LibraryStats;
+
+// functions
+
+UInt8 LoadConstLibrary (Char * varsStr);
+void UnloadConstLibrary (void);
+UInt8 GetLibraryConst (double * valueP, Char * constName, UInt16 len);
+UInt32 GetLibrarySignature (void);
+LibraryStats * GetLibraryStats (void);
+
+#endif // MEMOCALCLIBRARY_H
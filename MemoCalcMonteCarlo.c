@@ -0,0 +1,424 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcMonteCarlo.c
+ * 
+ * DESCRIPTION : Monte Carlo simulation for MemoCalc. Variables declared
+ *		with a distribution are sampled, the expression is evaluated
+ *		a column of samples at a time, and the results are summarized
+ *		on the fly so that no sample needs to be kept.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MathLib.h"
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcBatch.h"
+#include "MemoCalcDispatch.h"
+#include "MemoCalcOptimizer.h"
+#include "MemoCalcMonteCarlo.h"
+
+extern UInt16 MathLibRef;
+
+#define kTwoPi			6.283185307179586476925286766559
+#define kTwoPow32		4294967296.0
+
+static const double quantileProbs[kMonteCarloQuantiles] = { 0.05, 0.5, 0.95 };
+
+// globals
+static BatchOptions sBatchOptions;	// precision of the sample columns
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MixBits
+ *
+ * DESCRIPTION: 32 bits integer hash, xor-shift / multiply rounds
+ *
+ * PARAMETERS:  value to hash
+ *
+ * RETURNED:	hashed value
+ *
+ ***********************************************************************/
+
+static UInt32 MixBits (UInt32 x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352dUL;
+	x ^= x >> 15;
+	x *= 0x846ca68bUL;
+	x ^= x >> 16;
+	return x;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	RandomUniform
+ *
+ * DESCRIPTION: Counter based random number. The draw only depends on
+ *		the seed, the stream and the sample number, so a simulation
+ *		gives the same results whatever the batch size.
+ *
+ * PARAMETERS:  seed, stream, sample number
+ *
+ * RETURNED:	uniform random number in ]0,1[
+ *
+ ***********************************************************************/
+
+static double RandomUniform (UInt32 seed, UInt16 stream, UInt32 counter)
+{
+	UInt32 key = MixBits(seed ^ MixBits((UInt32)stream + 1));
+
+	return ((double)MixBits(MixBits(counter ^ key) + key) + 0.5) / kTwoPow32;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FillSampleColumn
+ *
+ * DESCRIPTION: Draw the samples of a variable. Each variable uses two
+ *		streams, normal samples come from the Box-Muller transform.
+ *
+ * PARAMETERS:  variable cell, seed, first sample number, number of
+ *		samples, column.
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void FillSampleColumn (VarCell * varP, UInt32 seed, UInt32 counter, UInt16 nRows, double * columnP)
+{
+	double u1, u2;
+	UInt16 i;
+
+	for (i = 0; i < nRows; i++)
+	{
+		u1 = RandomUniform(seed, 2 * varP->index, counter + i);
+		if (varP->distType == distUniform)
+			columnP[i] = varP->distA + (varP->distB - varP->distA) * u1;
+		else
+		{
+			u2 = RandomUniform(seed, 2 * varP->index + 1, counter + i);
+			columnP[i] = varP->distA + varP->distB * sqrt(-2.0 * log(u1)) * cos(kTwoPi * u2);
+		}
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	P2QuantileInit
+ *
+ * DESCRIPTION: Prepare a P-square streaming quantile estimator
+ *		(R. Jain, I. Chlamtac, 1985)
+ *
+ * PARAMETERS:  estimator, quantile probability
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void P2QuantileInit (P2Quantile * quantP, double p)
+{
+	UInt16 i;
+
+	quantP->p = p;
+	for (i = 0; i < 5; i++)
+	{
+		quantP->q[i] = 0;
+		quantP->n[i] = i + 1;
+	}
+	quantP->np[0] = 1;
+	quantP->np[1] = 1 + 2 * p;
+	quantP->np[2] = 1 + 4 * p;
+	quantP->np[3] = 3 + 2 * p;
+	quantP->np[4] = 5;
+	quantP->dn[0] = 0;
+	quantP->dn[1] = p / 2;
+	quantP->dn[2] = p;
+	quantP->dn[3] = (1 + p) / 2;
+	quantP->dn[4] = 1;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	P2QuantileAdd
+ *
+ * DESCRIPTION: Add an observation to a P-square estimator. The first
+ *		five observations are kept sorted as the marker heights, the
+ *		following ones move the markers, with a piecewise parabolic
+ *		adjustment of the heights.
+ *
+ * PARAMETERS:  estimator, observation, number of observations so far
+ *		including this one
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void P2QuantileAdd (P2Quantile * quantP, double x, UInt32 count)
+{
+	double * q = quantP->q;
+	double * n = quantP->n;
+	double d, qp;
+	Int16 i, k;
+
+	if (count <= 5)
+	{
+		for (i = count - 1; i > 0 && q[i - 1] > x; i--)
+			q[i] = q[i - 1];
+		q[i] = x;
+		return;
+	}
+
+	if (x < q[0])
+	{
+		q[0] = x;
+		k = 0;
+	}
+	else if (x >= q[4])
+	{
+		q[4] = x;
+		k = 3;
+	}
+	else
+		for (k = 0; k < 3 && x >= q[k + 1]; k++)
+			;
+
+	for (i = k + 1; i < 5; i++)
+		n[i] += 1;
+	for (i = 0; i < 5; i++)
+		quantP->np[i] += quantP->dn[i];
+
+	for (i = 1; i < 4; i++)
+	{
+		d = quantP->np[i] - n[i];
+		if ((d >= 1 && n[i + 1] - n[i] > 1) || (d <= -1 && n[i - 1] - n[i] < -1))
+		{
+			d = d < 0 ? -1 : 1;
+			qp = q[i] + d / (n[i + 1] - n[i - 1])
+				* ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) / (n[i + 1] - n[i])
+				+ (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) / (n[i] - n[i - 1]));
+			if (q[i - 1] < qp && qp < q[i + 1])
+				q[i] = qp;
+			else
+				q[i] += d * (q[i + (Int16)d] - q[i]) / (n[i + (Int16)d] - n[i]);
+			n[i] += d;
+		}
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SetMonteCarloPrecision
+ *
+ * DESCRIPTION: Select the precision the samples are evaluated in. In
+ *		batchSingle the columns run on floats, and samples close to
+ *		the float range are evaluated again in double, so a sample
+ *		never fails in single precision only.
+ *
+ * PARAMETERS:  batchDouble or batchSingle
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void SetMonteCarloPrecision (UInt8 precision)
+{
+	MemSet(&sBatchOptions, sizeof(BatchOptions), 0);
+	sBatchOptions.precision = precision == batchSingle ? batchSingle : batchDouble;
+	sBatchOptions.recheck = batchRecheckOverflow;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MonteCarloEval
+ *
+ * DESCRIPTION: Monte Carlo simulation of a compiled expression. The
+ *		samples are evaluated in columns of the dispatch batch size,
+ *		mean and variance are accumulated with Welford's update and
+ *		the quantiles with P-square estimators, in constant memory.
+ *		The expression is first specialized on the variables without
+ *		distribution, so the columns only run the varying part, in
+ *		the precision set by SetMonteCarloPrecision.
+ *
+ * PARAMETERS:  Compiled expression, number of samples, seed, stats.
+ *
+ * RETURNED:	0 if some samples could be evaluated
+ *
+ ***********************************************************************/
+
+UInt8 MonteCarloEval (CompiledExpr * compP, UInt32 nSamples, UInt32 seed, MonteCarloStats * statsP)
+{
+	CompiledExpr spec;
+	double ** columnP = NULL;
+	double * resultP = NULL;
+	Boolean * freeP = NULL;
+	UInt8 * errP = NULL;
+	VarCell * varP;
+	double delta;
+	UInt32 iSample, count = 0;
+	UInt16 batchRows = GetEvalDispatch()->batchRows;
+	UInt16 i, j, nRows;
+	UInt8 err = 0, batchErr = 0;
+
+	MemSet(statsP, sizeof(MonteCarloStats), 0);
+	MemSet(&spec, sizeof(CompiledExpr), 0);
+	for (i = 0; i < kMonteCarloQuantiles; i++)
+		P2QuantileInit(&(statsP->quantiles[i]), quantileProbs[i]);
+
+	columnP = MemPtrNew((compP->varL.nVars + 1) * sizeof(double *));
+	MemSet(columnP, (compP->varL.nVars + 1) * sizeof(double *), 0);
+	freeP = MemPtrNew((compP->varL.nVars + 1) * sizeof(Boolean));
+	MemSet(freeP, (compP->varL.nVars + 1) * sizeof(Boolean), 0);
+	for (varP = compP->varL.headP; varP; varP = varP->nextP)
+	{
+		if (varP->distType == distNone)
+			continue;
+		freeP[varP->index] = true;
+		if (varP->distType == distNormal && !MathLibRef)
+		{
+			err |= missingFuncError;
+			goto CleanUp;
+		}
+		columnP[varP->index] = MemPtrNew(batchRows * sizeof(double));
+	}
+	err |= SpecializeExpr(compP, freeP, &spec);
+	if (err)
+		goto CleanUp;
+	resultP = MemPtrNew(batchRows * sizeof(double));
+	errP = MemPtrNew(batchRows * sizeof(UInt8));
+
+	for (iSample = 0; iSample < nSamples; iSample += nRows)
+	{
+		nRows = nSamples - iSample < batchRows ? nSamples - iSample : batchRows;
+		for (varP = compP->varL.headP; varP; varP = varP->nextP)
+			if (columnP[varP->index])
+				FillSampleColumn(varP, seed, iSample, nRows, columnP[varP->index]);
+		batchErr |= EvalExprBatchOptions(&spec, columnP, nRows, &sBatchOptions, resultP, errP);
+
+		for (i = 0; i < nRows; i++)
+		{
+			if (errP[i])
+			{
+				statsP->nErrors++;
+				continue;
+			}
+			count++;
+			delta = resultP[i] - statsP->mean;
+			statsP->mean += delta / count;
+			statsP->m2 += delta * (resultP[i] - statsP->mean);
+			if (count == 1 || resultP[i] < statsP->min)
+				statsP->min = resultP[i];
+			if (count == 1 || resultP[i] > statsP->max)
+				statsP->max = resultP[i];
+			for (j = 0; j < kMonteCarloQuantiles; j++)
+				P2QuantileAdd(&(statsP->quantiles[j]), resultP[i], count);
+		}
+	}
+	statsP->nSamples = nSamples;
+	if (!count)
+		err |= batchErr ? batchErr : mathError;
+
+CleanUp:
+	for (varP = compP->varL.headP; varP; varP = varP->nextP)
+		if (columnP[varP->index])
+			MemPtrFree(columnP[varP->index]);
+	MemPtrFree(columnP);
+	MemPtrFree(freeP);
+	DeleteNodes(spec.exprT.rootP);
+	if (resultP)
+		MemPtrFree(resultP);
+	if (errP)
+		MemPtrFree(errP);
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MonteCarlo
+ *
+ * DESCRIPTION: Compile an expression and run a Monte Carlo simulation
+ *
+ * PARAMETERS:  Expression, variables assignations, number of samples,
+ *		seed, stats.
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 MonteCarlo (Char * exprStr, Char * varsStr, UInt32 nSamples, UInt32 seed, MonteCarloStats * statsP)
+{
+	CompiledExpr comp;
+	UInt8 err = 0;
+
+	MemSet(statsP, sizeof(MonteCarloStats), 0);
+	err |= CompileExpr(exprStr, varsStr, &comp);
+	if (!err)
+		err |= MonteCarloEval(&comp, nSamples, seed, statsP);
+
+	DeleteCompiledExpr(&comp);
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MonteCarloStdDev
+ *
+ * DESCRIPTION: Sample standard deviation of a simulation
+ *
+ * PARAMETERS:  stats
+ *
+ * RETURNED:	standard deviation, 0 under two valid samples
+ *
+ ***********************************************************************/
+
+double MonteCarloStdDev (MonteCarloStats * statsP)
+{
+	UInt32 count = statsP->nSamples - statsP->nErrors;
+
+	if (count < 2 || !MathLibRef)
+		return 0;
+	return sqrt(statsP->m2 / (count - 1));
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MonteCarloQuantile
+ *
+ * DESCRIPTION: Quantile estimate of a simulation. Under five valid
+ *		samples the nearest sorted observation is returned.
+ *
+ * PARAMETERS:  stats, quantile index in 5%, 50%, 95%
+ *
+ * RETURNED:	quantile estimate
+ *
+ ***********************************************************************/
+
+double MonteCarloQuantile (MonteCarloStats * statsP, UInt16 iQuantile)
+{
+	P2Quantile * quantP = &(statsP->quantiles[iQuantile]);
+	UInt32 count = statsP->nSamples - statsP->nErrors;
+
+	if (!count)
+		return 0;
+	if (count < 5)
+		return quantP->q[(UInt16)(quantP->p * (count - 1) + 0.5)];
+	return quantP->q[2];
+}
@@ -0,0 +1,49 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcMonteCarlo.h
+ * 
+ * DESCRIPTION : Monte Carlo simulation headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCMONTECARLO_H
+#define MEMOCALCMONTECARLO_H
+
+// simulation settings
+
+#define kMonteCarloSamples		1000	// samples drawn from the UI
+#define kMonteCarloQuantiles	3		// 5%, 50%, 95%
+
+// structures
+
+typedef struct P2Quantile {
+	double p;			// quantile probability
+	double q[5];		// marker heights
+	double n[5];		// marker positions
+	double np[5];		// desired marker positions
+	double dn[5];		// desired positions increments
+} P2Quantile;
+
+typedef struct MonteCarloStats {
+	UInt32 nSamples;	// samples drawn
+	UInt32 nErrors;		// samples for which evaluation failed
+	double mean;
+	double m2;			// sum of squared deviations from the mean
+	double min;
+	double max;
+	P2Quantile quantiles[kMonteCarloQuantiles];
+} MonteCarloStats;
+
+// functions
+
+void SetMonteCarloPrecision (UInt8 precision);
+UInt8 MonteCarloEval (CompiledExpr * compP, UInt32 nSamples, UInt32 seed, MonteCarloStats * statsP);
+UInt8 MonteCarlo (Char * exprStr, Char * varsStr, UInt32 nSamples, UInt32 seed, MonteCarloStats * statsP);
+double MonteCarloStdDev (MonteCarloStats * statsP);
+double MonteCarloQuantile (MonteCarloStats * statsP, UInt16 iQuantile);
+
+#endif // MEMOCALCMONTECARLO_H
@@ -0,0 +1,599 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcMulti.c
+ * 
+ * DESCRIPTION : Multiple expressions memos for MemoCalc. Each line
+ *		starting with "name:" starts a named expression, which the
+ *		following expressions can refer to like a variable defined by
+ *		an expression. All of them are compiled on one variables list,
+ *		then their equal subtrees are merged into slots evaluated once
+ *		per pass, operands first, giving a vector of results.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MathLib.h"
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcIncremental.h"
+#include "MemoCalcMulti.h"
+
+extern UInt16 MathLibRef;
+
+// globals
+static MultiStats sMultiStats;
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetExprName
+ *
+ * DESCRIPTION: Find a "name:" at the start of a line
+ *
+ * PARAMETERS:  expressions string, index of the line, returned end of
+ *		the name and index of the separator
+ *
+ * RETURNED:	true if the line is named
+ *
+ ***********************************************************************/
+
+static Boolean GetExprName (Char * exprStr, UInt16 iLine, UInt16 * iEndP, UInt16 * iSepP)
+{
+	UInt16 iNext = iLine;
+
+	while (exprStr[iNext] == ' ' || exprStr[iNext] == '\t')
+		++iNext;
+	if (!isLetter(exprStr[iNext]))
+		return false;
+	while (isLetter(exprStr[iNext]) || isNumber(exprStr[iNext]))
+		++iNext;
+	* iEndP = iNext;
+	while (exprStr[iNext] == ' ' || exprStr[iNext] == '\t')
+		++iNext;
+	* iSepP = iNext;
+	return exprStr[iNext] == kMultiNameSep;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	IsMultiExpr
+ *
+ * DESCRIPTION: Check an expression text holds named expressions
+ *
+ * PARAMETERS:  expressions string
+ *
+ * RETURNED:	true if some line is named
+ *
+ ***********************************************************************/
+
+Boolean IsMultiExpr (Char * exprStr)
+{
+	UInt16 iLine = 0, iEnd, iSep;
+
+	while (exprStr && exprStr[iLine])
+	{
+		if (GetExprName(exprStr, iLine, &iEnd, &iSep))
+			return true;
+		while (exprStr[iLine] && exprStr[iLine] != '\n')
+			++iLine;
+		if (exprStr[iLine])
+			++iLine;
+	}
+	return false;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SplitMultiExpr
+ *
+ * DESCRIPTION: Cut the expressions copy at each named line, and add the
+ *		names to the variables list as definitions. Text before the
+ *		first name is an unnamed expression, unless blank.
+ *
+ * PARAMETERS:  multiple expressions, returned expression texts
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+static UInt8 SplitMultiExpr (MultiExpr * multiP, Char ** textsP)
+{
+	Char * exprStr = multiP->exprStr;
+	VarCell * varP;
+	UInt16 iLine = 0, iEnd, iSep;
+	UInt8 err = 0;
+
+	textsP[0] = exprStr;
+	while (isSeparator(* textsP[0]))
+		textsP[0]++;
+	multiP->nExprs = * textsP[0] && !GetExprName(exprStr, textsP[0] - exprStr, &iEnd, &iSep) ? 1 : 0;
+
+	while (exprStr[iLine] && !err)
+	{
+		if (GetExprName(exprStr, iLine, &iEnd, &iSep))
+		{
+			if (multiP->nExprs == kMultiMaxExprs)
+				return parseError;
+			if (iLine)
+				exprStr[iLine - 1] = nullChr;
+			exprStr[iEnd] = nullChr;
+			while (exprStr[iLine] == ' ' || exprStr[iLine] == '\t')
+				++iLine;
+			if (GetVarCell(&(multiP->varL), exprStr + iLine))
+				return parseError | missingVarError;
+
+			// the expression is a definition for the following ones
+			varP = AddVarCell(&(multiP->varL), exprStr + iLine);
+			varP->defStr = exprStr + iSep + 1;
+
+			multiP->namesP[multiP->nExprs] = varP->name;
+			textsP[multiP->nExprs++] = varP->defStr;
+			iLine = iSep + 1;
+		}
+		while (exprStr[iLine] && exprStr[iLine] != '\n')
+			++iLine;
+		if (exprStr[iLine])
+			++iLine;
+	}
+
+	// a cycle is the error of the expressions reading it
+	multiP->varL.cellP = multiP->varL.headP;
+	SortVarDefinitions(&(multiP->varL));
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	HashMultiNode
+ *
+ * DESCRIPTION: Hash a node with its operand slots. Leaves and integer
+ *		subtrees have no operands, their whole subtree is hashed.
+ *
+ * PARAMETERS:  hash, node, operand slots, number of operands
+ *
+ * RETURNED:	new hash
+ *
+ ***********************************************************************/
+
+static UInt32 HashMultiNode (UInt32 hash, ExprNode * nodeP, UInt16 * args, UInt8 nArgs)
+{
+	hash = HashFnvBytes(hash, &(nodeP->token), 1);
+	hash = HashFnvBytes(hash, &(nodeP->dataType), 1);
+	if (nodeP->varP)
+		hash = HashFnvBytes(hash, &(nodeP->varP->index), sizeof(UInt16));
+	else if (nodeP->token == '(' && nodeP->dataType & mFunction)
+		hash = HashFnvBytes(hash, &(nodeP->data.funcRef.func), sizeof(FuncType *));
+	else
+		hash = HashFnvBytes(hash, &(nodeP->data.value), sizeof(double));
+
+	if (nArgs)
+		return HashFnvBytes(hash, args, nArgs * sizeof(UInt16));
+	if (nodeP->leftP)
+		hash = HashMultiNode(hash, nodeP->leftP, NULL, 0);
+	if (nodeP->rightP)
+		hash = HashMultiNode(hash, nodeP->rightP, NULL, 0);
+	return hash;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SameMultiNodes
+ *
+ * DESCRIPTION: Compare two nodes, and their subtrees unless compared
+ *		through their operand slots
+ *
+ * PARAMETERS:  nodes, true to compare the subtrees
+ *
+ * RETURNED:	true if they evaluate the same
+ *
+ ***********************************************************************/
+
+static Boolean SameMultiNodes (ExprNode * node1P, ExprNode * node2P, Boolean subtrees)
+{
+	if (!node1P || !node2P)
+		return node1P == node2P;
+	if (node1P->token != node2P->token || node1P->dataType != node2P->dataType
+	|| node1P->varP != node2P->varP)
+		return false;
+	if (node1P->token == '(' && node1P->dataType & mFunction)
+	{
+		if (node1P->data.funcRef.func != node2P->data.funcRef.func)
+			return false;
+	}
+	else if (!node1P->varP && MemCmp(&(node1P->data.value), &(node2P->data.value), sizeof(double)))
+		return false;
+
+	return !subtrees || (SameMultiNodes(node1P->leftP, node2P->leftP, true)
+		&& SameMultiNodes(node1P->rightP, node2P->rightP, true));
+}
+
+
+static UInt16 AddMultiSlot (MultiExpr * multiP, ExprNode * nodeP, UInt16 * tableP, UInt16 mask);
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	AddMultiDefSlots
+ *
+ * DESCRIPTION: Add the slots of the definitions an integer subtree
+ *		reads, which it evaluates from their variable cells, so they
+ *		come before its own slot
+ *
+ * PARAMETERS:  multiple expressions, node, hash table of slot + 1,
+ *		hash mask
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void AddMultiDefSlots (MultiExpr * multiP, ExprNode * nodeP, UInt16 * tableP, UInt16 mask)
+{
+	if (!nodeP)
+		return;
+	if (nodeP->varP && nodeP->varP->defTreeP)
+		AddMultiSlot(multiP, nodeP, tableP, mask);
+	AddMultiDefSlots(multiP, nodeP->leftP, tableP, mask);
+	AddMultiDefSlots(multiP, nodeP->rightP, tableP, mask);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	AddMultiSlot
+ *
+ * DESCRIPTION: Add the slots of a subtree, operands first, sharing the
+ *		slot of an equal subtree found in the hash table. The leaf of
+ *		a defined variable is a slot reading the slot of its compiled
+ *		definition, added once for all the leaves.
+ *
+ * PARAMETERS:  multiple expressions, node, hash table of slot + 1,
+ *		hash mask
+ *
+ * RETURNED:	slot of the node
+ *
+ ***********************************************************************/
+
+static UInt16 AddMultiSlot (MultiExpr * multiP, ExprNode * nodeP, UInt16 * tableP, UInt16 mask)
+{
+	ExprNode * argsP[kIncrMaxArgs];
+	UInt16 args[kIncrMaxArgs];
+	MultiSlot * slotP;
+	VarCell * defP = NULL;
+	UInt32 hash;
+	UInt16 i, index;
+	UInt8 nArgs;
+
+	if (nodeP->varP && nodeP->varP->defTreeP)
+	{
+		defP = nodeP->varP;
+		if (multiP->defSlotsP[defP->index] != kNoIncrNode)
+			return multiP->defSlotsP[defP->index];
+		argsP[0] = defP->defTreeP;
+		nArgs = 1;
+	}
+	else if (!(nArgs = GetIncrArgs(nodeP, argsP)))
+		AddMultiDefSlots(multiP, nodeP, tableP, mask);
+	for (i = 0; i < nArgs; i++)
+		args[i] = AddMultiSlot(multiP, argsP[i], tableP, mask);
+	for (; i < kIncrMaxArgs; i++)
+		args[i] = kNoIncrNode;
+	multiP->nNodes++;
+
+	hash = HashMultiNode(kFnvOffset, nodeP, args, nArgs);
+	for (index = (UInt16) hash & mask; tableP[index]; index = (index + 1) & mask)
+	{
+		slotP = multiP->slotsP + tableP[index] - 1;
+		if (slotP->hash == hash && !MemCmp(slotP->args, args, sizeof(args))
+		&& SameMultiNodes(slotP->nodeP, nodeP, !nArgs))
+			return tableP[index] - 1;
+	}
+
+	slotP = multiP->slotsP + multiP->nSlots;
+	MemSet(slotP, sizeof(MultiSlot), 0);
+	slotP->nodeP = nodeP;
+	slotP->hash = hash;
+	MemMove(slotP->args, args, sizeof(args));
+	tableP[index] = ++multiP->nSlots;
+	if (defP)
+		multiP->defSlotsP[defP->index] = multiP->nSlots - 1;
+	return multiP->nSlots - 1;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CountMultiNodes
+ *
+ * DESCRIPTION: Number of evaluated nodes of a subtree
+ *
+ * PARAMETERS:  node
+ *
+ * RETURNED:	nodes count
+ *
+ ***********************************************************************/
+
+static UInt16 CountMultiNodes (ExprNode * nodeP)
+{
+	ExprNode * argsP[kIncrMaxArgs];
+	UInt16 count = 1;
+	UInt8 i, nArgs;
+
+	nArgs = GetIncrArgs(nodeP, argsP);
+	for (i = 0; i < nArgs; i++)
+		count += CountMultiNodes(argsP[i]);
+	return count;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CompileMultiExpr
+ *
+ * DESCRIPTION: Parse the variables once and compile the expressions on
+ *		them
+ *
+ * PARAMETERS:  expressions, variables assignations, multiple
+ *		expressions
+ *
+ * RETURNED:	0 if no error, the multiple expressions are then to be
+ *		deleted
+ *
+ ***********************************************************************/
+
+UInt8 CompileMultiExpr (Char * exprStr, Char * varsStr, MultiExpr * multiP)
+{
+	UInt8 err = 0;
+
+	MemSet(multiP, sizeof(MultiExpr), 0);
+	if (varsStr)
+	{
+		multiP->varL.varsStr = MemPtrNew(1 + StrLen(varsStr));
+		StrCopy(multiP->varL.varsStr, varsStr);
+	}
+
+	err |= ParseVariables(&(multiP->varL));
+	if (err)
+	{
+		DeleteMultiExpr(multiP);
+		return err;
+	}
+	return CompileMultiExprVars(exprStr, multiP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CompileMultiExprVars
+ *
+ * DESCRIPTION: Compile each expression on the variables already parsed
+ *		in multiP->varL, then share the common subexpressions of all
+ *		the trees. An expression that does not compile keeps its
+ *		error, the others are still evaluated.
+ *
+ * PARAMETERS:  expressions, multiple expressions
+ *
+ * RETURNED:	0 if no error, the multiple expressions are then to be
+ *		deleted, else they are deleted
+ *
+ ***********************************************************************/
+
+UInt8 CompileMultiExprVars (Char * exprStr, MultiExpr * multiP)
+{
+	Char * textsP[kMultiMaxExprs];
+	VarCell * varP;
+	UInt16 * tableP;
+	UInt16 i, nNodes = 0, mask = 1;
+	UInt8 err = 0;
+
+	if (!exprStr)
+		err |= parseError;
+	else
+	{
+		multiP->exprStr = MemPtrNew(1 + StrLen(exprStr));
+		StrCopy(multiP->exprStr, exprStr);
+		err |= SplitMultiExpr(multiP, textsP);
+	}
+	if (!err && !multiP->nExprs)
+		err |= parseError;
+	if (err)
+	{
+		DeleteMultiExpr(multiP);
+		return err;
+	}
+
+	for (i = 0; i < multiP->nExprs; i++)
+	{
+		multiP->compErrs[i] = CompileExprTree(textsP[i], &(multiP->varL), multiP->trees + i);
+		if (multiP->compErrs[i])
+		{
+			DeleteNodes(multiP->trees[i].rootP);
+			multiP->trees[i].rootP = multiP->trees[i].nodeP = NULL;
+		}
+		else
+			nNodes += CountMultiNodes(multiP->trees[i].rootP);
+	}
+	// each definition is one slot over its tree
+	for (varP = multiP->varL.evalHeadP; varP; varP = varP->nextEvalP)
+		nNodes += 1 + CountMultiNodes(varP->defTreeP);
+
+	// open addressing table, at most half full
+	while (mask < 2 * nNodes)
+		mask = (mask << 1) | 1;
+	tableP = MemPtrNew((mask + 1) * sizeof(UInt16));
+	multiP->slotsP = MemPtrNew((nNodes + 1) * sizeof(MultiSlot));
+	multiP->defSlotsP = MemPtrNew((multiP->varL.nVars + 1) * sizeof(UInt16));
+	if (!tableP || !multiP->slotsP || !multiP->defSlotsP)
+	{
+		if (tableP)
+			MemPtrFree(tableP);
+		DeleteMultiExpr(multiP);
+		return memoryError;
+	}
+	MemSet(tableP, (mask + 1) * sizeof(UInt16), 0);
+	for (i = 0; i <= multiP->varL.nVars; i++)
+		multiP->defSlotsP[i] = kNoIncrNode;
+	for (i = 0; i < multiP->nExprs; i++)
+		if (multiP->trees[i].rootP)
+			multiP->outSlots[i] = AddMultiSlot(multiP, multiP->trees[i].rootP, tableP, mask);
+	MemPtrFree(tableP);
+
+	sMultiStats.nExprs = multiP->nExprs;
+	sMultiStats.nNodes = multiP->nNodes;
+	sMultiStats.nSlots = multiP->nSlots;
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalMultiExpr
+ *
+ * DESCRIPTION: Evaluate every slot once, operands first, with the
+ *		operations and checks of the tree, and read the results
+ *
+ * PARAMETERS:  multiple expressions, results and errors vectors of
+ *		nExprs elements
+ *
+ * RETURNED:	errors of all the expressions
+ *
+ ***********************************************************************/
+
+UInt8 EvalMultiExpr (MultiExpr * multiP, double * resultsP, UInt8 * errsP)
+{
+	MultiSlot * slotP, * endP = multiP->slotsP + multiP->nSlots;
+	double args[kIncrMaxArgs];
+	UInt8 evalMode = GetEvalMode();
+	UInt16 i;
+	UInt8 err = 0;
+
+	for (slotP = multiP->slotsP; slotP < endP; slotP++)
+	{
+		if (slotP->args[0] == kNoIncrNode)
+		{
+			slotP->err = RecurseExprNode(slotP->nodeP, &(slotP->value));
+			continue;
+		}
+		slotP->err = 0;
+		for (i = 0; i < kIncrMaxArgs && slotP->args[i] != kNoIncrNode; i++)
+		{
+			if (!slotP->err)
+				slotP->err = multiP->slotsP[slotP->args[i]].err;
+			args[i] = multiP->slotsP[slotP->args[i]].value;
+		}
+		if (slotP->nodeP->varP)
+		{
+			// a definition, also read from its cell by integer subtrees
+			slotP->value = args[0];
+			slotP->nodeP->varP->value = slotP->err ? 0 : args[0];
+			slotP->nodeP->varP->defErr = slotP->err;
+		}
+		else if (!slotP->err)
+			slotP->err = EvalIncrOp(slotP->nodeP, args, evalMode, &(slotP->value));
+	}
+
+	for (i = 0; i < multiP->nExprs; i++)
+	{
+		resultsP[i] = 0;
+		errsP[i] = multiP->compErrs[i];
+		if (!errsP[i])
+		{
+			slotP = multiP->slotsP + multiP->outSlots[i];
+			resultsP[i] = slotP->value;
+			errsP[i] = slotP->err;
+			if (!errsP[i] && evalMode == evalCheckDeferred && isNonFinite(resultsP[i]))
+				errsP[i] |= mathError;
+		}
+		err |= errsP[i];
+	}
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetMultiCompiledExpr
+ *
+ * DESCRIPTION: The expression of a memo text offset, as a compiled
+ *		expression for the engines of single expressions, the other
+ *		named expressions being its definitions. It shares the trees
+ *		and variables of the multiple expressions, and is not deleted,
+ *		the multiple expressions are.
+ *
+ * PARAMETERS:  multiple expressions, offset in the expressions text,
+ *		returned compiled expression
+ *
+ * RETURNED:	compile error of the expression
+ *
+ ***********************************************************************/
+
+UInt8 GetMultiCompiledExpr (MultiExpr * multiP, UInt16 offset, CompiledExpr * compP)
+{
+	UInt16 i, iExpr = 0;
+
+	for (i = 0; i < multiP->nExprs; i++)
+		if (multiP->namesP[i] && multiP->namesP[i] - multiP->exprStr <= offset)
+			iExpr = i;
+	MemSet(compP, sizeof(CompiledExpr), 0);
+	compP->varL = multiP->varL;
+	compP->exprT = multiP->trees[iExpr];
+	return multiP->trees[iExpr].rootP ? 0 : multiP->compErrs[iExpr] | parseError;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	DeleteMultiExpr
+ *
+ * DESCRIPTION: Free the trees, slots and variables
+ *
+ * PARAMETERS:  multiple expressions
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void DeleteMultiExpr (MultiExpr * multiP)
+{
+	UInt16 i;
+
+	for (i = 0; i < kMultiMaxExprs; i++)
+		DeleteNodes(multiP->trees[i].rootP);
+	if (multiP->slotsP)
+		MemPtrFree(multiP->slotsP);
+	if (multiP->defSlotsP)
+		MemPtrFree(multiP->defSlotsP);
+	DeleteVarList(&(multiP->varL));
+	if (multiP->exprStr)
+		MemPtrFree(multiP->exprStr);
+	MemSet(multiP, sizeof(MultiExpr), 0);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetMultiStats
+ *
+ * DESCRIPTION: Expressions and shared nodes of the last memo compiled
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	multiple expressions stats
+ *
+ ***********************************************************************/
+
+MultiStats * GetMultiStats (void)
+{
+	return &sMultiStats;
+}
@@ -0,0 +1,59 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcMulti.h
+ * 
+ * DESCRIPTION : Multiple expressions memos headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCMULTI_H
+#define MEMOCALCMULTI_H
+
+#define kMultiMaxExprs		16
+#define kMultiNameSep		':'		// name: expression
+
+// structures
+
+typedef struct MultiSlot {
+	ExprNode * nodeP;		// first of the equal subtrees
+	double value;
+	UInt32 hash;
+	UInt16 args[kIncrMaxArgs];	// operand slots, kNoIncrNode after the last one
+	UInt8 err;
+} MultiSlot;
+
+typedef struct MultiExpr {
+	VarList varL;			// variables, then the named expressions as definitions
+	Char * exprStr;			// copy of the expressions, names and texts null terminated
+	Char * namesP[kMultiMaxExprs];	// NULL for an unnamed first expression
+	ExprTree trees[kMultiMaxExprs];
+	UInt16 outSlots[kMultiMaxExprs];	// result slot of each expression
+	UInt8 compErrs[kMultiMaxExprs];	// compile error of each expression
+	MultiSlot * slotsP;		// distinct subtrees, operands first
+	UInt16 * defSlotsP;		// slot of each definition by variable index, kNoIncrNode if none
+	UInt16 nSlots;
+	UInt16 nNodes;			// evaluated nodes before sharing
+	UInt16 nExprs;
+} MultiExpr;
+
+typedef struct MultiStats {
+	UInt16 nExprs;			// expressions of the last memo compiled
+	UInt16 nNodes;
+	UInt16 nSlots;			// nodes left once the common subexpressions are shared
+} MultiStats;
+
+// functions
+
+Boolean IsMultiExpr (Char * exprStr);
+UInt8 CompileMultiExpr (Char * exprStr, Char * varsStr, MultiExpr * multiP);
+UInt8 CompileMultiExprVars (Char * exprStr, MultiExpr * multiP);
+UInt8 EvalMultiExpr (MultiExpr * multiP, double * resultsP, UInt8 * errsP);
+UInt8 GetMultiCompiledExpr (MultiExpr * multiP, UInt16 offset, CompiledExpr * compP);
+void DeleteMultiExpr (MultiExpr * multiP);
+MultiStats * GetMultiStats (void);
+
+#endif // MEMOCALCMULTI_H
@@ -0,0 +1,928 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcOptimizer.c
+ * 
+ * DESCRIPTION : Expression tree rewriting for MemoCalc. Constant
+ *		subtrees are folded, grouping parentheses dropped, and costly
+ *		operations replaced by cheaper equivalents once at compile time.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MathLib.h"
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcOptimizer.h"
+#include "MemoCalcCache.h"
+#include "MemoCalcIncremental.h"
+#include "MemoCalcBytecode.h"
+#include "MemoCalcIntern.h"
+
+extern UInt16 MathLibRef;
+
+// structures
+typedef struct PolyTerm {
+	ExprNode * coefP;	// coefficient subtree, independent of the variable
+	Int16 degree;
+	Boolean negative;
+} PolyTerm;
+
+// globals
+static UInt8 sOptimizeFlags = optimizeExact;
+
+// constant leaves, variable leaves keep their cell value which can change
+#define isConstNode(n)		((n)->token == tNumber || ((n)->token == tName && (n)->dataType == tConstant))
+#define isLeafNode(n)		(!(n)->leftP && !(n)->rightP)
+#define isConstValue(n,v)	(isConstNode(n) && (n)->data.value == (v))
+// finite test that does not need MathLib
+#define isFinite(x)			((x) == (x) && (x) - (x) == 0)
+// constant exactly held by the 64 bit integer lane
+#define isIntConst(n)		(isConstNode(n) && isInt64Range((n)->data.value) \
+							&& (n)->data.value == (double)(Int64Value)(n)->data.value)
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	IsPowerOfTwo
+ *
+ * DESCRIPTION: Check that a constant and its reciprocal are exact
+ *		powers of two, so that dividing by it or multiplying by its
+ *		reciprocal give the same bits.
+ *
+ * PARAMETERS:  constant
+ *
+ * RETURNED:	true if x is +/- 2^n
+ *
+ ***********************************************************************/
+
+static Boolean IsPowerOfTwo (double x)
+{
+	if (x < 0)
+		x = -x;
+	if (x == 0 || !isFinite(x) || !isFinite(1 / x))
+		return false;
+	while (x >= 2)
+		x /= 2;
+	while (x < 1)
+		x *= 2;
+	return x == 1;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ReplaceNode
+ *
+ * DESCRIPTION: Release a node and the subtree that is not kept
+ *
+ * PARAMETERS:  node, subtree taking its place
+ *
+ * RETURNED:	the kept subtree
+ *
+ ***********************************************************************/
+
+static ExprNode * ReplaceNode (ExprNode * nodeP, ExprNode * keptP)
+{
+	if (nodeP->leftP != keptP)
+		DeleteNodes(nodeP->leftP);
+	if (nodeP->rightP != keptP)
+		DeleteNodes(nodeP->rightP);
+	MemPtrFree(nodeP);
+	return keptP;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FoldConstNode
+ *
+ * DESCRIPTION: Evaluate a node whose operands are all constant. The
+ *		evaluation runs the same operations the tree would, so the
+ *		folded value is exact. Nodes that fail or give a non finite
+ *		value are kept, for the error to show at evaluation time.
+ *
+ * PARAMETERS:  node
+ *
+ * RETURNED:	number node, or the node unchanged
+ *
+ ***********************************************************************/
+
+static ExprNode * FoldConstNode (ExprNode * nodeP)
+{
+	double value;
+
+	if ((nodeP->leftP && !isConstNode(nodeP->leftP))
+	|| (nodeP->rightP && !isConstNode(nodeP->rightP))
+	|| RecurseExprNode(nodeP, &value)
+	|| !isFinite(value))
+		return nodeP;
+
+	DeleteNodes(nodeP->leftP);
+	DeleteNodes(nodeP->rightP);
+	nodeP->leftP = nodeP->rightP = NULL;
+	nodeP->varP = NULL;
+	nodeP->data.value = value;
+	nodeP->dataType = tNumber;
+	nodeP->token = tNumber;
+	return nodeP;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ReducePowerNode
+ *
+ * DESCRIPTION: Strength reduction of x ^ constant. x^1 is x, other
+ *		integral exponents are specialized into a tIntPower node, which
+ *		squares as '^' does at runtime without testing the exponent.
+ *		x^0.5 is sqrt(x), which rounds differently from pow.
+ *
+ * PARAMETERS:  '^' node
+ *
+ * RETURNED:	rewritten node
+ *
+ ***********************************************************************/
+
+static ExprNode * ReducePowerNode (ExprNode * nodeP)
+{
+	double n;
+
+	if (!isConstNode(nodeP->rightP))
+		return nodeP;
+	n = nodeP->rightP->data.value;
+
+	if (n == 1)
+		return ReplaceNode(nodeP, nodeP->leftP);
+
+	if (isIntPower(n))
+	{
+		DeleteNodes(nodeP->rightP);
+		nodeP->rightP = NULL;
+		nodeP->data.value = n;
+		nodeP->token = tIntPower;
+	}
+	else if (n == 0.5 && MathLibRef && !(sOptimizeFlags & optimizeExact))
+	{
+		DeleteNodes(nodeP->rightP);
+		nodeP->rightP = NULL;
+		GetSqrtFunc(&(nodeP->data.funcRef));
+		nodeP->dataType = tFunction;
+		nodeP->token = '(';
+	}
+
+	return nodeP;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	OptimizeNode
+ *
+ * DESCRIPTION: Rewrite a subtree, operands first.
+ *		- grouping '(' nodes are dropped, function calls are kept
+ *		- constant operations are folded
+ *		- x ^ constant is specialized, see ReducePowerNode
+ *		- x / c becomes x * (1/c), in exact mode for c = 2^n only
+ *		- x * 1, 1 * x, x / 1, x - 0 become x, and x + 0, 0 + x too
+ *		unless in exact mode, since -0 + 0 is +0.
+ *
+ * PARAMETERS:  node
+ *
+ * RETURNED:	rewritten node
+ *
+ ***********************************************************************/
+
+static ExprNode * OptimizeNode (ExprNode * nodeP)
+{
+	Boolean exact = (sOptimizeFlags & optimizeExact) != 0;
+
+	if (!nodeP)
+		return NULL;
+	nodeP->leftP = OptimizeNode(nodeP->leftP);
+	nodeP->rightP = OptimizeNode(nodeP->rightP);
+
+	if (nodeP->token == '(' && !(nodeP->dataType & mFunction))
+		return ReplaceNode(nodeP, nodeP->leftP);
+
+	if (!isLeafNode(nodeP))
+		nodeP = FoldConstNode(nodeP);
+
+	switch (nodeP->token)
+	{
+		case '^':
+			nodeP = ReducePowerNode(nodeP);
+		break;
+
+		case '/':
+			if (isConstNode(nodeP->rightP) && nodeP->rightP->data.value != 0
+			&& isFinite(1 / nodeP->rightP->data.value)
+			&& (!exact || IsPowerOfTwo(nodeP->rightP->data.value)))
+			{
+				nodeP->rightP->data.value = 1 / nodeP->rightP->data.value;
+				nodeP->rightP->dataType = nodeP->rightP->token = tNumber;
+				nodeP->token = '*';
+			}
+			else
+				break;
+			// then check x * 1
+
+		case '*':
+			if (isConstValue(nodeP->rightP, 1))
+				nodeP = ReplaceNode(nodeP, nodeP->leftP);
+			else if (isConstValue(nodeP->leftP, 1))
+				nodeP = ReplaceNode(nodeP, nodeP->rightP);
+		break;
+
+		case '-':
+			if (isConstValue(nodeP->rightP, 0))
+				nodeP = ReplaceNode(nodeP, nodeP->leftP);
+		break;
+
+		case '+':
+			if (exact)
+				break;
+			if (isConstValue(nodeP->rightP, 0))
+				nodeP = ReplaceNode(nodeP, nodeP->leftP);
+			else if (isConstValue(nodeP->leftP, 0))
+				nodeP = ReplaceNode(nodeP, nodeP->rightP);
+		break;
+	}
+
+	return nodeP;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CopyNodes
+ *
+ * DESCRIPTION: Duplicate an expression subtree
+ *
+ * PARAMETERS:  node
+ *
+ * RETURNED:	new subtree
+ *
+ ***********************************************************************/
+
+static ExprNode * CopyNodes (ExprNode * nodeP)
+{
+	ExprNode * copyP;
+
+	if (!nodeP)
+		return NULL;
+	copyP = NewExprNode(NULL, NULL, 0, 0, 0);
+	MemMove(copyP, nodeP, sizeof(ExprNode));
+	copyP->leftP = CopyNodes(nodeP->leftP);
+	copyP->rightP = CopyNodes(nodeP->rightP);
+	return copyP;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CountOps
+ *
+ * DESCRIPTION: Number of operations evaluating a subtree, counting the
+ *		multiplications of a tIntPower node.
+ *
+ * PARAMETERS:  node
+ *
+ * RETURNED:	operations count
+ *
+ ***********************************************************************/
+
+static UInt16 CountOps (ExprNode * nodeP)
+{
+	UInt16 nOps = 0, m;
+
+	if (!nodeP || isLeafNode(nodeP))
+		return 0;
+	if (nodeP->token == tIntPower)
+	{
+		m = nodeP->data.value < 0 ? -nodeP->data.value : nodeP->data.value;
+		for (nOps = nodeP->data.value < 0 ? 1 : 0; m; m >>= 1)
+			nOps += (m & 1) + (m > 1);
+	}
+	else
+		nOps = 1;
+	return nOps + CountOps(nodeP->leftP) + CountOps(nodeP->rightP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	DependsOn
+ *
+ * DESCRIPTION: Check if a subtree reads a variable
+ *
+ * PARAMETERS:  node, variable cell
+ *
+ * RETURNED:	true if a leaf of the subtree is the variable
+ *
+ ***********************************************************************/
+
+static Boolean DependsOn (ExprNode * nodeP, VarCell * varP)
+{
+	if (!nodeP)
+		return false;
+	if (isLeafNode(nodeP))
+		return nodeP->varP == varP;
+	return DependsOn(nodeP->leftP, varP) || DependsOn(nodeP->rightP, varP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	TermDegree
+ *
+ * DESCRIPTION: Degree of a product in a variable. The factors must be
+ *		the variable, the variable to a positive integral power, or
+ *		not depend on the variable.
+ *
+ * PARAMETERS:  product node, variable cell
+ *
+ * RETURNED:	degree, -1 if not a monomial of the variable
+ *
+ ***********************************************************************/
+
+static Int16 TermDegree (ExprNode * nodeP, VarCell * varP)
+{
+	Int16 leftDegree, rightDegree;
+
+	if (!DependsOn(nodeP, varP))
+		return 0;
+	if (isLeafNode(nodeP))
+		return 1;
+	if (nodeP->token == tIntPower && isLeafNode(nodeP->leftP) && nodeP->data.value > 0)
+		return (Int16)nodeP->data.value;
+	if (nodeP->token != '*')
+		return -1;
+	leftDegree = TermDegree(nodeP->leftP, varP);
+	rightDegree = TermDegree(nodeP->rightP, varP);
+	if (leftDegree < 0 || rightDegree < 0)
+		return -1;
+	return leftDegree + rightDegree;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckPolyTerms
+ *
+ * DESCRIPTION: Check a sum is a polynomial of a variable, find its
+ *		degree and number of terms.
+ *
+ * PARAMETERS:  sum node, variable cell, degree, number of terms
+ *
+ * RETURNED:	true if a polynomial of at most kMaxPolyTerms terms
+ *
+ ***********************************************************************/
+
+static Boolean CheckPolyTerms (ExprNode * nodeP, VarCell * varP, Int16 * degreeP, UInt16 * nTermsP)
+{
+	Int16 degree;
+
+	if (nodeP->token == '+' || nodeP->token == '-')
+		return CheckPolyTerms(nodeP->leftP, varP, degreeP, nTermsP)
+			&& CheckPolyTerms(nodeP->rightP, varP, degreeP, nTermsP);
+
+	degree = TermDegree(nodeP, varP);
+	if (degree < 0 || ++(* nTermsP) > kMaxPolyTerms)
+		return false;
+	if (degree > * degreeP)
+		* degreeP = degree;
+	return true;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FindPolyVar
+ *
+ * DESCRIPTION: Find a variable a sum is a polynomial of, of degree 2
+ *		at least. The variables of the leaves are tried in order, so
+ *		a*x*x + b*x is found in x after a failed in a.
+ *
+ * PARAMETERS:  sum node, subtree whose leaves are tried
+ *
+ * RETURNED:	variable cell, NULL if none
+ *
+ ***********************************************************************/
+
+static VarCell * FindPolyVar (ExprNode * sumP, ExprNode * nodeP)
+{
+	VarCell * varP;
+	Int16 degree = 0;
+	UInt16 nTerms = 0;
+
+	if (!nodeP)
+		return NULL;
+	if (isLeafNode(nodeP))
+	{
+		if (nodeP->varP && CheckPolyTerms(sumP, nodeP->varP, &degree, &nTerms) && degree >= 2)
+			return nodeP->varP;
+		return NULL;
+	}
+	varP = FindPolyVar(sumP, nodeP->leftP);
+	return varP ? varP : FindPolyVar(sumP, nodeP->rightP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ExtractCoef
+ *
+ * DESCRIPTION: Release the variable factors of a monomial
+ *
+ * PARAMETERS:  monomial node, variable cell
+ *
+ * RETURNED:	product of the other factors, NULL for 1
+ *
+ ***********************************************************************/
+
+static ExprNode * ExtractCoef (ExprNode * nodeP, VarCell * varP)
+{
+	ExprNode * leftP, * rightP;
+
+	if (!DependsOn(nodeP, varP))
+		return nodeP;
+	if (nodeP->token != '*')
+	{
+		DeleteNodes(nodeP);
+		return NULL;
+	}
+	leftP = ExtractCoef(nodeP->leftP, varP);
+	rightP = ExtractCoef(nodeP->rightP, varP);
+	MemPtrFree(nodeP);
+	if (!leftP)
+		return rightP;
+	if (!rightP)
+		return leftP;
+	return NewExprNode(leftP, rightP, 0, 0, '*');
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CollectPolyTerms
+ *
+ * DESCRIPTION: Split a sum into its monomials, releasing the '+' and
+ *		'-' nodes. Monomials of the same degree are added up, the
+ *		terms are kept sorted by decreasing degree.
+ *
+ * PARAMETERS:  sum node, sign, variable cell, terms, number of terms
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void CollectPolyTerms (ExprNode * nodeP, Boolean negative, VarCell * varP, PolyTerm * termP, UInt16 * nTermsP)
+{
+	ExprNode * coefP;
+	Int16 degree;
+	UInt16 i, j;
+
+	if (nodeP->token == '+' || nodeP->token == '-')
+	{
+		CollectPolyTerms(nodeP->leftP, negative, varP, termP, nTermsP);
+		CollectPolyTerms(nodeP->rightP, nodeP->token == '-' ? !negative : negative, varP, termP, nTermsP);
+		MemPtrFree(nodeP);
+		return;
+	}
+
+	degree = TermDegree(nodeP, varP);
+	coefP = ExtractCoef(nodeP, varP);
+	if (!coefP)
+		coefP = NewExprNode(NULL, NULL, 1, tNumber, tNumber);
+
+	for (i = 0; i < * nTermsP && termP[i].degree > degree; i++)
+		;
+	if (i < * nTermsP && termP[i].degree == degree)
+	{
+		// same degree, c1 +/- c2 keeps the sign of c1
+		termP[i].coefP = NewExprNode(termP[i].coefP, coefP, 0, 0, termP[i].negative == negative ? '+' : '-');
+		termP[i].coefP = FoldConstNode(termP[i].coefP);
+		return;
+	}
+	for (j = * nTermsP; j > i; j--)
+		termP[j] = termP[j - 1];
+	termP[i].coefP = coefP;
+	termP[i].degree = degree;
+	termP[i].negative = negative;
+	(* nTermsP)++;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MultiplyByPower
+ *
+ * DESCRIPTION: Build accumulator * variable ^ n
+ *
+ * PARAMETERS:  accumulator node, variable cell, power
+ *
+ * RETURNED:	product node
+ *
+ ***********************************************************************/
+
+static ExprNode * MultiplyByPower (ExprNode * accP, VarCell * varP, Int16 n)
+{
+	ExprNode * powerP;
+
+	powerP = NewExprNode(NULL, NULL, 0, tVariable, tName);
+	powerP->varP = varP;
+	if (n > 1)
+		powerP = NewExprNode(powerP, NULL, n, 0, tIntPower);
+	if (isConstValue(accP, 1))
+		return ReplaceNode(accP, powerP);
+	return NewExprNode(accP, powerP, 0, 0, '*');
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	BuildHorner
+ *
+ * DESCRIPTION: Rewrite a polynomial in Horner form, from a copy of its
+ *		sum. The degree gaps between terms are filled with integral
+ *		powers of the variable.
+ *		c3 x^3 + c2 x^2 - c0 => ((c3 x + c2) x) x - c0
+ *
+ * PARAMETERS:  sum node, variable cell
+ *
+ * RETURNED:	Horner form subtree
+ *
+ ***********************************************************************/
+
+static ExprNode * BuildHorner (ExprNode * nodeP, VarCell * varP)
+{
+	PolyTerm terms[kMaxPolyTerms];
+	ExprNode * accP;
+	UInt16 nTerms = 0, i;
+
+	CollectPolyTerms(CopyNodes(nodeP), false, varP, terms, &nTerms);
+
+	accP = terms[0].coefP;
+	if (terms[0].negative)
+	{
+		if (isConstNode(accP))
+		{
+			accP->data.value = -accP->data.value;
+			accP->dataType = accP->token = tNumber;
+		}
+		else
+			accP = NewExprNode(NewExprNode(NULL, NULL, 0, tNumber, tNumber), accP, 0, 0, '-');
+	}
+	for (i = 1; i < nTerms; i++)
+	{
+		accP = MultiplyByPower(accP, varP, terms[i - 1].degree - terms[i].degree);
+		accP = NewExprNode(accP, terms[i].coefP, 0, 0, terms[i].negative ? '-' : '+');
+	}
+	if (terms[nTerms - 1].degree)
+		accP = MultiplyByPower(accP, varP, terms[nTerms - 1].degree);
+	return accP;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	HornerNode
+ *
+ * DESCRIPTION: Look for polynomials of one variable from the top of
+ *		the tree down, and rewrite them in Horner form when this saves
+ *		operations. The coefficients of a rewritten polynomial are
+ *		then looked at, they can be polynomials of another variable.
+ *		The saved operations are added to the stats.
+ *
+ * PARAMETERS:  node, stats of the tree
+ *
+ * RETURNED:	rewritten node
+ *
+ ***********************************************************************/
+
+static ExprNode * HornerNode (ExprNode * nodeP, OptimizeStats * statsP)
+{
+	ExprNode * hornerP;
+	VarCell * varP;
+	UInt16 nOps, nHornerOps;
+
+	if (!nodeP || isLeafNode(nodeP))
+		return nodeP;
+
+	if ((nodeP->token == '+' || nodeP->token == '-')
+	&& (varP = FindPolyVar(nodeP, nodeP)) != NULL)
+	{
+		hornerP = BuildHorner(nodeP, varP);
+		nOps = CountOps(nodeP);
+		nHornerOps = CountOps(hornerP);
+		if (nHornerOps < nOps)
+		{
+			statsP->nPolynomials++;
+			statsP->opsSaved += nOps - nHornerOps;
+			DeleteNodes(nodeP);
+			nodeP = hornerP;
+		}
+		else
+			DeleteNodes(hornerP);
+	}
+
+	nodeP->leftP = HornerNode(nodeP->leftP, statsP);
+	nodeP->rightP = HornerNode(nodeP->rightP, statsP);
+	return nodeP;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	TypeIntNode
+ *
+ * DESCRIPTION: Type inference of integer operations. Bitwise operations
+ *		always give integers, sums and differences give integers when
+ *		both operands do. These nodes are typed mInteger, and their
+ *		subtree is evaluated on 64 bit integers instead of converting
+ *		every intermediate result back and forth. Such a result may
+ *		not round to the double the tree gives, so in exact mode only
+ *		bitwise operations of operands evaluated on doubles are typed.
+ *
+ * PARAMETERS:  node, stats of the tree
+ *
+ * RETURNED:	true if the subtree gives an integer
+ *
+ ***********************************************************************/
+
+static Boolean TypeIntNode (ExprNode * nodeP, OptimizeStats * statsP)
+{
+	Boolean exact = (sOptimizeFlags & optimizeExact) != 0;
+	Boolean leftInt, rightInt;
+
+	if (!nodeP)
+		return false;
+	if (isLeafNode(nodeP))
+		return isIntConst(nodeP);
+
+	leftInt = TypeIntNode(nodeP->leftP, statsP);
+	rightInt = TypeIntNode(nodeP->rightP, statsP);
+	switch (nodeP->token)
+	{
+		case '&':
+		case '|':
+		case '~':
+			if (exact && ((nodeP->leftP && nodeP->leftP->dataType & mInteger)
+			|| (nodeP->rightP && nodeP->rightP->dataType & mInteger)))
+				return true;
+		break;
+
+		case '+':
+		case '-':
+			if (leftInt && rightInt && !exact)
+				break;
+			// fall through, a sum of doubles stays a double
+		default:
+			return false;
+	}
+
+	nodeP->dataType |= mInteger;
+	statsP->nIntNodes++;
+	return true;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ContractNode
+ *
+ * DESCRIPTION: Combine a*b+c, c+a*b and a*b-c into multiply-add
+ *		nodes, evaluated in one step instead of two. This saves a node
+ *		visit, not a rounding: the product is rounded before the
+ *		addition as on separate nodes, so the results are the same bits.
+ *
+ * PARAMETERS:  node, stats of the tree
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void ContractNode (ExprNode * nodeP, OptimizeStats * statsP)
+{
+	ExprNode * swapP;
+
+	if (!nodeP || isLeafNode(nodeP))
+		return;
+	ContractNode(nodeP->leftP, statsP);
+	ContractNode(nodeP->rightP, statsP);
+
+	if (nodeP->token == '+' && nodeP->leftP->token != '*' && nodeP->rightP->token == '*')
+	{
+		swapP = nodeP->leftP;
+		nodeP->leftP = nodeP->rightP;
+		nodeP->rightP = swapP;
+	}
+	if ((nodeP->token == '+' || nodeP->token == '-') && nodeP->leftP->token == '*')
+	{
+		nodeP->token = nodeP->token == '+' ? tMulAdd : tMulSub;
+		statsP->nContractions++;
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SpecializeNode
+ *
+ * DESCRIPTION: Copy a subtree, replacing the bound variables by their
+ *		current value and folding the subtrees that read no free
+ *		variable. Subtrees that fail or give a non finite value are
+ *		kept, so the error shows when the copy is evaluated.
+ *
+ * PARAMETERS:  node, free variables flags indexed by variable index,
+ *		set to true if the copy reads a free variable
+ *
+ * RETURNED:	new subtree
+ *
+ ***********************************************************************/
+
+static ExprNode * SpecializeNode (ExprNode * nodeP, Boolean * freeP, Boolean * isFreeP)
+{
+	ExprNode * specP;
+	Boolean leftFree = false, rightFree = false;
+	double value;
+
+	* isFreeP = false;
+	if (!nodeP)
+		return NULL;
+
+	if (isLeafNode(nodeP))
+	{
+		if (nodeP->varP && freeP[nodeP->varP->index])
+			* isFreeP = true;
+		else if (nodeP->varP && !nodeP->varP->defErr)
+			return NewExprNode(NULL, NULL, nodeP->varP->value, tNumber, tNumber);
+		return CopyNodes(nodeP);
+	}
+
+	specP = NewExprNode(NULL, NULL, 0, 0, 0);
+	MemMove(specP, nodeP, sizeof(ExprNode));
+	specP->leftP = SpecializeNode(nodeP->leftP, freeP, &leftFree);
+	specP->rightP = SpecializeNode(nodeP->rightP, freeP, &rightFree);
+	* isFreeP = leftFree || rightFree;
+
+	// a multiply-add whose product was folded is a plain sum
+	if ((specP->token == tMulAdd || specP->token == tMulSub) && isLeafNode(specP->leftP))
+		specP->token = specP->token == tMulAdd ? '+' : '-';
+
+	if (!* isFreeP && !RecurseExprNode(specP, &value) && isFinite(value))
+	{
+		DeleteNodes(specP);
+		specP = NewExprNode(NULL, NULL, value, tNumber, tNumber);
+	}
+	return specP;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SetOptimizeFlags
+ *
+ * DESCRIPTION: Select the rewrites OptimizeExprTree may apply. With
+ *		optimizeExact the optimized tree gives the same bits and the
+ *		same errors as the parsed one, otherwise results may differ in
+ *		the last bits. Cached results
+ *		and shared trees of the previous flags are flushed. The default
+ *		is optimizeExact, so memos give the same results as before the
+ *		optimizer.
+ *
+ * PARAMETERS:  optimizer flags
+ *
+ * RETURNED:	previous flags
+ *
+ ***********************************************************************/
+
+UInt8 SetOptimizeFlags (UInt8 flags)
+{
+	UInt8 prevFlags = sOptimizeFlags;
+
+	if (flags != sOptimizeFlags)
+	{
+		FlushEvalCache();
+		FlushInternTable();
+	}
+	sOptimizeFlags = flags;
+	return prevFlags;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	OptimizeExprTree
+ *
+ * DESCRIPTION: Rewrite an expression tree for evaluation. Unless in
+ *		exact mode, polynomials are then put in Horner form, which
+ *		rounds differently. Integer operations are typed, and
+ *		multiply-add patterns are finally combined.
+ *
+ * PARAMETERS:  expression tree
+ *
+ * RETURNED:	0
+ *
+ ***********************************************************************/
+
+UInt8 OptimizeExprTree (ExprTree * exprT)
+{
+	MemSet(&(exprT->stats), sizeof(OptimizeStats), 0);
+	exprT->rootP = OptimizeNode(exprT->rootP);
+	if (!(sOptimizeFlags & optimizeExact))
+		exprT->rootP = HornerNode(exprT->rootP, &(exprT->stats));
+	TypeIntNode(exprT->rootP, &(exprT->stats));
+	ContractNode(exprT->rootP, &(exprT->stats));
+	exprT->nodeP = exprT->rootP;
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetOptimizeFlags
+ *
+ * DESCRIPTION: Current optimizer flags, which compiled trees depend on
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	optimizer flags
+ *
+ ***********************************************************************/
+
+UInt8 GetOptimizeFlags (void)
+{
+	return sOptimizeFlags;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ReadsFreeVar
+ *
+ * DESCRIPTION: Tell if a subtree reads a free variable
+ *
+ * PARAMETERS:  expression node, free variables flags
+ *
+ * RETURNED:	true if some leaf reads a free variable
+ *
+ ***********************************************************************/
+
+static Boolean ReadsFreeVar (ExprNode * nodeP, Boolean * freeP)
+{
+	if (!nodeP)
+		return false;
+	if (nodeP->varP && freeP[nodeP->varP->index])
+		return true;
+	return ReadsFreeVar(nodeP->leftP, freeP) || ReadsFreeVar(nodeP->rightP, freeP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SpecializeExpr
+ *
+ * DESCRIPTION: Partial evaluation of a compiled expression. Variables
+ *		not flagged free are bound to their current value and every
+ *		subtree depending only on them is folded, leaving a smaller
+ *		tree over the free variables. A definition reading a free
+ *		variable is flagged free too, and evaluated with the
+ *		specialized expression. The specialized expression shares the
+ *		variable list of compP, and is released with
+ *		DeleteNodes(specP->exprT.rootP) before compP is deleted.
+ *
+ * PARAMETERS:  compiled expression, free variables flags indexed by
+ *		variable index, extended with the definitions, specialized
+ *		expression
+ *
+ * RETURNED:	parseError if there is no tree to specialize
+ *
+ ***********************************************************************/
+
+UInt8 SpecializeExpr (CompiledExpr * compP, Boolean * freeP, CompiledExpr * specP)
+{
+	VarCell * varP;
+	Boolean isFree;
+
+	MemSet(specP, sizeof(CompiledExpr), 0);
+	if (!compP->exprT.rootP)
+		return parseError;
+	EvalVarDefs(compP->exprT.defsP);
+	for (varP = compP->exprT.defsP; varP; varP = varP->nextEvalP)
+		if (ReadsFreeVar(varP->defTreeP, freeP))
+			freeP[varP->index] = true;
+	specP->varL = compP->varL;
+	specP->exprT.defsP = compP->exprT.defsP;
+	specP->exprT.rootP = specP->exprT.nodeP = SpecializeNode(compP->exprT.rootP, freeP, &isFree);
+	specP->exprT.stats = compP->exprT.stats;
+	return 0;
+}
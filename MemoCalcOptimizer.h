@@ -0,0 +1,31 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcOptimizer.h
+ * 
+ * DESCRIPTION : Expression tree rewriting headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCOPTIMIZER_H
+#define MEMOCALCOPTIMIZER_H
+
+// optimizer flags
+
+#define optimizeExact		0x01	// only rewrites giving bit identical results and errors
+
+// rewriting limits
+
+#define kMaxPolyTerms		16		// terms of a polynomial put in Horner form
+
+// functions
+
+UInt8 SetOptimizeFlags (UInt8 flags);
+UInt8 GetOptimizeFlags (void);
+UInt8 OptimizeExprTree (ExprTree * exprT);
+UInt8 SpecializeExpr (CompiledExpr * compP, Boolean * freeP, CompiledExpr * specP);
+
+#endif // MEMOCALCOPTIMIZER_H
@@ -19,6 +19,11 @@
 #include "MemoCalcFunctions.h"
 #include "MemoCalcLexer.h"
 #include "MemoCalcParser.h"
+#include "MemoCalcOptimizer.h"
+#include "MemoCalcCache.h"
+#include "MemoCalcIncremental.h"
+#include "MemoCalcBytecode.h"
+#include "MemoCalcIntern.h"
 
 extern UInt16 MathLibRef;
 
@@ -28,23 +33,13 @@ extern UInt16 MathLibRef;
  *
  ***********************************************************************/
 
-// structures
+// globals
+static UInt8 sEvalMode = evalCheckDeferred;
 
-typedef struct ExprNode {
-	struct ExprNode * leftP;
-	struct ExprNode * rightP;
-	TokenData data;
-	UInt8 dataType;   // value for leaf nodes, funcRef or NULL for '(' nodes
-	UInt8 token;
-} ExprNode;
-
-typedef struct ExprTree {
-	ExprNode * rootP;
-	ExprNode * nodeP;
-} ExprTree;
-
-// functions
-static ExprNode * NewExprNode(ExprNode * leftP, ExprNode * rightP, double value, UInt8 dataType, UInt8 token);
+// In deferred mode a non finite value is only looked for where an operation
+// could turn it back into a finite one (x/inf, pow(inf,0), tanh(inf), casts)
+// and on the final result. Everywhere else NaN and Inf propagate up the tree.
+#define isAbsorbedNonFinite(x)	(sEvalMode == evalCheckDeferred && isNonFinite(x))
 
 
 /***********************************************************************
@@ -199,6 +194,7 @@ static UInt8 ruleN (TokenList * tokL, ExprTree * exprT)
 			if (tokL->cellP->dataType & (mConstant | mVariable))
 			{
 				exprT->nodeP = NewExprNode(NULL, NULL, tokL->cellP->data.value, tokL->cellP->dataType, tokL->cellP->token);
+				exprT->nodeP->varP = tokL->cellP->varP;
 				tokL->cellP = tokL->cellP->nextP;
 				break;
 			}
@@ -246,12 +242,13 @@ static UInt8 ruleN (TokenList * tokL, ExprTree * exprT)
  *
  ***********************************************************************/
 
-static ExprNode * NewExprNode(ExprNode * leftP, ExprNode * rightP, double value, UInt8 dataType, UInt8 token)
+ExprNode * NewExprNode(ExprNode * leftP, ExprNode * rightP, double value, UInt8 dataType, UInt8 token)
 {
 	ExprNode * nodeP;
 	nodeP = MemPtrNew(sizeof(ExprNode));
 	nodeP->leftP = leftP;
 	nodeP->rightP = rightP;
+	nodeP->varP = NULL;
 	nodeP->data.value = value;
 	nodeP->dataType = dataType;
 	nodeP->token = token;
@@ -350,6 +347,117 @@ UInt8 BuildExprTree (TokenList * tokL, ExprTree * exprT)
 }
 
 
+/***********************************************************************
+ *
+ * FUNCTION:	RecurseIntNode
+ *
+ * DESCRIPTION: Evaluates a subtree typed mInteger by the optimizer on
+ *		64 bit integers. Its other operands are evaluated as doubles
+ *		and converted once, where the types change. An operand out of
+ *		the Int64Value range, or a sum overflowing it, clears the range
+ *		flag and the subtree is to be evaluated on doubles instead.
+ *
+ * PARAMETERS:  Expression node, result, range flag.
+ *
+ * RETURNED:	result
+ *
+ ***********************************************************************/
+
+static UInt8 RecurseIntNode (ExprNode * nodeP, Int64Value * resultP, Boolean * inRangeP)
+{
+	Int64Value left, right;
+	double value;
+	UInt8 err = 0;
+
+	if (!(nodeP->dataType & mInteger))
+	{
+		if (!(err |= RecurseExprNode(nodeP, &value)))
+		{
+			if (isNonFinite(value))
+				err |= mathError;
+			else if (!isInt64Range(value))
+				* inRangeP = false;
+			else
+				* resultP = (Int64Value) value;
+		}
+		return err;
+	}
+
+	if (nodeP->token == '~')
+	{
+		if (!(err |= RecurseIntNode(nodeP->rightP, &right, inRangeP)))
+			* resultP = ~right;
+		return err;
+	}
+
+	if (!((err |= RecurseIntNode(nodeP->leftP, &left, inRangeP)) || (err |= RecurseIntNode(nodeP->rightP, &right, inRangeP)))
+	&& * inRangeP)
+	{
+		switch (nodeP->token)
+		{
+			case '&':
+				* resultP = left & right;
+			break;
+
+			case '|':
+				* resultP = left | right;
+			break;
+
+			// wrapped on unsigned, overflowed if the sign is wrong
+			case '+':
+				* resultP = (Int64Value) ((UInt64Value)left + (UInt64Value)right);
+				if ((left < 0) == (right < 0) && (* resultP < 0) != (left < 0))
+					* inRangeP = false;
+			break;
+
+			case '-':
+				* resultP = (Int64Value) ((UInt64Value)left - (UInt64Value)right);
+				if ((left < 0) != (right < 0) && (* resultP < 0) != (left < 0))
+					* inRangeP = false;
+			break;
+		}
+	}
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalBitwiseOp
+ *
+ * DESCRIPTION: Applies '&', '|' or '~' to doubles on 64 bit integers,
+ *		the left operand unused for '~'. An operand out of the
+ *		Int64Value range, NaN or Inf, is a math error: every engine
+ *		converts through here.
+ *
+ * PARAMETERS:  token, left and right operands, result.
+ *
+ * RETURNED:	error code
+ *
+ ***********************************************************************/
+
+UInt8 EvalBitwiseOp (UInt8 token, double left, double right, double * resultP)
+{
+	if (!isInt64Range(right) || (token != '~' && !isInt64Range(left)))
+		return mathError;
+	switch (token)
+	{
+		case '&':
+			* resultP = (double) ((Int64Value)left & (Int64Value)right);
+		break;
+
+		case '|':
+			* resultP = (double) ((Int64Value)left | (Int64Value)right);
+		break;
+
+		case '~':
+			* resultP = (double) (~(Int64Value)right);
+		break;
+	}
+	return 0;
+}
+
+
 /***********************************************************************
  *
  * FUNCTION:	RecurseExprNode 
@@ -364,9 +472,23 @@ UInt8 BuildExprTree (TokenList * tokL, ExprTree * exprT)
 
 UInt8 RecurseExprNode (ExprNode * nodeP, double * resultP)
 {
+	Int64Value intValue;
 	double left, right;
+	Boolean inRange = true;
 	UInt8 err = 0;
 
+	if (nodeP->dataType & mInteger)
+	{
+		err |= RecurseIntNode(nodeP, &intValue, &inRange);
+		if (err || inRange)
+		{
+			if (!err)
+				* resultP = (double) intValue;
+			return err;
+		}
+		// out of the integer range, evaluated on doubles as written
+	}
+
 	switch (nodeP->token)
 	{
 		case tNumber:
@@ -374,7 +496,12 @@ UInt8 RecurseExprNode (ExprNode * nodeP, double * resultP)
 		break;
 
 		case tName:
-			if (nodeP->dataType & mValue)
+			if (nodeP->varP)
+			{
+				* resultP = nodeP->varP->value;
+				err |= nodeP->varP->defErr;
+			}
+			else if (nodeP->dataType & mValue)
 				* resultP = nodeP->data.value;
 			else
 				err |= missingVarError;
@@ -384,10 +511,12 @@ UInt8 RecurseExprNode (ExprNode * nodeP, double * resultP)
 			if (!(err |= RecurseExprNode(nodeP->leftP, resultP))
 			&& nodeP->dataType & mFunction)
 			{
-				if (nodeP->dataType == tFunction)
-					* resultP = nodeP->data.funcRef.func(* resultP);
-				else
+				if (nodeP->dataType != tFunction)
 					err |= missingFuncError;
+				else if (isAbsorbedNonFinite(* resultP))
+					err |= mathError;
+				else
+					* resultP = nodeP->data.funcRef.func(* resultP);
 			}
 		break;
 
@@ -408,33 +537,62 @@ UInt8 RecurseExprNode (ExprNode * nodeP, double * resultP)
 
 		case '/':
 			if (!((err |= RecurseExprNode(nodeP->leftP, &left)) || (err |= RecurseExprNode(nodeP->rightP, &right))))
-				* resultP = left / right;
+			{
+				if (isAbsorbedNonFinite(right))
+					err |= mathError;
+				else
+					* resultP = left / right;
+			}
 		break;
 
 		case '&':
-			if (!((err |= RecurseExprNode(nodeP->leftP, &left)) || (err |= RecurseExprNode(nodeP->rightP, &right))))
-				* resultP = (double) ((Int32)left & (Int32)right);
-		break;
-
 		case '|':
 			if (!((err |= RecurseExprNode(nodeP->leftP, &left)) || (err |= RecurseExprNode(nodeP->rightP, &right))))
-				* resultP = (double) ((Int32)left | (Int32)right);
+				err |= EvalBitwiseOp(nodeP->token, left, right, resultP);
 		break;
 
 		case '~':
 			if (!(err |= RecurseExprNode(nodeP->rightP, &right)))
-				* resultP = (double) (~(Int32)right);
+				err |= EvalBitwiseOp('~', 0, right, resultP);
 		break;
 
 		case '^':
-			if (!MathLibRef)
-				err |= missingFuncError;
-			else if (!((err |= RecurseExprNode(nodeP->leftP, &left)) || (err |= RecurseExprNode(nodeP->rightP, &right))))
-				* resultP = pow(left, right);
+			if (!((err |= RecurseExprNode(nodeP->leftP, &left)) || (err |= RecurseExprNode(nodeP->rightP, &right))))
+			{
+				if (isAbsorbedNonFinite(left) || isAbsorbedNonFinite(right))
+					err |= mathError;
+				else if (isIntPower(right))
+					* resultP = IntPower(left, (Int16)right);
+				else if (!MathLibRef)
+					err |= missingFuncError;
+				else
+					* resultP = pow(left, right);
+			}
+		break;
+
+		case tIntPower:
+			if (!(err |= RecurseExprNode(nodeP->leftP, &left)))
+			{
+				if (isAbsorbedNonFinite(left))
+					err |= mathError;
+				else
+					* resultP = IntPower(left, (Int16)nodeP->data.value);
+			}
+		break;
+
+		case tMulAdd:
+		case tMulSub:
+			if (!((err |= RecurseExprNode(nodeP->leftP->leftP, &left))
+			|| (err |= RecurseExprNode(nodeP->leftP->rightP, &right))))
+			{
+				left *= right;
+				if (!(err |= RecurseExprNode(nodeP->rightP, &right)))
+					* resultP = nodeP->token == tMulAdd ? left + right : left - right;
+			}
 		break;
 	}
 
-	if (MathLibRef && (isnan(* resultP) || isinf(* resultP)))
+	if (sEvalMode == evalCheckEachNode && isNonFinite(* resultP))
 		err |= mathError;
 	return err ;
 }
@@ -444,7 +602,8 @@ UInt8 RecurseExprNode (ExprNode * nodeP, double * resultP)
  *
  * FUNCTION:	EvalExprTree 
  *
- * DESCRIPTION: Evaluates an expression tree.
+ * DESCRIPTION: Evaluates an expression tree, after the definitions
+ *		it reads.
  *
  * PARAMETERS:  Expression tree, result.
  *
@@ -454,10 +613,87 @@ UInt8 RecurseExprNode (ExprNode * nodeP, double * resultP)
 
 UInt8 EvalExprTree (ExprTree * exprT, double * resultP)
 {
+	UInt8 err = 0;
+
 	if (!exprT->rootP)
 		return parseError;
 
-	return RecurseExprNode(exprT->rootP, resultP);
+	EvalVarDefs(exprT->defsP);
+	err |= RecurseExprNode(exprT->rootP, resultP);
+	if (!err && sEvalMode == evalCheckDeferred && isNonFinite(* resultP))
+		err |= mathError;
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ExprNodeDepth
+ *
+ * DESCRIPTION: Depth of an expression subtree, the addend of a
+ *		multiply-add node counting one more level, for the evaluators
+ *		keeping a work area per level
+ *
+ * PARAMETERS:  Expression node.
+ *
+ * RETURNED:	depth, 0 for an empty tree
+ *
+ ***********************************************************************/
+
+UInt16 ExprNodeDepth (ExprNode * nodeP)
+{
+	UInt16 leftDepth, rightDepth;
+
+	if (!nodeP)
+		return 0;
+	leftDepth = ExprNodeDepth(nodeP->leftP);
+	rightDepth = ExprNodeDepth(nodeP->rightP);
+	if (nodeP->token == tMulAdd || nodeP->token == tMulSub)
+		rightDepth++;
+	return 1 + (leftDepth > rightDepth ? leftDepth : rightDepth);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SetEvalMode
+ *
+ * DESCRIPTION: Select when evaluation looks for NaN / Inf results.
+ *		evalCheckEachNode tests every node result, evalCheckDeferred
+ *		only tests operands that could be absorbed into a finite
+ *		result, then the final result. Both report the same errors.
+ *
+ * PARAMETERS:  evaluation mode
+ *
+ * RETURNED:	previous evaluation mode
+ *
+ ***********************************************************************/
+
+UInt8 SetEvalMode (UInt8 mode)
+{
+	UInt8 prevMode = sEvalMode;
+
+	sEvalMode = mode;
+	return prevMode;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetEvalMode
+ *
+ * DESCRIPTION: Current evaluation mode, for the other evaluators to
+ *		check results as the tree does.
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	evaluation mode
+ *
+ ***********************************************************************/
+
+UInt8 GetEvalMode (void)
+{
+	return sEvalMode;
 }
 
 
@@ -485,56 +721,186 @@ void DeleteNodes (ExprNode * nodeP)
 
 /***********************************************************************
  *
- * FUNCTION:	Eval
+ * FUNCTION:	MarkVarDefs
  *
- * DESCRIPTION: 
+ * DESCRIPTION: Mark the variables defined by expressions a tree refers
+ *		to, so their definitions get compiled
  *
- * PARAMETERS:  Expression, variables assignations, result.
+ * PARAMETERS:  node
  *
- * RETURNED:	0 if no error
+ * RETURNED:	nothing
  *
  ***********************************************************************/
 
-UInt8 Eval (Char * exprStr, Char * varsStr, double * resultP)
+static void MarkVarDefs (ExprNode * nodeP)
+{
+	if (!nodeP)
+		return;
+	if (nodeP->varP && nodeP->varP->defStr)
+		nodeP->varP->defState |= varDefUsed;
+	MarkVarDefs(nodeP->leftP);
+	MarkVarDefs(nodeP->rightP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CompileVarDefs
+ *
+ * DESCRIPTION: Compile the definitions of the variables a tree refers
+ *		to, directly or through other definitions, each one once. The
+ *		tree keeps the leaves of the defined variables, which read the
+ *		value EvalVarDefs leaves in their cells, so the solver can also
+ *		seek a defined variable. Definitions are visited in dependency
+ *		order, each one before those it refers to, so one pass marks
+ *		and compiles all of them, and they are chained for evaluation
+ *		in the reverse order. Definitions compiled for another tree of
+ *		the same list are kept, the others are not compiled.
+ *
+ * PARAMETERS:  variables list, expression tree
+ *
+ * RETURNED:	0 if no error, cycleError if the tree reads a definition
+ *		in a cycle
+ *
+ ***********************************************************************/
+
+static UInt8 CompileVarDefs (VarList * varL, ExprTree * exprT)
+{
+	TokenList tokL;
+	ExprTree defT;
+	VarCell * varP, * newHeadP = NULL, ** tailPP;
+	Boolean used = false;
+	UInt8 err = 0;
+
+	MarkVarDefs(exprT->rootP);
+	for (varP = varL->defHeadP; varP && !err; varP = varP->nextDefP)
+	{
+		if (!(varP->defState & varDefUsed) || varP->defTreeP)
+			continue;
+
+		MemSet(&tokL, sizeof(TokenList), 0);
+		MemSet(&defT, sizeof(ExprTree), 0);
+		tokL.exprStr = varP->defStr;
+		// a definition that does not parse is a variables error
+		if (TokenizeExpression(&tokL))
+			err |= parseError | missingVarError;
+		if (!err)
+			err |= AssignTokenValue(&tokL, varL);
+		if (!err && BuildExprTree(&tokL, &defT))
+			err |= parseError | missingVarError;
+		if (!err)
+		{
+			OptimizeExprTree(&defT);
+			varP->defTreeP = defT.rootP;
+			varP->nextEvalP = newHeadP;
+			newHeadP = varP;
+			MarkVarDefs(defT.rootP);
+		}
+		else
+			DeleteNodes(defT.rootP);
+
+		while (tokL.headP)
+		{
+			tokL.cellP = tokL.headP;
+			tokL.headP = tokL.headP->nextP;
+			MemPtrFree(tokL.cellP);
+		}
+	}
+
+	// definitions read by the tree but left out by the sort
+	for (varP = varL->headP; varP; varP = varP->nextP)
+	{
+		if (varP->defState & varDefUsed)
+		{
+			used = true;
+			if (!(varP->defState & varDefSorted))
+				err |= cycleError;
+		}
+		varP->defState &= ~varDefUsed;
+	}
+
+	for (tailPP = &(varL->evalHeadP); * tailPP; tailPP = &((* tailPP)->nextEvalP))
+		;
+	* tailPP = newHeadP;
+	if (used)
+		exprT->defsP = varL->evalHeadP;
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalVarDefs
+ *
+ * DESCRIPTION: Evaluate compiled definitions into their variable cells,
+ *		each one after those it refers to. A definition that fails
+ *		keeps its error in the cell, for the leaves reading it, and
+ *		a null value. The value of a definition the solver set free is
+ *		kept.
+ *
+ * PARAMETERS:  first definition of the evaluation chain, or NULL
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void EvalVarDefs (VarCell * defsP)
+{
+	VarCell * varP;
+
+	for (varP = defsP; varP; varP = varP->nextEvalP)
+	{
+		if (varP->defState & varDefFree)
+			varP->defErr = 0;
+		else if ((varP->defErr = RecurseExprNode(varP->defTreeP, &(varP->value))) != 0)
+			varP->value = 0;
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CompileExprTree
+ *
+ * DESCRIPTION: Build and optimize the tree of an expression on a parsed
+ *		variables list, which several trees can share. The token list
+ *		is released.
+ *
+ * PARAMETERS:  Expression, variables list, expression tree.
+ *
+ * RETURNED:	0 if no error, the tree is then to be deleted
+ *
+ ***********************************************************************/
+
+UInt8 CompileExprTree (Char * exprStr, VarList * varL, ExprTree * exprT)
 {
 	TokenList tokL;
-	VarList varL;
-	ExprTree exprT;
 	UInt8 err = 0;
 
 	MemSet(&tokL, sizeof(TokenList), 0);
-	MemSet(&varL, sizeof(VarList), 0);
-	MemSet(&exprT, sizeof(ExprTree), 0);
+	MemSet(exprT, sizeof(ExprTree), 0);
 
 	if (exprStr)
 	{
 		tokL.exprStr = MemPtrNew(1 + StrLen(exprStr));
 		StrCopy(tokL.exprStr, exprStr);
 	}
-	if (varsStr)
-	{
-		varL.varsStr = MemPtrNew(1 + StrLen(varsStr));
-		StrCopy(varL.varsStr, varsStr);
-	}
 
-	err |= ParseVariables(&varL);
+	err |= TokenizeExpression(&tokL);
 	if (err)
 		goto CleanUp;
-	err |= TokenizeExpression(&tokL);
+	err |= AssignTokenValue(&tokL, varL);
 	if (err)
 		goto CleanUp;
-	err |= AssignTokenValue(&tokL, &varL);
+	err |= BuildExprTree(&tokL, exprT);
 	if (err)
 		goto CleanUp;
-	err |= BuildExprTree(&tokL, &exprT);
+	err |= CompileVarDefs(varL, exprT);
 	if (err)
 		goto CleanUp;
-	err |= EvalExprTree(&exprT, resultP);
-
+	err |= OptimizeExprTree(exprT);
 
 CleanUp:
-	DeleteNodes(exprT.rootP);
-
 	while (tokL.headP)
 	{
 		tokL.cellP = tokL.headP;
@@ -544,15 +910,165 @@ CleanUp:
 	if (tokL.exprStr)
 		MemPtrFree(tokL.exprStr);
 
-	while (varL.headP)
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CompileExpr
+ *
+ * DESCRIPTION: Parse the variables and the expression once, build and
+ *		optimize the expression tree. The token list is released, the
+ *		variables list is kept for the tree variable nodes to refer to.
+ *
+ * PARAMETERS:  Expression, variables assignations, compiled expression.
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 CompileExpr (Char * exprStr, Char * varsStr, CompiledExpr * compP)
+{
+	UInt8 err = 0;
+
+	MemSet(compP, sizeof(CompiledExpr), 0);
+
+	if (varsStr)
+	{
+		compP->varL.varsStr = MemPtrNew(1 + StrLen(varsStr));
+		StrCopy(compP->varL.varsStr, varsStr);
+	}
+
+	err |= ParseVariables(&(compP->varL));
+	if (err)
+		return err;
+	err |= CompileExprTree(exprStr, &(compP->varL), &(compP->exprT));
+
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CompileParsedExpr
+ *
+ * DESCRIPTION: Compile an expression on variables already parsed. The
+ *		variables list is moved into the compiled expression, and left
+ *		empty.
+ *
+ * PARAMETERS:  Expression, parsed variables list, compiled expression.
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 CompileParsedExpr (Char * exprStr, VarList * varL, CompiledExpr * compP)
+{
+	MemSet(compP, sizeof(CompiledExpr), 0);
+	compP->varL = * varL;
+	MemSet(varL, sizeof(VarList), 0);
+
+	return CompileExprTree(exprStr, &(compP->varL), &(compP->exprT));
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	DeleteVarList
+ *
+ * DESCRIPTION: Release the variables list, with the compiled
+ *		definitions, and leave it empty
+ *
+ * PARAMETERS:  variables list
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void DeleteVarList (VarList * varL)
+{
+	while (varL->headP)
+	{
+		varL->cellP = varL->headP;
+		varL->headP = varL->headP->nextP;
+		DeleteNodes(varL->cellP->defTreeP);
+		MemPtrFree(varL->cellP);
+	}
+	if (varL->varsStr)
+		MemPtrFree(varL->varsStr);
+	MemSet(varL, sizeof(VarList), 0);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	DeleteCompiledExpr
+ *
+ * DESCRIPTION: Release the expression tree and the variables list
+ *
+ * PARAMETERS:  compiled expression.
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void DeleteCompiledExpr (CompiledExpr * compP)
+{
+	DeleteNodes(compP->exprT.rootP);
+	compP->exprT.rootP = compP->exprT.nodeP = NULL;
+	compP->exprT.defsP = NULL;
+	DeleteVarList(&(compP->varL));
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	Eval
+ *
+ * DESCRIPTION: Evaluate the shared compiled expression of the intern
+ *		table, unless the same tokens with the same variables values
+ *		are in the results cache. The variables are parsed and the
+ *		expression tokenized once for both keys, and the variables
+ *		list goes on to the intern table.
+ *
+ * PARAMETERS:  Expression, variables assignations, result.
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 Eval (Char * exprStr, Char * varsStr, double * resultP)
+{
+	CompiledExpr memo, * compP;
+	EvalKey exprKey, evalKey;
+	UInt8 err = 0;
+
+	MemSet(&memo, sizeof(CompiledExpr), 0);
+	if (varsStr)
 	{
-		varL.cellP = varL.headP;
-		varL.headP = varL.headP->nextP;
-		MemPtrFree(varL.cellP);
+		memo.varL.varsStr = MemPtrNew(1 + StrLen(varsStr));
+		StrCopy(memo.varL.varsStr, varsStr);
 	}
-	if (varL.varsStr)
-		MemPtrFree(varL.varsStr);
+	err |= ParseVariables(&(memo.varL));
+	if (err)
+		goto CleanUp;
+	if (MakeEvalKeys(exprStr, &(memo.varL), &exprKey, &evalKey))
+	{
+		// no key without tokens, the compiler tells the error
+		err |= CompileExprTree(exprStr, &(memo.varL), &(memo.exprT));
+		goto CleanUp;
+	}
+	if (LookupEvalCache(&evalKey, resultP, &err))
+		goto CleanUp;
+
+	err |= InternExpr(exprStr, &(memo.varL), &exprKey, &compP);
+	if (!err)
+		err |= EvalInternExpr(compP, resultP);
+	StoreEvalCache(&evalKey, err ? 0 : * resultP, err);
 
+CleanUp:
+	DeleteCompiledExpr(&memo);
 	return err;
 }
 
@@ -606,22 +1122,18 @@ UInt8 MakeVarsStringList (Char * varsStr, Char *** strTblP, Int16 * nStr)
 		(* strTblP)[i] = MemPtrNew(len + 2 + kFlpBufSize);
 		MemSet((* strTblP)[i], len + 2 + kFlpBufSize, 0);
 		StrCopy((* strTblP)[i], varL.cellP->name);
-		(* strTblP)[i][len] = '=';
+		(* strTblP)[i][len] = varL.cellP->distType == distNone ? '=' : '~';
 		tmpF.d = varL.cellP->value;
-		FlpCmpDblToA(&tmpF, (* strTblP)[i] + len + 1);
+		if (varL.cellP->defStr)
+			StrNCopy((* strTblP)[i] + len + 1, varL.cellP->defStr, kFlpBufSize - 1);
+		else
+			FlpCmpDblToA(&tmpF, (* strTblP)[i] + len + 1);
 		varL.cellP = varL.cellP->nextP;
 		++i;
 	}
 
 CleanUp:
-	while (varL.headP)
-	{
-		varL.cellP = varL.headP;
-		varL.headP = varL.headP->nextP;
-		MemPtrFree(varL.cellP);
-	}
-	if (varL.varsStr)
-		MemPtrFree(varL.varsStr);
+	DeleteVarList(&varL);
 	return err;
 }
 
@@ -722,9 +1234,8 @@ UInt8 FlpCmpDblToA(FlpCompDouble *f, Char *s)
 
 UInt8 AHexToFlpCmpDbl(FlpCompDouble *f, Char *s)
 {
-	Int32 intValue, exp16;
+	Int64Value intValue, exp16;
 	Int16 i;
-	Char tmpC;
 
 	intValue = 0;
 	exp16 = 1;
@@ -13,8 +13,67 @@
 #ifndef MEMOCALCPARSER_H
 #define MEMOCALCPARSER_H
 
+// structures
+
+typedef struct OptimizeStats {
+	UInt16 nPolynomials;	// polynomials put in Horner form
+	UInt16 opsSaved;		// operations saved by the Horner forms
+	UInt16 nContractions;	// a*b+c and a*b-c combined into multiply-add nodes
+	UInt16 nIntNodes;		// operations typed mInteger
+} OptimizeStats;
+
+typedef struct ExprNode {
+	struct ExprNode * leftP;
+	struct ExprNode * rightP;
+	VarCell * varP;   // variable cell for tVariable leaf nodes, holds the value
+	TokenData data;
+	UInt8 dataType;   // value for leaf nodes, funcRef or NULL for '(' nodes
+	UInt8 token;
+} ExprNode;
+
+typedef struct ExprTree {
+	ExprNode * rootP;
+	ExprNode * nodeP;
+	VarCell * defsP;		// definitions evaluated first, NULL if the tree reads none
+	OptimizeStats stats;	// rewrites of the optimizer on this tree
+} ExprTree;
+
+typedef struct CompiledExpr {
+	ExprTree exprT;   // expression tree
+	VarList varL;     // variables the tree nodes refer to
+} CompiledExpr;
+
+// optimized nodes tokens
+
+#define tIntPower			0x80	// leftP ^ data.value, a constant integral exponent
+#define tMulAdd				0x81	// leftP->leftP * leftP->rightP + rightP
+#define tMulSub				0x82	// leftP->leftP * leftP->rightP - rightP
+
+// evaluation modes
+
+#define evalCheckEachNode	0x00	// isnan / isinf on every node result
+#define evalCheckDeferred	0x01	// NaN / Inf propagate, checked where absorbed and at the root
+
+// NaN or Inf, which only MathLib produces
+
+#define isNonFinite(x)		(MathLibRef && (isnan(x) || isinf(x)))
+
 // functions
 
+ExprNode * NewExprNode (ExprNode * leftP, ExprNode * rightP, double value, UInt8 dataType, UInt8 token);
+UInt8 RecurseExprNode (ExprNode * nodeP, double * resultP);
+UInt8 EvalBitwiseOp (UInt8 token, double left, double right, double * resultP);
+UInt16 ExprNodeDepth (ExprNode * nodeP);
+UInt8 SetEvalMode (UInt8 mode);
+UInt8 GetEvalMode (void);
+UInt8 CompileExprTree (Char * exprStr, VarList * varL, ExprTree * exprT);
+UInt8 CompileExpr (Char * exprStr, Char * varsStr, CompiledExpr * compP);
+UInt8 CompileParsedExpr (Char * exprStr, VarList * varL, CompiledExpr * compP);
+UInt8 EvalExprTree (ExprTree * exprT, double * resultP);
+void EvalVarDefs (VarCell * defsP);
+void DeleteVarList (VarList * varL);
+void DeleteCompiledExpr (CompiledExpr * compP);
+void DeleteNodes (ExprNode * nodeP);
 UInt8 Eval (Char * exprStr, Char * varsStr, double * resultP);
 UInt8 MakeVarsStringList (Char * varsStr, Char *** strTblP, Int16 * nStr);
 
@@ -0,0 +1,498 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcPersist.c
+ * 
+ * DESCRIPTION : Persistent compiled expressions cache for MemoCalc.
+ *		Optimized trees are saved as records of a database in prefix
+ *		order, sorted by the key of their tokens and variable names,
+ *		when a memo is saved or evaluated from the Eval button. On the
+ *		next run, a memo tree is found by binary search and its nodes
+ *		are allocated again from the record and linked to the memo
+ *		variables. This is not zero-copy, but it skips tokenizing,
+ *		building and optimizing the tree. Past kPersistMaxRecords,
+ *		the least recently saved or loaded record is deleted. Records
+ *		of another engine version or function table are deleted when
+ *		the database is opened.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcOptimizer.h"
+#include "MemoCalcCache.h"
+#include "MemoCalcPersist.h"
+
+// globals
+static DmOpenRef sPersistDB;
+static PersistStats sPersistStats;
+static UInt32 sPersistClock;
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ComparePersistRecords
+ *
+ * DESCRIPTION: Sort order of the records, by key then optimizer flags
+ *
+ * PARAMETERS:  records headers, unused sort parameters
+ *
+ * RETURNED:	< 0, 0, > 0 as rec1 sorts before, with, or after rec2
+ *
+ ***********************************************************************/
+
+static Int16 ComparePersistRecords (void * rec1P, void * rec2P, Int16 other,
+	SortRecordInfoPtr rec1SortInfoP, SortRecordInfoPtr rec2SortInfoP, MemHandle appInfoH)
+{
+	PersistHeader * h1P = rec1P, * h2P = rec2P;
+
+	if (h1P->key.hash != h2P->key.hash)
+		return h1P->key.hash < h2P->key.hash ? -1 : 1;
+	if (h1P->key.check != h2P->key.check)
+		return h1P->key.check < h2P->key.check ? -1 : 1;
+	if (h1P->key.len != h2P->key.len)
+		return h1P->key.len < h2P->key.len ? -1 : 1;
+	return (Int16) h1P->optimizeFlags - (Int16) h2P->optimizeFlags;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	OpenPersistCache
+ *
+ * DESCRIPTION: Open or create the cache database, delete the records
+ *		another version saved, and start the clock after the last use
+ *		of the others
+ *
+ * PARAMETERS:  application creator
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 OpenPersistCache (UInt32 creator)
+{
+	PersistHeader * headerP;
+	UInt32 signature = GetFuncTableSignature();
+	UInt16 i;
+	Boolean valid;
+
+	MemSet(&sPersistStats, sizeof(PersistStats), 0);
+	sPersistClock = 0;
+	sPersistDB = DmOpenDatabaseByTypeCreator(persistDBType, creator, dmModeReadWrite);
+	if (!sPersistDB)
+	{
+		if (DmCreateDatabase(0, persistDBName, creator, persistDBType, false))
+			return parseError;
+		sPersistDB = DmOpenDatabaseByTypeCreator(persistDBType, creator, dmModeReadWrite);
+		if (!sPersistDB)
+			return parseError;
+	}
+
+	for (i = DmNumRecords(sPersistDB); i--; )
+	{
+		headerP = MemHandleLock(DmQueryRecord(sPersistDB, i));
+		valid = headerP->version == kPersistVersion && headerP->funcSignature == signature;
+		if (valid && headerP->lastUse > sPersistClock)
+			sPersistClock = headerP->lastUse;
+		MemHandleUnlock(DmQueryRecord(sPersistDB, i));
+		if (!valid)
+		{
+			DmRemoveRecord(sPersistDB, i);
+			sPersistStats.nInvalidated++;
+		}
+	}
+	sPersistStats.nRecords = DmNumRecords(sPersistDB);
+	return 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ClosePersistCache
+ *
+ * DESCRIPTION: Close the cache database
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void ClosePersistCache (void)
+{
+	if (sPersistDB)
+		DmCloseDatabase(sPersistDB);
+	sPersistDB = NULL;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FindPersistRecord
+ *
+ * DESCRIPTION: Binary search of a key with the current optimizer flags
+ *
+ * PARAMETERS:  key, returned position of the record or for inserting it
+ *
+ * RETURNED:	true if found
+ *
+ ***********************************************************************/
+
+static Boolean FindPersistRecord (EvalKey * keyP, UInt16 * indexP)
+{
+	PersistHeader header, * headerP;
+	Boolean found = false;
+
+	MemSet(&header, sizeof(PersistHeader), 0);
+	header.key = * keyP;
+	header.optimizeFlags = GetOptimizeFlags();
+
+	// position after the records comparing equal
+	* indexP = DmFindSortPosition(sPersistDB, &header, NULL, ComparePersistRecords, 0);
+	if (* indexP > 0)
+	{
+		headerP = MemHandleLock(DmQueryRecord(sPersistDB, * indexP - 1));
+		found = !ComparePersistRecords(headerP, &header, 0, NULL, NULL, NULL);
+		MemHandleUnlock(DmQueryRecord(sPersistDB, * indexP - 1));
+	}
+	if (found)
+		(* indexP)--;
+	return found;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ReadPersistNodes
+ *
+ * DESCRIPTION: Rebuild a subtree from its prefix order nodes
+ *
+ * PARAMETERS:  current node in the record, variables list, node
+ *		returned, 0 or the error found so far
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+static UInt8 ReadPersistNodes (PersistNode ** pNodeP, VarList * varL, ExprNode ** nodePP)
+{
+	PersistNode * pNode = (* pNodeP)++;
+	ExprNode * nodeP;
+	VarCell * varP;
+	UInt8 err = 0;
+
+	nodeP = * nodePP = NewExprNode(NULL, NULL, pNode->value, pNode->dataType, pNode->token);
+	if (pNode->varIndex >= 0)
+	{
+		for (varP = varL->headP; varP && varP->index != pNode->varIndex; varP = varP->nextP)
+			;
+		if (!varP)
+			err |= missingVarError;
+		nodeP->varP = varP;
+	}
+	if (pNode->funcIndex != kNoFuncIndex)
+		err |= GetFuncByIndex(&(nodeP->data.funcRef), pNode->funcIndex) ? missingFuncError : 0;
+
+	if (pNode->children & persistLeft)
+		err |= ReadPersistNodes(pNodeP, varL, &(nodeP->leftP));
+	if (pNode->children & persistRight)
+		err |= ReadPersistNodes(pNodeP, varL, &(nodeP->rightP));
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	LoadPersistExpr
+ *
+ * DESCRIPTION: Read the tree saved for a key on the memo variables,
+ *		which are moved into the compiled expression when loaded. The
+ *		nodes are allocated from the record, which is marked used, so
+ *		it is got for writing and released dirty.
+ *
+ * PARAMETERS:  key, parsed variables list, compiled expression
+ *
+ * RETURNED:	true if loaded, the compiled expression is then to be
+ *		deleted, false if not saved or not linked to the variables
+ *
+ ***********************************************************************/
+
+Boolean LoadPersistExpr (EvalKey * keyP, VarList * varL, CompiledExpr * compP)
+{
+	MemHandle recH;
+	PersistHeader * headerP;
+	PersistNode * pNode;
+	UInt32 lastUse;
+	UInt16 index;
+	UInt8 err = 0;
+
+	MemSet(compP, sizeof(CompiledExpr), 0);
+	if (!sPersistDB || !FindPersistRecord(keyP, &index))
+	{
+		sPersistStats.nMisses++;
+		return false;
+	}
+
+	if ((recH = DmGetRecord(sPersistDB, index)) == NULL)
+	{
+		sPersistStats.nMisses++;
+		return false;
+	}
+	headerP = (PersistHeader *) MemHandleLock(recH);
+	compP->exprT.stats = headerP->stats;
+	pNode = (PersistNode *) (headerP + 1);
+	err |= ReadPersistNodes(&pNode, varL, &(compP->exprT.rootP));
+	if (!err)
+	{
+		lastUse = ++sPersistClock;
+		DmWrite(headerP, OffsetOf(PersistHeader, lastUse), &lastUse, sizeof(UInt32));
+	}
+	MemHandleUnlock(recH);
+	DmReleaseRecord(sPersistDB, index, !err);
+	compP->exprT.nodeP = compP->exprT.rootP;
+	if (err)
+	{
+		DeleteNodes(compP->exprT.rootP);
+		compP->exprT.rootP = compP->exprT.nodeP = NULL;
+		sPersistStats.nMisses++;
+		return false;
+	}
+	compP->varL = * varL;
+	MemSet(varL, sizeof(VarList), 0);
+	sPersistStats.nLoads++;
+	return true;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	WritePersistNodes
+ *
+ * DESCRIPTION: Flatten a subtree in prefix order. Trees with missing
+ *		variables or functions are not saved, they are errors to
+ *		report from the expression text.
+ *
+ * PARAMETERS:  node, nodes buffer or NULL to count them, nodes count
+ *
+ * RETURNED:	0 if the subtree can be saved
+ *
+ ***********************************************************************/
+
+static UInt8 WritePersistNodes (ExprNode * nodeP, PersistNode * bufP, UInt16 * nNodesP)
+{
+	PersistNode pNode;
+	UInt8 err = 0;
+
+	MemSet(&pNode, sizeof(PersistNode), 0);
+	pNode.dataType = nodeP->dataType;
+	pNode.token = nodeP->token;
+	pNode.varIndex = nodeP->varP ? (Int16) nodeP->varP->index : -1;
+	pNode.funcIndex = kNoFuncIndex;
+	if (nodeP->token == '(' && nodeP->dataType & mFunction)
+	{
+		if (nodeP->dataType != tFunction
+		|| (pNode.funcIndex = GetFuncIndex(nodeP->data.funcRef.func)) == kNoFuncIndex)
+			return missingFuncError;
+	}
+	else
+		pNode.value = nodeP->data.value;
+	if ((nodeP->token == tNumber || nodeP->token == tName)
+	&& !nodeP->varP && !(nodeP->dataType & mValue))
+		return missingVarError;
+
+	if (nodeP->leftP)
+		pNode.children |= persistLeft;
+	if (nodeP->rightP)
+		pNode.children |= persistRight;
+	if (bufP)
+		bufP[* nNodesP] = pNode;
+	(* nNodesP)++;
+
+	if (nodeP->leftP)
+		err |= WritePersistNodes(nodeP->leftP, bufP, nNodesP);
+	if (nodeP->rightP && !err)
+		err |= WritePersistNodes(nodeP->rightP, bufP, nNodesP);
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvictPersistRecord
+ *
+ * DESCRIPTION: Delete the least recently saved or loaded record
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void EvictPersistRecord (void)
+{
+	PersistHeader * headerP;
+	UInt32 lruUse = 0xFFFFFFFFUL;
+	UInt16 i, lruIndex = 0;
+
+	for (i = DmNumRecords(sPersistDB); i--; )
+	{
+		headerP = MemHandleLock(DmQueryRecord(sPersistDB, i));
+		if (headerP->lastUse < lruUse)
+		{
+			lruUse = headerP->lastUse;
+			lruIndex = i;
+		}
+		MemHandleUnlock(DmQueryRecord(sPersistDB, i));
+	}
+	DmRemoveRecord(sPersistDB, lruIndex);
+	sPersistStats.nEvictions++;
+	sPersistStats.nRecords--;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SavePersistExpr
+ *
+ * DESCRIPTION: Save the tree of a key in its sorted position, unless
+ *		it is already saved. When the database is full, the least
+ *		recently used record is deleted first. A tree reading
+ *		definitions is not saved, they are compiled with the memo.
+ *
+ * PARAMETERS:  key, compiled expression
+ *
+ * RETURNED:	0 if saved or already saved
+ *
+ ***********************************************************************/
+
+UInt8 SavePersistExpr (EvalKey * keyP, CompiledExpr * compP)
+{
+	PersistHeader header;
+	PersistNode * bufP;
+	MemHandle recH;
+	void * recP;
+	UInt16 index, nNodes = 0;
+	UInt8 err = 0;
+
+	if (!sPersistDB || !compP->exprT.rootP || compP->exprT.defsP)
+		return parseError;
+	if (FindPersistRecord(keyP, &index))
+		return 0;
+	err |= WritePersistNodes(compP->exprT.rootP, NULL, &nNodes);
+	if (err)
+		return err;
+	if (sPersistStats.nRecords >= kPersistMaxRecords)
+	{
+		EvictPersistRecord();
+		FindPersistRecord(keyP, &index);
+	}
+
+	MemSet(&header, sizeof(PersistHeader), 0);
+	header.key = * keyP;
+	header.funcSignature = GetFuncTableSignature();
+	header.lastUse = ++sPersistClock;
+	header.nNodes = nNodes;
+	header.stats = compP->exprT.stats;
+	header.version = kPersistVersion;
+	header.optimizeFlags = GetOptimizeFlags();
+
+	bufP = MemPtrNew(nNodes * sizeof(PersistNode));
+	nNodes = 0;
+	WritePersistNodes(compP->exprT.rootP, bufP, &nNodes);
+	recH = DmNewRecord(sPersistDB, &index, sizeof(PersistHeader) + nNodes * sizeof(PersistNode));
+	if (recH)
+	{
+		recP = MemHandleLock(recH);
+		DmWrite(recP, 0, &header, sizeof(PersistHeader));
+		DmWrite(recP, sizeof(PersistHeader), bufP, nNodes * sizeof(PersistNode));
+		MemHandleUnlock(recH);
+		DmReleaseRecord(sPersistDB, index, true);
+		sPersistStats.nSaves++;
+		sPersistStats.nRecords++;
+	}
+	else
+		err |= parseError;
+	MemPtrFree(bufP);
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	PersistMemoExpr
+ *
+ * DESCRIPTION: Save the tree of a memo for the next run, compiled on
+ *		the memo variables the saved indexes refer to. Memos already
+ *		saved are not compiled again.
+ *
+ * PARAMETERS:  expression, variables assignations
+ *
+ * RETURNED:	0 if saved or already saved
+ *
+ ***********************************************************************/
+
+UInt8 PersistMemoExpr (Char * exprStr, Char * varsStr)
+{
+	CompiledExpr comp;
+	VarList varL;
+	EvalKey exprKey, evalKey;
+	UInt16 index;
+	UInt8 err = 0;
+
+	if (!sPersistDB)
+		return parseError;
+	MemSet(&varL, sizeof(VarList), 0);
+	if (varsStr)
+	{
+		varL.varsStr = MemPtrNew(1 + StrLen(varsStr));
+		StrCopy(varL.varsStr, varsStr);
+	}
+	err |= ParseVariables(&varL);
+	if (!err)
+		err |= MakeEvalKeys(exprStr, &varL, &exprKey, &evalKey);
+	if (!err && !FindPersistRecord(&exprKey, &index))
+	{
+		err |= CompileParsedExpr(exprStr, &varL, &comp);
+		if (!err)
+			err |= SavePersistExpr(&exprKey, &comp);
+		DeleteCompiledExpr(&comp);
+	}
+
+	while (varL.headP)
+	{
+		varL.cellP = varL.headP;
+		varL.headP = varL.headP->nextP;
+		MemPtrFree(varL.cellP);
+	}
+	if (varL.varsStr)
+		MemPtrFree(varL.varsStr);
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetPersistStats
+ *
+ * DESCRIPTION: Trees loaded, saved and evicted since the cache was
+ *		opened
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	persist stats
+ *
+ ***********************************************************************/
+
+PersistStats * GetPersistStats (void)
+{
+	return &sPersistStats;
+}
@@ -0,0 +1,68 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcPersist.h
+ * 
+ * DESCRIPTION : Persistent compiled expressions cache headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCPERSIST_H
+#define MEMOCALCPERSIST_H
+
+// cache database
+
+#define persistDBType		'CEXP'
+#define persistDBName		"MemoCalcExprCache"
+#define kPersistVersion		3		// to increment when the trees or their encoding change
+#define kPersistMaxRecords	512		// expressions saved, the least recently used is deleted
+
+// persistent node children
+
+#define persistLeft			0x01
+#define persistRight		0x02
+
+// structures
+
+typedef struct PersistHeader {
+	EvalKey key;			// tokens and variable names
+	UInt32 funcSignature;	// GetFuncTableSignature when saved
+	UInt32 lastUse;			// persist clock at the last save or load
+	UInt16 nNodes;			// PersistNode records following the header
+	OptimizeStats stats;	// rewrites of the optimizer on the saved tree
+	UInt8 version;
+	UInt8 optimizeFlags;
+} PersistHeader;
+
+typedef struct PersistNode {
+	double value;			// data.value of other nodes than functions
+	Int16 varIndex;			// index of the variable in the memo list, -1 for none
+	Int16 funcIndex;		// GetFuncIndex of a function, kNoFuncIndex for none
+	UInt8 dataType;
+	UInt8 token;
+	UInt8 children;			// persistLeft | persistRight, nodes in prefix order
+	UInt8 reserved;
+} PersistNode;
+
+typedef struct PersistStats {
+	UInt32 nLoads;			// trees read instead of compiled
+	UInt32 nMisses;
+	UInt32 nSaves;
+	UInt32 nEvictions;		// least recently used records deleted for a save
+	UInt16 nInvalidated;	// records of an older version deleted on open
+	UInt16 nRecords;
+} PersistStats;
+
+// functions
+
+UInt8 OpenPersistCache (UInt32 creator);
+void ClosePersistCache (void);
+Boolean LoadPersistExpr (EvalKey * keyP, VarList * varL, CompiledExpr * compP);
+UInt8 SavePersistExpr (EvalKey * keyP, CompiledExpr * compP);
+UInt8 PersistMemoExpr (Char * exprStr, Char * varsStr);
+PersistStats * GetPersistStats (void);
+
+#endif // MEMOCALCPERSIST_H
@@ -0,0 +1,610 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcSheet.c
+ * 
+ * DESCRIPTION : Cross memo references for MemoCalc. An expression can
+ *		use the result of another memo of the category by its title,
+ *		like "@Loan monthly payments * 12". The memos and the ones they
+ *		refer to make a graph, leveled so each memo comes after the
+ *		ones it refers to. When a memo is saved, only the memos
+ *		depending on it are marked dirty, and they are recalculated one
+ *		level after the other.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcIncremental.h"
+#include "MemoCalcMulti.h"
+#include "MemoCalcSheet.h"
+
+// globals
+static SheetStats sSheetStats;
+
+// a reference runs to the next operator or parenthesis, or the end of the line
+#define isSheetRefEnd(c)	(!(c) || c == '\n' || isOperator(c) || isOpen(c) || isClose(c))
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	InitSheet
+ *
+ * DESCRIPTION: Set the database and category of the memos to refer to.
+ *		The graph is built when a reference is first evaluated.
+ *
+ * PARAMETERS:  sheet, memo database, memos category
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void InitSheet (Sheet * sheetP, DmOpenRef dbP, UInt16 category)
+{
+	MemSet(sheetP, sizeof(Sheet), 0);
+	sheetP->dbP = dbP;
+	sheetP->category = category;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	IsSheetExpr
+ *
+ * DESCRIPTION: Check an expression or its variables refer to memos
+ *
+ * PARAMETERS:  expression string, vars string
+ *
+ * RETURNED:	true if there is a reference
+ *
+ ***********************************************************************/
+
+Boolean IsSheetExpr (Char * exprStr, Char * varsStr)
+{
+	return (exprStr && StrChr(exprStr, '@')) || (varsStr && StrChr(varsStr, '@'));
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SplitSheetMemo
+ *
+ * DESCRIPTION: Find the parts of a memo record
+ *
+ * PARAMETERS:  memo string, returned vars and their length, returned
+ *		expression, NULL without tags
+ *
+ * RETURNED:	length of the title, the first line before the tags
+ *
+ ***********************************************************************/
+
+static UInt16 SplitSheetMemo (Char * memoStr, Char ** varsP, UInt16 * varsLenP, Char ** exprP)
+{
+	Char * exprStr, * varsStr;
+	UInt16 titleLen = 0;
+
+	exprStr = StrStr(memoStr, kExprTag);
+	varsStr = StrStr(memoStr, kVarsTag);
+	* exprP = exprStr ? exprStr + kExprTagLen : NULL;
+	* varsP = NULL;
+	* varsLenP = 0;
+	if (varsStr && exprStr && varsStr < exprStr)
+	{
+		* varsP = varsStr + kVarsTagLen;
+		* varsLenP = (UInt16) (exprStr - * varsP);
+		exprStr = varsStr;
+	}
+
+	while (memoStr[titleLen] && memoStr[titleLen] != '\n' && memoStr + titleLen != exprStr)
+		++titleLen;
+	while (titleLen && isSeparator(memoStr[titleLen - 1]))
+		--titleLen;
+	return titleLen;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FindSheetMemo
+ *
+ * DESCRIPTION: Find a memo by reference, the first one of a title
+ *
+ * PARAMETERS:  sheet, reference with its '@', length
+ *
+ * RETURNED:	memo index, kNoSheetMemo if none
+ *
+ ***********************************************************************/
+
+static UInt16 FindSheetMemo (Sheet * sheetP, Char * refStr, UInt16 len)
+{
+	UInt16 i;
+
+	for (i = 0; i < sheetP->nMemos; i++)
+		if (StrNCompare(sheetP->memosP[i].titleStr, refStr, len) == 0
+		&& !sheetP->memosP[i].titleStr[len])
+			return i;
+	return kNoSheetMemo;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	ScanSheetRefs
+ *
+ * DESCRIPTION: Add the memos a text refers to, once each. References to
+ *		unknown titles are left to the compiler, which reports them as
+ *		missing variables.
+ *
+ * PARAMETERS:  sheet, text, length, references of kSheetMaxRefs
+ *		elements, references already found
+ *
+ * RETURNED:	references found
+ *
+ ***********************************************************************/
+
+static UInt16 ScanSheetRefs (Sheet * sheetP, Char * str, UInt16 len, UInt16 * refsP, UInt16 nRefs)
+{
+	UInt16 iStart, iEnd, iNext = 0, ref, i;
+
+	while (iNext < len && str[iNext])
+	{
+		if (!isRef(str[iNext]))
+		{
+			++iNext;
+			continue;
+		}
+		iStart = iNext++;
+		while (iNext < len && !isSheetRefEnd(str[iNext]))
+			++iNext;
+		iEnd = iNext;
+		while (iEnd > iStart && isSeparator(str[iEnd - 1]))
+			--iEnd;
+
+		ref = FindSheetMemo(sheetP, str + iStart, iEnd - iStart);
+		for (i = 0; i < nRefs && refsP[i] != ref; i++)
+			;
+		if (ref != kNoSheetMemo && i == nRefs && nRefs < kSheetMaxRefs)
+			refsP[nRefs++] = ref;
+	}
+	return nRefs;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	LevelSheetMemo
+ *
+ * DESCRIPTION: Depth first visit of the memos a memo refers to, to set
+ *		its level
+ *
+ * PARAMETERS:  sheet, memo index
+ *
+ * RETURNED:	0 if no error, cycleError if the memo refers to itself
+ *		or to a memo that does, through others
+ *
+ ***********************************************************************/
+
+static UInt8 LevelSheetMemo (Sheet * sheetP, UInt16 index)
+{
+	SheetMemo * memoP = sheetP->memosP + index, * refP;
+	UInt16 i;
+	UInt8 err = 0;
+
+	if (memoP->state & sheetLeveled)
+		return memoP->err & cycleError;
+	if (memoP->state & sheetVisiting)
+		return cycleError;
+	memoP->state |= sheetVisiting;
+
+	for (i = 0; i < memoP->nRefs; i++)
+	{
+		refP = sheetP->memosP + memoP->refsP[i];
+		err |= LevelSheetMemo(sheetP, memoP->refsP[i]);
+		if (memoP->level <= refP->level)
+			memoP->level = refP->level + 1;
+	}
+
+	memoP->state = sheetLeveled | sheetDirty;
+	if (err)
+	{
+		// not evaluated, the error stays until the cycle is broken
+		memoP->state = sheetLeveled;
+		memoP->err = cycleError;
+		sSheetStats.nCycles++;
+	}
+	if (sheetP->nLevels <= memoP->level)
+		sheetP->nLevels = memoP->level + 1;
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	BuildSheet
+ *
+ * DESCRIPTION: Read the titles and references of the memos of the
+ *		category, level them and sort them by level. All the memos are
+ *		dirty, except the ones on reference cycles.
+ *
+ * PARAMETERS:  sheet
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void BuildSheet (Sheet * sheetP)
+{
+	SheetMemo * memoP;
+	MemHandle memoH;
+	Char * memoStr, * varsStr, * exprStr;
+	UInt16 refs[kSheetMaxRefs];
+	UInt16 * countsP;
+	UInt16 recIndex, titleLen, varsLen, i;
+
+	sheetP->nMemos = sheetP->nLevels = 0;
+	sSheetStats.nCycles = 0;
+	for (recIndex = 0; sheetP->dbP && DmQueryNextInCategory(sheetP->dbP, &recIndex, sheetP->category); recIndex++)
+		sheetP->nMemos++;
+	sheetP->memosP = MemPtrNew((sheetP->nMemos + 1) * sizeof(SheetMemo));
+	sheetP->orderP = MemPtrNew((sheetP->nMemos + 1) * sizeof(UInt16));
+	MemSet(sheetP->memosP, (sheetP->nMemos + 1) * sizeof(SheetMemo), 0);
+
+	// titles first, references may be to any memo
+	for (recIndex = 0, memoP = sheetP->memosP; memoP < sheetP->memosP + sheetP->nMemos; recIndex++, memoP++)
+	{
+		memoH = DmQueryNextInCategory(sheetP->dbP, &recIndex, sheetP->category);
+		DmRecordInfo(sheetP->dbP, recIndex, NULL, &(memoP->uniqueID), NULL);
+		memoStr = MemHandleLock(memoH);
+		titleLen = SplitSheetMemo(memoStr, &varsStr, &varsLen, &exprStr);
+		memoP->titleStr = MemPtrNew(titleLen + 2);
+		memoP->titleStr[0] = '@';
+		StrNCopy(memoP->titleStr + 1, memoStr, titleLen);
+		memoP->titleStr[titleLen + 1] = nullChr;
+		MemHandleUnlock(memoH);
+	}
+
+	for (recIndex = 0, memoP = sheetP->memosP; memoP < sheetP->memosP + sheetP->nMemos; recIndex++, memoP++)
+	{
+		memoH = DmQueryNextInCategory(sheetP->dbP, &recIndex, sheetP->category);
+		memoStr = MemHandleLock(memoH);
+		SplitSheetMemo(memoStr, &varsStr, &varsLen, &exprStr);
+		if (exprStr)
+		{
+			memoP->nRefs = ScanSheetRefs(sheetP, varsStr, varsLen, refs, 0);
+			memoP->nRefs = ScanSheetRefs(sheetP, exprStr, StrLen(exprStr), refs, memoP->nRefs);
+		}
+		if (memoP->nRefs)
+		{
+			memoP->refsP = MemPtrNew(memoP->nRefs * sizeof(UInt16));
+			MemMove(memoP->refsP, refs, memoP->nRefs * sizeof(UInt16));
+		}
+		MemHandleUnlock(memoH);
+	}
+
+	for (i = 0; i < sheetP->nMemos; i++)
+		LevelSheetMemo(sheetP, i);
+
+	// counting sort of the memos by level
+	countsP = MemPtrNew((sheetP->nLevels + 1) * sizeof(UInt16));
+	MemSet(countsP, (sheetP->nLevels + 1) * sizeof(UInt16), 0);
+	for (i = 0; i < sheetP->nMemos; i++)
+		countsP[sheetP->memosP[i].level + 1]++;
+	for (i = 1; i < sheetP->nLevels; i++)
+		countsP[i] += countsP[i - 1];
+	for (i = 0; i < sheetP->nMemos; i++)
+		sheetP->orderP[countsP[sheetP->memosP[i].level]++] = i;
+	MemPtrFree(countsP);
+
+	sSheetStats.nMemos = sheetP->nMemos;
+	sSheetStats.nLevels = sheetP->nLevels;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	FreeSheetMemos
+ *
+ * DESCRIPTION: Free the memos of the graph
+ *
+ * PARAMETERS:  sheet
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void FreeSheetMemos (Sheet * sheetP)
+{
+	UInt16 i;
+
+	if (!sheetP->memosP)
+		return;
+	for (i = 0; i < sheetP->nMemos; i++)
+	{
+		MemPtrFree(sheetP->memosP[i].titleStr);
+		if (sheetP->memosP[i].refsP)
+			MemPtrFree(sheetP->memosP[i].refsP);
+	}
+	MemPtrFree(sheetP->memosP);
+	MemPtrFree(sheetP->orderP);
+	sheetP->memosP = NULL;
+	sheetP->orderP = NULL;
+	sheetP->nMemos = sheetP->nLevels = 0;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalSheetRefs
+ *
+ * DESCRIPTION: Evaluate the first expression of a memo, each memo it
+ *		refers to being a variable named after its reference, with
+ *		its result for value
+ *
+ * PARAMETERS:  sheet, expressions, vars string or NULL and its length,
+ *		memos referenced, number of references, result
+ *
+ * RETURNED:	0 if no error, else the error of the memo or of the
+ *		first memo referenced with one
+ *
+ ***********************************************************************/
+
+static UInt8 EvalSheetRefs (Sheet * sheetP, Char * exprStr, Char * varsStr, UInt16 varsLen,
+	UInt16 * refsP, UInt16 nRefs, double * resultP)
+{
+	MultiExpr multi;
+	SheetMemo * refP;
+	double results[kMultiMaxExprs];
+	UInt8 errs[kMultiMaxExprs];
+	UInt16 i;
+	UInt8 err = 0;
+
+	* resultP = 0;
+	for (i = 0; i < nRefs; i++)
+		if (sheetP->memosP[refsP[i]].err)
+			return sheetP->memosP[refsP[i]].err;
+
+	MemSet(&multi, sizeof(MultiExpr), 0);
+	if (varsStr)
+	{
+		multi.varL.varsStr = MemPtrNew(varsLen + 1);
+		MemMove(multi.varL.varsStr, varsStr, varsLen);
+		multi.varL.varsStr[varsLen] = nullChr;
+	}
+	err |= ParseVariables(&(multi.varL));
+	if (err)
+	{
+		DeleteMultiExpr(&multi);
+		return err;
+	}
+	for (i = 0; i < nRefs; i++)
+	{
+		refP = sheetP->memosP + refsP[i];
+		AddVarCell(&(multi.varL), refP->titleStr)->value = refP->value;
+	}
+
+	err |= CompileMultiExprVars(exprStr, &multi);
+	if (err)
+		return err;
+	EvalMultiExpr(&multi, results, errs);
+	* resultP = results[0];
+	err = errs[0];
+	DeleteMultiExpr(&multi);
+
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalSheetMemo
+ *
+ * DESCRIPTION: Recalculate a memo of the sheet from its record
+ *
+ * PARAMETERS:  sheet, memo index
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+static void EvalSheetMemo (Sheet * sheetP, UInt16 index)
+{
+	SheetMemo * memoP = sheetP->memosP + index;
+	MemHandle memoH;
+	Char * memoStr, * varsStr, * exprStr;
+	UInt16 recIndex, varsLen;
+
+	memoP->state &= ~sheetDirty;
+	memoP->value = 0;
+	memoP->err = parseError;
+	sSheetStats.nRecalcs++;
+
+	if (DmFindRecordByID(sheetP->dbP, memoP->uniqueID, &recIndex)
+	|| (memoH = DmQueryRecord(sheetP->dbP, recIndex)) == NULL)
+		return;
+	memoStr = MemHandleLock(memoH);
+	SplitSheetMemo(memoStr, &varsStr, &varsLen, &exprStr);
+	if (exprStr)
+		memoP->err = EvalSheetRefs(sheetP, exprStr, varsStr, varsLen, memoP->refsP, memoP->nRefs, &(memoP->value));
+	MemHandleUnlock(memoH);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	RecalcSheet
+ *
+ * DESCRIPTION: Recalculate the dirty memos by increasing level. The
+ *		memos of a level only refer to lower levels, so each level is a
+ *		frontier of independent memos, ready once the previous levels
+ *		are done.
+ *
+ * PARAMETERS:  sheet
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void RecalcSheet (Sheet * sheetP)
+{
+	UInt16 i;
+
+	for (i = 0; i < sheetP->nMemos; i++)
+		if (sheetP->memosP[sheetP->orderP[i]].state & sheetDirty)
+			EvalSheetMemo(sheetP, sheetP->orderP[i]);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SameSheetRefs
+ *
+ * DESCRIPTION: Compare the references of a memo in two graphs
+ *
+ * PARAMETERS:  old sheet, old memo, new sheet, new memo
+ *
+ * RETURNED:	true if it refers to the same records
+ *
+ ***********************************************************************/
+
+static Boolean SameSheetRefs (Sheet * oldP, SheetMemo * oldMemoP, Sheet * sheetP, SheetMemo * memoP)
+{
+	UInt16 i;
+
+	if (oldMemoP->nRefs != memoP->nRefs)
+		return false;
+	for (i = 0; i < memoP->nRefs; i++)
+		if (oldP->memosP[oldMemoP->refsP[i]].uniqueID != sheetP->memosP[memoP->refsP[i]].uniqueID)
+			return false;
+	return true;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	UpdateSheet
+ *
+ * DESCRIPTION: Rebuild the graph after a memo was saved or deleted.
+ *		Memos keep their results unless they are the one saved, their
+ *		references changed, or they depend on a dirty memo.
+ *
+ * PARAMETERS:  sheet, index of the record saved, dmMaxRecordIndex if
+ *		it was deleted
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void UpdateSheet (Sheet * sheetP, UInt16 recIndex)
+{
+	Sheet old;
+	SheetMemo * memoP, * oldMemoP;
+	UInt32 changedID = 0;
+	UInt16 i, j;
+
+	if (!sheetP->memosP)
+		return;
+	if (recIndex != dmMaxRecordIndex)
+		DmRecordInfo(sheetP->dbP, recIndex, NULL, &changedID, NULL);
+
+	old = * sheetP;
+	BuildSheet(sheetP);
+
+	for (i = 0, memoP = sheetP->memosP; i < sheetP->nMemos; i++, memoP++)
+	{
+		if (!(memoP->state & sheetDirty) || memoP->uniqueID == changedID)
+			continue;
+		for (j = 0, oldMemoP = old.memosP; j < old.nMemos && oldMemoP->uniqueID != memoP->uniqueID; j++, oldMemoP++)
+			;
+		if (j < old.nMemos && !(oldMemoP->state & sheetDirty) && oldMemoP->err != cycleError
+		&& SameSheetRefs(&old, oldMemoP, sheetP, memoP))
+		{
+			memoP->value = oldMemoP->value;
+			memoP->err = oldMemoP->err;
+			memoP->state &= ~sheetDirty;
+		}
+	}
+	FreeSheetMemos(&old);
+
+	// memos referenced come first, a single pass reaches all dependents
+	for (i = 0; i < sheetP->nMemos; i++)
+	{
+		memoP = sheetP->memosP + sheetP->orderP[i];
+		for (j = 0; j < memoP->nRefs && !(memoP->state & sheetDirty); j++)
+			if (sheetP->memosP[memoP->refsP[j]].state & sheetDirty)
+				memoP->state |= sheetDirty;
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalSheetExpr
+ *
+ * DESCRIPTION: Evaluate an expression referring to memos, once the
+ *		dirty memos are recalculated. With several named expressions,
+ *		the result is the first one's.
+ *
+ * PARAMETERS:  sheet, expressions, vars string, result
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 EvalSheetExpr (Sheet * sheetP, Char * exprStr, Char * varsStr, double * resultP)
+{
+	UInt16 refs[kSheetMaxRefs];
+	UInt16 nRefs = 0, varsLen = 0;
+
+	if (!sheetP->memosP)
+		BuildSheet(sheetP);
+	RecalcSheet(sheetP);
+
+	if (varsStr)
+		nRefs = ScanSheetRefs(sheetP, varsStr, varsLen = StrLen(varsStr), refs, 0);
+	nRefs = ScanSheetRefs(sheetP, exprStr, StrLen(exprStr), refs, nRefs);
+	return EvalSheetRefs(sheetP, exprStr, varsStr, varsLen, refs, nRefs, resultP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	DeleteSheet
+ *
+ * DESCRIPTION: Free the graph, it is built again when needed
+ *
+ * PARAMETERS:  sheet
+ *
+ * RETURNED:	nothing
+ *
+ ***********************************************************************/
+
+void DeleteSheet (Sheet * sheetP)
+{
+	FreeSheetMemos(sheetP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GetSheetStats
+ *
+ * DESCRIPTION: Memos of the graph and recalculations since started
+ *
+ * PARAMETERS:  none
+ *
+ * RETURNED:	sheet stats
+ *
+ ***********************************************************************/
+
+SheetStats * GetSheetStats (void)
+{
+	return &sSheetStats;
+}
@@ -0,0 +1,71 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcSheet.h
+ * 
+ * DESCRIPTION : Cross memo references headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCSHEET_H
+#define MEMOCALCSHEET_H
+
+// memo layout: title, vars tag, vars, expression tag, expression
+
+#define kExprTag			"<--expr-->"
+#define kVarsTag			"<--vars-->"
+#define kExprTagLen			10
+#define kVarsTagLen			10
+
+#define kSheetMaxRefs		32		// memos referenced by one memo
+#define kNoSheetMemo		0xFFFF
+
+// sheet memo states
+
+#define sheetDirty			0x01	// result to recalculate
+#define sheetVisiting		0x02	// references being leveled
+#define sheetLeveled		0x04
+
+// structures
+
+typedef struct SheetMemo {
+	double value;			// result of the first expression
+	Char * titleStr;		// reference name, '@' and the first line of the memo
+	UInt16 * refsP;			// memos referenced, as indexes in the sheet
+	UInt32 uniqueID;		// record unique ID
+	UInt16 nRefs;
+	UInt16 level;			// 0 without references, else 1 + the level of the deepest one
+	UInt8 err;
+	UInt8 state;
+} SheetMemo;
+
+typedef struct Sheet {
+	DmOpenRef dbP;
+	SheetMemo * memosP;		// NULL until a reference is evaluated
+	UInt16 * orderP;		// memos by increasing level
+	UInt16 nMemos;
+	UInt16 nLevels;
+	UInt16 category;
+} Sheet;
+
+typedef struct SheetStats {
+	UInt32 nRecalcs;		// memos evaluated since started
+	UInt16 nMemos;
+	UInt16 nLevels;
+	UInt16 nCycles;			// memos on or behind a reference cycle
+} SheetStats;
+
+// functions
+
+void InitSheet (Sheet * sheetP, DmOpenRef dbP, UInt16 category);
+Boolean IsSheetExpr (Char * exprStr, Char * varsStr);
+void UpdateSheet (Sheet * sheetP, UInt16 recIndex);
+void RecalcSheet (Sheet * sheetP);
+UInt8 EvalSheetExpr (Sheet * sheetP, Char * exprStr, Char * varsStr, double * resultP);
+void DeleteSheet (Sheet * sheetP);
+SheetStats * GetSheetStats (void);
+
+#endif // MEMOCALCSHEET_H
@@ -0,0 +1,211 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcSolver.c
+ * 
+ * DESCRIPTION : Goal seek for MemoCalc. Find the value of one variable
+ *		for which the expression evaluates to a target value.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+
+#include "MathLib.h"
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcGradient.h"
+#include "MemoCalcSolver.h"
+
+#define absValue(x)		((x) < 0 ? -(x) : (x))
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SolveExpr
+ *
+ * DESCRIPTION: Safeguarded Newton iteration on the compiled expression,
+ *		starting from the current value of the unknown. The derivative
+ *		comes from the forward mode gradient. Each evaluated point
+ *		narrows a bracket around the root once one is found on both
+ *		sides, and steps leaving the bracket fall back to bisection.
+ *		Points where the expression fails are retried half way back
+ *		to the last good point. A defined unknown starts from the value
+ *		of its definition, which is not evaluated while solving.
+ *
+ * PARAMETERS:  Compiled expression, unknown variable cell, target
+ *		value, solution.
+ *
+ * RETURNED:	0 if the solution was found, noSolutionError if the
+ *		iteration did not converge. The unknown keeps its value.
+ *
+ ***********************************************************************/
+
+UInt8 SolveExpr (CompiledExpr * compP, VarCell * unknownP, double target, double * solutionP)
+{
+	double * gradP;
+	double x, f, df, step, startX, lastX, lowX, highX, tol;
+	Boolean hasLow, hasHigh, hasLast;
+	Boolean setFree = unknownP->defTreeP && !(unknownP->defState & varDefFree);
+	UInt16 iter;
+	UInt8 err = noSolutionError;
+
+	gradP = MemPtrNew(compP->varL.nVars * sizeof(double));
+	if (!gradP)
+		return memoryError;
+	if (setFree)
+	{
+		EvalVarDefs(compP->exprT.defsP);
+		unknownP->defState |= varDefFree;
+	}
+	startX = x = * solutionP = unknownP->value;
+	lastX = lowX = highX = x;
+	hasLow = hasHigh = hasLast = false;
+	tol = kSolveTolerance * (1 + absValue(target));
+
+	for (iter = 0; iter < kSolveMaxIter; iter++)
+	{
+		unknownP->value = x;
+		if (EvalExprGradient(compP, &f, gradP))
+		{
+			// out of the expression domain, back off toward the last good point
+			if (!hasLast)
+				break;
+			x = (x + lastX) / 2;
+			continue;
+		}
+		f -= target;
+		df = gradP[unknownP->index];
+
+		if (absValue(f) <= tol)
+		{
+			* solutionP = x;
+			err = 0;
+			break;
+		}
+
+		// f(lowX) < 0 < f(highX)
+		if (f < 0)
+		{
+			lowX = x;
+			hasLow = true;
+		}
+		else
+		{
+			highX = x;
+			hasHigh = true;
+		}
+		lastX = x;
+		hasLast = true;
+
+		step = df ? f / df : 0;
+		x = lastX - step;
+		if (hasLow && hasHigh)
+		{
+			if (!df || (x - lowX) * (x - highX) >= 0)
+				x = (lowX + highX) / 2;
+			if (absValue(highX - lowX) <= kSolveTolerance * (1 + absValue(x)))
+			{
+				* solutionP = x;
+				err = 0;
+				break;
+			}
+		}
+		else if (!df)
+			x = lastX + 1 + absValue(lastX);	// flat spot, look further
+		else if (absValue(step) <= kSolveTolerance * (1 + absValue(x)))
+		{
+			* solutionP = x;
+			err = 0;
+			break;
+		}
+	}
+
+	unknownP->value = startX;
+	if (setFree)
+		unknownP->defState &= ~varDefFree;
+	MemPtrFree(gradP);
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SolveExprBatch
+ *
+ * DESCRIPTION: Solve the same compiled expression for several targets.
+ *		Each search starts from the previous solution, so sorted
+ *		targets converge in a few steps.
+ *
+ * PARAMETERS:  Compiled expression, unknown variable cell, targets,
+ *		number of targets, solutions, error codes.
+ *
+ * RETURNED:	bitwise or of the error codes
+ *
+ ***********************************************************************/
+
+UInt8 SolveExprBatch (CompiledExpr * compP, VarCell * unknownP, double * targetP, UInt16 nTargets, double * solutionP, UInt8 * errP)
+{
+	double startX;
+	UInt16 i;
+	UInt8 err = 0;
+
+	// a defined unknown stays free from one target to the next
+	if (unknownP->defTreeP)
+	{
+		EvalVarDefs(compP->exprT.defsP);
+		unknownP->defState |= varDefFree;
+	}
+	startX = unknownP->value;
+	for (i = 0; i < nTargets; i++)
+	{
+		errP[i] = SolveExpr(compP, unknownP, targetP[i], solutionP + i);
+		if (!errP[i])
+			unknownP->value = solutionP[i];
+		err |= errP[i];
+	}
+	unknownP->value = startX;
+	unknownP->defState &= ~varDefFree;
+
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	GoalSeek
+ *
+ * DESCRIPTION: Compile an expression and solve it for one variable
+ *
+ * PARAMETERS:  Expression, variables assignations, name of the unknown
+ *		variable, target value, solution.
+ *
+ * RETURNED:	0 if no error
+ *
+ ***********************************************************************/
+
+UInt8 GoalSeek (Char * exprStr, Char * varsStr, Char * unknownName, double target, double * solutionP)
+{
+	CompiledExpr comp;
+	VarCell * unknownP;
+	UInt8 err = 0;
+
+	err |= CompileExpr(exprStr, varsStr, &comp);
+	if (err)
+		goto CleanUp;
+
+	unknownP = GetVarCell(&(comp.varL), unknownName);
+	if (!unknownP)
+		err |= missingVarError;
+	else
+		err |= SolveExpr(&comp, unknownP, target, solutionP);
+
+CleanUp:
+	DeleteCompiledExpr(&comp);
+	return err;
+}
@@ -0,0 +1,27 @@
+
+/***********************************************************************
+ *
+ * FILE : MemoCalcSolver.h
+ * 
+ * DESCRIPTION : Goal seek headers for MemoCalc
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef MEMOCALCSOLVER_H
+#define MEMOCALCSOLVER_H
+
+// solver settings
+
+#define kSolveMaxIter		100
+#define kSolveTolerance		1e-12
+
+// functions
+
+UInt8 SolveExpr (CompiledExpr * compP, VarCell * unknownP, double target, double * solutionP);
+UInt8 SolveExprBatch (CompiledExpr * compP, VarCell * unknownP, double * targetP, UInt16 nTargets, double * solutionP, UInt8 * errP);
+UInt8 GoalSeek (Char * exprStr, Char * varsStr, Char * unknownName, double target, double * solutionP);
+
+#endif // MEMOCALCSOLVER_H
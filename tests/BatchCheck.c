@@ -0,0 +1,154 @@
+/***********************************************************************
+ *
+ * FILE : BatchCheck.c
+ *
+ * DESCRIPTION : Checks of the single precision column evaluation
+ *		against double on the sample memos, every variable swept
+ *		from 0.5 to 1.5 times its value, and of the Monte Carlo
+ *		simulation in single precision with its double recheck.
+ *		The error of each sample is printed.
+ *
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ *
+ *
+ ***********************************************************************/
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+#include <math.h>
+#include <stdio.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcBatch.h"
+#include "MemoCalcMonteCarlo.h"
+#include "HostStubs.h"
+
+#define kSweepRows			500
+#define kMaxRelError		1e-5
+#define kMemoSize			4096
+#define kVarsTag			"<--vars-->"
+#define kExprTag			"<--expr-->"
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	SweepMemo
+ *
+ * DESCRIPTION: Compare the single precision batch with the double one
+ *		on a sample memo file
+ *
+ * PARAMETERS:  file name
+ *
+ ***********************************************************************/
+
+static void SweepMemo (const char * fileName)
+{
+	Char memoBuf[kMemoSize];
+	Char * varsStr, * exprStr;
+	CompiledExpr comp;
+	BatchError error;
+	VarCell * varP;
+	double ** columnP;
+	FILE * fileP;
+	size_t size;
+	UInt16 i;
+	UInt8 err;
+
+	fileP = fopen(fileName, "rb");
+	CHECK(fileP != NULL);
+	if (!fileP)
+		return;
+	size = fread(memoBuf, 1, kMemoSize - 1, fileP);
+	fclose(fileP);
+	memoBuf[size] = nullChr;
+	varsStr = StrStr(memoBuf, kVarsTag);
+	exprStr = StrStr(memoBuf, kExprTag);
+	CHECK(varsStr && exprStr);
+	if (!varsStr || !exprStr)
+		return;
+	* exprStr = nullChr;
+	varsStr += StrLen(kVarsTag);
+	exprStr += StrLen(kExprTag);
+
+	err = CompileExpr(exprStr, varsStr, &comp);
+	CHECK(!err);
+	if (err)
+		return;
+	columnP = MemPtrNew((comp.varL.nVars + 1) * sizeof(double *));
+	MemSet(columnP, (comp.varL.nVars + 1) * sizeof(double *), 0);
+	for (varP = comp.varL.headP; varP; varP = varP->nextP)
+	{
+		columnP[varP->index] = MemPtrNew(kSweepRows * sizeof(double));
+		for (i = 0; i < kSweepRows; i++)
+			columnP[varP->index][i] = varP->value * (0.5 + (double) ((i * 7 + varP->index * 13) % kSweepRows) / kSweepRows);
+	}
+
+	MemSet(&error, sizeof(BatchError), 0);
+	CompareBatchPrecision(&comp, columnP, kSweepRows, &error);
+	printf("%s: %ld rows, max relative error %.3g, mean %.3g\n", fileName,
+		(long) error.nRows, error.maxRelError, error.nRows ? error.sumRelError / error.nRows : 0);
+	CHECK(error.nErrorDiffs == 0);
+	CHECK(error.maxRelError < kMaxRelError);
+
+	for (i = 0; i <= comp.varL.nVars; i++)
+		if (columnP[i])
+			MemPtrFree(columnP[i]);
+	MemPtrFree(columnP);
+	DeleteCompiledExpr(&comp);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckMonteCarlo
+ *
+ * DESCRIPTION: Simulate the loan in double and in single precision,
+ *		then a sum pushed beyond the float range, which is only
+ *		evaluated by the double recheck
+ *
+ ***********************************************************************/
+
+static void CheckMonteCarlo (void)
+{
+	Char exprBuf[128], varsBuf[128];
+	MonteCarloStats doubleStats, singleStats;
+	BatchStats * batchStatsP = GetBatchStats();
+	UInt32 nSingleRows, nRechecked;
+	UInt8 err;
+
+	StrCopy(exprBuf, "amount * (rate* (1+rate)^years) / ((1+rate)^years-1) / 12");
+	StrCopy(varsBuf, "rate~uniform(0.04,0.08)\nyears=15\namount~normal(100000,5000)");
+	nSingleRows = batchStatsP->nSingleRows;
+	SetMonteCarloPrecision(batchDouble);
+	err = MonteCarlo(exprBuf, varsBuf, 2000, 1, &doubleStats);
+	CHECK(!err && batchStatsP->nSingleRows == nSingleRows);
+	StrCopy(exprBuf, "amount * (rate* (1+rate)^years) / ((1+rate)^years-1) / 12");
+	StrCopy(varsBuf, "rate~uniform(0.04,0.08)\nyears=15\namount~normal(100000,5000)");
+	SetMonteCarloPrecision(batchSingle);
+	err = MonteCarlo(exprBuf, varsBuf, 2000, 1, &singleStats);
+	CHECK(!err && batchStatsP->nSingleRows - nSingleRows == 2000);
+	CHECK(singleStats.nErrors == 0);
+	CHECK(fabs(singleStats.mean - doubleStats.mean) < kMaxRelError * doubleStats.mean);
+
+	// beyond the float range, every sample is evaluated again in double
+	nRechecked = batchStatsP->nRechecked;
+	StrCopy(exprBuf, "x*x*x*x");
+	StrCopy(varsBuf, "x~uniform(10000000000,20000000000)");
+	err = MonteCarlo(exprBuf, varsBuf, 100, 1, &singleStats);
+	CHECK(!err && singleStats.nErrors == 0 && singleStats.min >= 1e40);
+	CHECK(batchStatsP->nRechecked - nRechecked == 100);
+	SetMonteCarloPrecision(batchDouble);
+}
+
+
+int main (int argc, char ** argv)
+{
+	int i;
+
+	for (i = 1; i < argc; i++)
+		SweepMemo(argv[i]);
+	CheckMonteCarlo();
+	return HostCheckStatus("BatchCheck");
+}
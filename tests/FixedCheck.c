@@ -0,0 +1,162 @@
+/***********************************************************************
+ *
+ * FILE : FixedCheck.c
+ * 
+ * DESCRIPTION : Checks of the fixed point engine against the double
+ *		tree: rounding of the powers, saturation of the constants,
+ *		fallback on functions, and the loan sample. The time of both
+ *		engines on the loan sample is printed, on the host processor.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+#include <math.h>
+#include <time.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcFixed.h"
+#include "HostStubs.h"
+
+#define kLoanExpr		"amount * (rate* (1+rate)^years) / ((1+rate)^years-1) / 12"
+#define kLoanVars		"rate=0.065\nyears=15\namount=100000"
+#define kTimingEvals	200000L
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalBoth
+ *
+ * DESCRIPTION: Evaluate an expression with the tree and in fixed point
+ *
+ * PARAMETERS:  expression, variables, fixed point flags, double
+ *		result, fixed result as a double, overflows count
+ *
+ * RETURNED:	fixed point error, or the compile error
+ *
+ ***********************************************************************/
+
+static UInt8 EvalBoth (const Char * exprStr, const Char * varsStr, UInt8 flags, double * treeP, double * fixedP, UInt32 * nOverflowsP)
+{
+	Char exprBuf[128], varsBuf[128];
+	CompiledExpr comp;
+	FixedExpr fix;
+	Int64Value value;
+	UInt8 err = 0;
+
+	StrCopy(exprBuf, exprStr);
+	StrCopy(varsBuf, varsStr);
+	err = CompileExpr(exprBuf, varsBuf, &comp);
+	if (!err)
+		EvalExprTree(&(comp.exprT), treeP);
+	if (!err)
+		err = CompileFixedExpr(&comp, kFixedDefaultScale, flags, &fix);
+	if (!err)
+	{
+		err = EvalFixedExpr(&fix, &value);
+		if (!err)
+			* fixedP = FixedToDouble(&fix, value);
+		if (nOverflowsP)
+			* nOverflowsP = fix.nOverflows;
+		DeleteFixedExpr(&fix);
+	}
+	DeleteCompiledExpr(&comp);
+	return err;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	TimeLoan
+ *
+ * DESCRIPTION: Print the time of an evaluation of the loan sample on
+ *		the tree and in fixed point, the rate changing every time so
+ *		the fixed point engine converts it
+ *
+ ***********************************************************************/
+
+static void TimeLoan (void)
+{
+	Char exprBuf[128], varsBuf[128];
+	CompiledExpr comp;
+	FixedExpr fix;
+	VarCell * rateP;
+	Int64Value value;
+	double result, sum = 0;
+	clock_t start, treeTicks, fixedTicks;
+	Int32 i;
+
+	StrCopy(exprBuf, kLoanExpr);
+	StrCopy(varsBuf, kLoanVars);
+	CompileExpr(exprBuf, varsBuf, &comp);
+	CompileFixedExpr(&comp, kFixedDefaultScale, 0, &fix);
+	rateP = GetVarCell(&(comp.varL), "rate");
+
+	start = clock();
+	for (i = 0; i < kTimingEvals; i++)
+	{
+		rateP->value = 0.05 + (i & 15) * 0.001;
+		EvalExprTree(&(comp.exprT), &result);
+		sum += result;
+	}
+	treeTicks = clock() - start;
+	start = clock();
+	for (i = 0; i < kTimingEvals; i++)
+	{
+		rateP->value = 0.05 + (i & 15) * 0.001;
+		EvalFixedExpr(&fix, &value);
+		sum += value;
+	}
+	fixedTicks = clock() - start;
+
+	printf("loan on the host: tree %.3f us, fixed point %.3f us per evaluation (%g)\n",
+		1e6 * treeTicks / CLOCKS_PER_SEC / kTimingEvals, 1e6 * fixedTicks / CLOCKS_PER_SEC / kTimingEvals, sum ? 1.0 : 0.0);
+	DeleteFixedExpr(&fix);
+	DeleteCompiledExpr(&comp);
+}
+
+
+int main (int argc, char ** argv)
+{
+	double tree = 0, fixed = 0;
+	UInt32 nOverflows = 0;
+	UInt8 err;
+
+	// the loan sample to the cent
+	err = EvalBoth(kLoanExpr, kLoanVars, 0, &tree, &fixed, NULL);
+	CHECK(!err && fabs(fixed - tree) < 0.005);
+
+	// powers rounded once to the scale
+	err = EvalBoth("x^64", "x=1.05", 0, &tree, &fixed, NULL);
+	CHECK(!err && fabs(fixed - tree) <= 1e-8);
+	err = EvalBoth("x^(0-12)", "x=0.5", 0, &tree, &fixed, NULL);
+	CHECK(!err && fixed == 4096);
+	err = EvalBoth("x^13", "x=1.05", 0, &tree, &fixed, NULL);
+	CHECK(!err && fabs(fixed - tree) <= 1e-8);
+	err = EvalBoth("x^(0-2)", "x=0", 0, &tree, &fixed, NULL);
+	CHECK(err == mathError);
+
+	// overflows fail, or saturate and are counted, constants as well
+	err = EvalBoth("x*x", "x=100000000", 0, &tree, &fixed, NULL);
+	CHECK(err == overflowError);
+	err = EvalBoth("x*x", "x=100000000", fixedSaturate, &tree, &fixed, &nOverflows);
+	CHECK(!err && fixed > 9e10 && nOverflows == 1);
+	err = EvalBoth("100000000000000000000+x", "x=1", 0, &tree, &fixed, NULL);
+	CHECK(err == overflowError);
+	err = EvalBoth("0-100000000000000000000+x", "x=1", fixedSaturate, &tree, &fixed, &nOverflows);
+	CHECK(!err && fixed < -9e10 && nOverflows >= 1);
+
+	// functions are left to the double engines, on complete trees only
+	err = EvalBoth("sin(x)", "x=1", 0, &tree, &fixed, NULL);
+	CHECK(err == missingFuncError);
+	err = EvalBoth("x^0.5", "x=2", 0, &tree, &fixed, NULL);
+	CHECK(err == missingFuncError);
+
+	TimeLoan();
+	return HostCheckStatus("FixedCheck");
+}
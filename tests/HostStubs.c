@@ -0,0 +1,231 @@
+/***********************************************************************
+ *
+ * FILE : HostStubs.c
+ * 
+ * DESCRIPTION : Host side of the Palm OS calls the evaluation engines
+ *		make, for the checks. One database of records kept in memory
+ *		stands for the persistent trees cache and the memo database,
+ *		MathLib is present and its functions are the libm ones.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#include <PalmOS.h>
+
+#include "MathLib.h"
+#include "HostStubs.h"
+
+#define HostMathLib(name, func)	Err name (UInt16 refNum, double x, double * resultP) \
+								{ * resultP = func(x); return errNone; }
+
+// structures
+typedef struct HostRecord {
+	UInt32 size;
+	UInt32 uniqueID;
+	Boolean busy;			// got or new, until released
+	Char data[1];
+} HostRecord;
+
+// globals
+UInt16 MathLibRef = 1;
+
+static HostRecord * sRecords[kHostMaxRecords];
+static UInt16 sNumRecords;
+static UInt32 sLastID;
+static Boolean sCreated;
+static UInt16 sNumFailed;
+
+
+// data manager, one database in memory
+
+
+DmOpenRef DmOpenDatabaseByTypeCreator (UInt32 type, UInt32 creator, UInt16 mode)
+{
+	return sCreated ? (DmOpenRef) sRecords : NULL;
+}
+
+Err DmCreateDatabase (UInt16 card, const Char * name, UInt32 creator, UInt32 type, Boolean res)
+{
+	sCreated = true;
+	return errNone;
+}
+
+Err DmCloseDatabase (DmOpenRef db)
+{
+	return errNone;
+}
+
+UInt16 DmNumRecords (DmOpenRef db)
+{
+	return sNumRecords;
+}
+
+MemHandle DmQueryRecord (DmOpenRef db, UInt16 index)
+{
+	return index < sNumRecords ? sRecords[index] : NULL;
+}
+
+MemHandle DmGetRecord (DmOpenRef db, UInt16 index)
+{
+	if (index >= sNumRecords || sRecords[index]->busy)
+		return NULL;
+	sRecords[index]->busy = true;
+	return sRecords[index];
+}
+
+MemHandle DmQueryNextInCategory (DmOpenRef db, UInt16 * indexP, UInt16 category)
+{
+	return DmQueryRecord(db, * indexP);
+}
+
+Err DmRemoveRecord (DmOpenRef db, UInt16 index)
+{
+	if (index >= sNumRecords)
+		return 1;
+	free(sRecords[index]);
+	memmove(sRecords + index, sRecords + index + 1, (sNumRecords - index - 1) * sizeof(HostRecord *));
+	sNumRecords--;
+	return errNone;
+}
+
+MemHandle DmNewRecord (DmOpenRef db, UInt16 * indexP, UInt32 size)
+{
+	HostRecord * recP;
+
+	if (sNumRecords >= kHostMaxRecords)
+		return NULL;
+	if (* indexP > sNumRecords)
+		* indexP = sNumRecords;
+	recP = malloc(sizeof(HostRecord) + size);
+	recP->size = size;
+	recP->uniqueID = ++sLastID;
+	recP->busy = true;
+	memmove(sRecords + * indexP + 1, sRecords + * indexP, (sNumRecords - * indexP) * sizeof(HostRecord *));
+	sRecords[* indexP] = recP;
+	sNumRecords++;
+	return recP;
+}
+
+Err DmWrite (void * recP, UInt32 offset, const void * srcP, UInt32 size)
+{
+	memcpy((Char *) recP + offset, srcP, size);
+	return errNone;
+}
+
+Err DmReleaseRecord (DmOpenRef db, UInt16 index, Boolean dirty)
+{
+	if (index >= sNumRecords || !sRecords[index]->busy)
+		return 1;
+	sRecords[index]->busy = false;
+	return errNone;
+}
+
+UInt16 DmFindSortPosition (DmOpenRef db, void * newRecord, SortRecordInfoPtr info, DmComparF * comparF, Int16 other)
+{
+	UInt16 low = 0, high = sNumRecords, mid;
+
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		if (comparF(sRecords[mid]->data, newRecord, other, NULL, NULL, NULL) <= 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	return low;
+}
+
+Err DmRecordInfo (DmOpenRef db, UInt16 index, UInt16 * attrP, UInt32 * idP, void * chunkP)
+{
+	if (index >= sNumRecords)
+		return 1;
+	if (idP)
+		* idP = sRecords[index]->uniqueID;
+	return errNone;
+}
+
+Err DmFindRecordByID (DmOpenRef db, UInt32 id, UInt16 * indexP)
+{
+	UInt16 i;
+
+	for (i = 0; i < sNumRecords; i++)
+		if (sRecords[i]->uniqueID == id)
+		{
+			* indexP = i;
+			return errNone;
+		}
+	return 1;
+}
+
+void * MemHandleLock (MemHandle h)
+{
+	return ((HostRecord *) h)->data;
+}
+
+Err MemHandleUnlock (MemHandle h)
+{
+	return errNone;
+}
+
+
+// MathLib, on libm
+
+HostMathLib(MathLibACos, acos)
+HostMathLib(MathLibASin, asin)
+HostMathLib(MathLibATan, atan)
+HostMathLib(MathLibCos, cos)
+HostMathLib(MathLibSin, sin)
+HostMathLib(MathLibTan, tan)
+HostMathLib(MathLibCosH, cosh)
+HostMathLib(MathLibSinH, sinh)
+HostMathLib(MathLibTanH, tanh)
+HostMathLib(MathLibACosH, acosh)
+HostMathLib(MathLibASinH, asinh)
+HostMathLib(MathLibATanH, atanh)
+HostMathLib(MathLibExp, exp)
+HostMathLib(MathLibLog, log)
+HostMathLib(MathLibLog10, log10)
+HostMathLib(MathLibLog2, log2)
+HostMathLib(MathLibSqrt, sqrt)
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	HostResetRecords
+ *
+ * DESCRIPTION: Delete all the records and the database
+ *
+ ***********************************************************************/
+
+void HostResetRecords (void)
+{
+	while (sNumRecords)
+		free(sRecords[--sNumRecords]);
+	sCreated = false;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	HostCheck
+ *
+ * DESCRIPTION: Report a failed check, counted in the exit status
+ *		returned by HostCheckStatus
+ *
+ ***********************************************************************/
+
+void HostCheck (Boolean ok, const Char * what, const Char * file, Int16 line)
+{
+	if (ok)
+		return;
+	fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+	sNumFailed++;
+}
+
+int HostCheckStatus (const Char * name)
+{
+	printf("%s: %s\n", name, sNumFailed ? "FAILED" : "ok");
+	return sNumFailed ? 1 : 0;
+}
@@ -0,0 +1,24 @@
+/***********************************************************************
+ *
+ * FILE : HostStubs.h
+ * 
+ * DESCRIPTION : Host stubs and check helpers headers
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef HOSTSTUBS_H
+#define HOSTSTUBS_H
+
+#define kHostMaxRecords		1024
+
+// check a condition, the failure shows the condition and its line
+#define CHECK(c)			HostCheck((c) != 0, #c, __FILE__, __LINE__)
+
+void HostResetRecords (void);
+void HostCheck (Boolean ok, const Char * what, const Char * file, Int16 line);
+int HostCheckStatus (const Char * name);
+
+#endif // HOSTSTUBS_H
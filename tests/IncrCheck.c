@@ -0,0 +1,343 @@
+/***********************************************************************
+ *
+ * FILE : IncrCheck.c
+ *
+ * DESCRIPTION : Checks of the incremental evaluation against the tree
+ *		walk, on random expressions whose variables change one at a
+ *		time, in both evaluation modes and with every optimizer flag.
+ *		The time of an evaluation after one variable changed is
+ *		printed, on the host processor and an expression of more than
+ *		10000 nodes, for the tree walk, the incremental evaluation, and
+ *		Eval as the editor calls it with a new value, keys and
+ *		variables included.
+ *
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ *
+ *
+ ***********************************************************************/
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+#include <time.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcOptimizer.h"
+#include "MemoCalcIncremental.h"
+#include "HostStubs.h"
+
+#define kRandomExprs		3000
+#define kRandomUpdates		20
+#define kExprVars			8
+#define kExprSize			8192
+#define kTimingTerms		3600
+#define kTimingNodes		10000
+#define kTimingVars			64
+#define kTimingVarsSize		1536
+#define kTimingExprSize		49152
+#define kTimingEvals		640
+
+// globals
+static UInt32 sSeed = 1;
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	NextRandom
+ *
+ * DESCRIPTION: Linear congruential generator, the same sequence on
+ *		every host
+ *
+ * PARAMETERS:  bound
+ *
+ * RETURNED:	random number in [0, bound[
+ *
+ ***********************************************************************/
+
+static UInt32 NextRandom (UInt32 bound)
+{
+	sSeed = sSeed * 1103515245UL + 12345UL;
+	return (sSeed >> 16) % bound;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	RandomExpr
+ *
+ * DESCRIPTION: Append a random expression of variables a to h,
+ *		constants, operators, functions and integer powers
+ *
+ * PARAMETERS:  buffer, depth
+ *
+ ***********************************************************************/
+
+static void RandomExpr (Char * bufP, UInt16 depth)
+{
+	static const Char * funcs[] = { "sin", "cos", "log", "exp", "atan" };
+	static const Char * ops = "+-*/^&|";
+	UInt32 r = NextRandom(10);
+	Char op;
+
+	bufP += StrLen(bufP);
+	if (depth == 0 || r < 2)
+	{
+		if (NextRandom(3))
+			StrPrintF(bufP, "%c", (char) ('a' + NextRandom(kExprVars)));
+		else
+			StrPrintF(bufP, "%d.%d", (int) NextRandom(10), (int) NextRandom(10));
+	}
+	else if (r == 2)
+	{
+		StrPrintF(bufP, "%s(", funcs[NextRandom(5)]);
+		RandomExpr(bufP, depth - 1);
+		StrCat(bufP, ")");
+	}
+	else if (r == 3)
+	{
+		StrCat(bufP, "(");
+		RandomExpr(bufP, depth - 1);
+		StrPrintF(bufP + StrLen(bufP), ")^%d", (int) NextRandom(5));
+	}
+	else
+	{
+		op = ops[NextRandom(depth > 3 ? 4 : 7)];
+		if (op == '^' && NextRandom(2))
+			op = '*';
+		StrCat(bufP, "(");
+		RandomExpr(bufP, depth - 1);
+		StrPrintF(bufP + StrLen(bufP), "%c", op);
+		RandomExpr(bufP, depth - 1);
+		StrCat(bufP, ")");
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MakeVars, SetVars
+ *
+ * DESCRIPTION: Variables a to h as assignations, or in the cells of a
+ *		compiled expression
+ *
+ ***********************************************************************/
+
+static void MakeVars (Char * varsStr, double * valuesP)
+{
+	UInt16 i;
+
+	varsStr[0] = nullChr;
+	for (i = 0; i < kExprVars; i++)
+		StrPrintF(varsStr + StrLen(varsStr), "%s%c=%.6f", i ? "\n" : "", (char) ('a' + i), valuesP[i]);
+}
+
+static void SetVars (CompiledExpr * compP, double * valuesP)
+{
+	VarCell * varP;
+
+	for (varP = compP->varL.headP; varP; varP = varP->nextP)
+		varP->value = valuesP[varP->name[0] - 'a'];
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckRandomExprs
+ *
+ * DESCRIPTION: Compare the incremental evaluation with the tree walk,
+ *		results bitwise and errors, after each variable update
+ *
+ ***********************************************************************/
+
+static void CheckRandomExprs (void)
+{
+	Char exprBuf[kExprSize], varsBuf[256];
+	CompiledExpr comp;
+	IncrExpr incr;
+	double values[kExprVars], incrResult, treeResult;
+	UInt32 nChecks = 0, nDiffs = 0;
+	UInt16 i, k;
+	UInt8 incrErr, treeErr;
+
+	for (i = 0; i < kRandomExprs; i++)
+	{
+		exprBuf[0] = nullChr;
+		RandomExpr(exprBuf, 2 + NextRandom(6));
+		for (k = 0; k < kExprVars; k++)
+			values[k] = ((double) NextRandom(21) - 10) / 2;
+		MakeVars(varsBuf, values);
+		SetOptimizeFlags((UInt8) NextRandom(4));
+		SetEvalMode((UInt8) NextRandom(2));
+		if (CompileExpr(exprBuf, varsBuf, &comp))
+		{
+			DeleteCompiledExpr(&comp);
+			continue;
+		}
+		InitIncrExpr(&comp, &incr);
+		for (k = 0; k < kRandomUpdates; k++)
+		{
+			if (k)
+			{
+				values[NextRandom(kExprVars)] = NextRandom(5) ? ((double) NextRandom(21) - 10) / 2 : 0.0;
+				if (!NextRandom(7))
+					values[NextRandom(kExprVars)] = -0.0;
+				SetVars(&comp, values);
+			}
+			if (k == kRandomUpdates / 2)
+				SetEvalMode(!GetEvalMode());
+			incrErr = EvalIncrExpr(&incr, &incrResult);
+			treeErr = EvalExprTree(&(comp.exprT), &treeResult);
+			nChecks++;
+			if (!incrErr != !treeErr || (!incrErr && MemCmp(&incrResult, &treeResult, sizeof(double))
+			&& !(incrResult != incrResult && treeResult != treeResult)))
+				nDiffs++;
+		}
+		DeleteIncrExpr(&incr);
+		DeleteCompiledExpr(&comp);
+	}
+	printf("%ld random updates, %ld differences\n", (long) nChecks, (long) nDiffs);
+	CHECK(nChecks > kRandomExprs * kRandomUpdates / 2);
+	CHECK(nDiffs == 0);
+	SetOptimizeFlags(optimizeExact);
+	SetEvalMode(0);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	TimingExpr, TimingVars
+ *
+ * DESCRIPTION: Append a sum of products and sines of the variables v0
+ *		to v63, parenthesized as a balanced tree, and the variables as
+ *		assignations
+ *
+ * PARAMETERS:  buffer, first term, number of terms, or variables values
+ *
+ ***********************************************************************/
+
+static void TimingExpr (Char * bufP, UInt16 first, UInt16 nTerms)
+{
+	bufP += StrLen(bufP);
+	if (nTerms == 1 && first % 2)
+		StrPrintF(bufP, "sin(v%d)", (first * 3) % kTimingVars);
+	else if (nTerms == 1)
+		StrPrintF(bufP, "v%d*%d.5", first % kTimingVars, first % 7);
+	else
+	{
+		StrCat(bufP, "(");
+		TimingExpr(bufP, first, nTerms / 2);
+		StrCat(bufP, "+");
+		TimingExpr(bufP, first + nTerms / 2, nTerms - nTerms / 2);
+		StrCat(bufP, ")");
+	}
+}
+
+static void TimingVars (Char * varsStr, double * valuesP)
+{
+	UInt16 i;
+
+	varsStr[0] = nullChr;
+	for (i = 0; i < kTimingVars; i++)
+		StrPrintF(varsStr + StrLen(varsStr), "%sv%d=%.6f", i ? "\n" : "", i, valuesP[i]);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	TimeUpdates
+ *
+ * DESCRIPTION: Print the time of an evaluation after one variable
+ *		changed, on a sum of kTimingTerms products and sines of more
+ *		than kTimingNodes nodes: tree walk, incremental, and Eval on
+ *		the edited variables text
+ *
+ ***********************************************************************/
+
+static void TimeUpdates (void)
+{
+	Char varsBuf[kTimingVarsSize];
+	Char * exprBuf;
+	Char ** varsTbl;
+	CompiledExpr comp;
+	IncrExpr incr;
+	VarCell * varsP[kTimingVars];
+	double values[kTimingVars], treeResult = 0, incrResult = 0, evalResult = 0;
+	clock_t start, treeTicks, incrTicks, evalTicks;
+	UInt32 nRecomputed;
+	UInt16 i;
+
+	exprBuf = MemPtrNew(kTimingExprSize);
+	exprBuf[0] = nullChr;
+	TimingExpr(exprBuf, 0, kTimingTerms);
+	for (i = 0; i < kTimingVars; i++)
+		values[i] = i + 1;
+	TimingVars(varsBuf, values);
+	CompileExpr(exprBuf, varsBuf, &comp);
+	for (i = 0; i < kTimingVars; i++)
+	{
+		StrPrintF(varsBuf, "v%d", i);
+		varsP[i] = GetVarCell(&(comp.varL), varsBuf);
+	}
+	InitIncrExpr(&comp, &incr);
+	EvalIncrExpr(&incr, &incrResult);
+
+	// the variables text the editor passes after each new value
+	varsTbl = MemPtrNew(kTimingEvals * sizeof(Char *));
+	for (i = 0; i < kTimingEvals; i++)
+	{
+		values[i % kTimingVars] += 0.25;
+		TimingVars(varsBuf, values);
+		varsTbl[i] = MemPtrNew(1 + StrLen(varsBuf));
+		StrCopy(varsTbl[i], varsBuf);
+	}
+	Eval(exprBuf, varsTbl[kTimingEvals - 1], &evalResult);
+
+	start = clock();
+	for (i = 0; i < kTimingEvals; i++)
+	{
+		varsP[i % kTimingVars]->value += 0.25;
+		EvalExprTree(&(comp.exprT), &treeResult);
+	}
+	treeTicks = clock() - start;
+	for (i = 0; i < kTimingVars; i++)
+		varsP[i]->value = i + 1;
+	EvalIncrExpr(&incr, &incrResult);
+	nRecomputed = GetIncrStats()->nRecomputed;
+	start = clock();
+	for (i = 0; i < kTimingEvals; i++)
+	{
+		varsP[i % kTimingVars]->value += 0.25;
+		EvalIncrExpr(&incr, &incrResult);
+	}
+	incrTicks = clock() - start;
+	nRecomputed = GetIncrStats()->nRecomputed - nRecomputed;
+	start = clock();
+	for (i = 0; i < kTimingEvals; i++)
+		Eval(exprBuf, varsTbl[i], &evalResult);
+	evalTicks = clock() - start;
+
+	printf("%d nodes on the host, one variable of %d changed: tree %.2f us, incremental %.2f us"
+		" (%ld nodes evaluated again), Eval %.2f us per update\n",
+		incr.nNodes, kTimingVars, 1e6 * treeTicks / CLOCKS_PER_SEC / kTimingEvals,
+		1e6 * incrTicks / CLOCKS_PER_SEC / kTimingEvals, (long) (nRecomputed / kTimingEvals),
+		1e6 * evalTicks / CLOCKS_PER_SEC / kTimingEvals);
+	CHECK(incr.nNodes >= kTimingNodes);
+	CHECK(incrResult == treeResult);
+	CHECK(evalResult == treeResult);
+
+	for (i = 0; i < kTimingEvals; i++)
+		MemPtrFree(varsTbl[i]);
+	MemPtrFree(varsTbl);
+	MemPtrFree(exprBuf);
+	DeleteIncrExpr(&incr);
+	DeleteCompiledExpr(&comp);
+}
+
+
+int main (int argc, char ** argv)
+{
+	CheckRandomExprs();
+	TimeUpdates();
+	return HostCheckStatus("IncrCheck");
+}
@@ -0,0 +1,153 @@
+/***********************************************************************
+ *
+ * FILE : InternCheck.c
+ *
+ * DESCRIPTION : Checks of the intern table through Eval: memos with
+ *		the same tokens share an entry, other tokens compiled to the
+ *		same canonical tree share it and count its nodes as shared,
+ *		an expression that does not tokenize takes no entry, and the
+ *		evaluations of an entry tier up from the tree to the bytecode
+ *		and the incremental evaluator with the same results.
+ *
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ *
+ *
+ ***********************************************************************/
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+#include <time.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcCache.h"
+#include "MemoCalcIncremental.h"
+#include "MemoCalcBytecode.h"
+#include "MemoCalcIntern.h"
+#include "HostStubs.h"
+
+#define kTierChecks			(kTierIncrEvals + 16)
+#define kTimingEvals		100000
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalStr
+ *
+ * DESCRIPTION: Eval on copies of constant strings
+ *
+ * PARAMETERS:  expression, variables, result
+ *
+ * RETURNED:	Eval error
+ *
+ ***********************************************************************/
+
+static UInt8 EvalStr (const Char * exprStr, const Char * varsStr, double * resultP)
+{
+	Char exprBuf[128], varsBuf[128];
+
+	StrCopy(exprBuf, exprStr);
+	StrCopy(varsBuf, varsStr);
+	return Eval(exprBuf, varsBuf, resultP);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckTiers
+ *
+ * DESCRIPTION: Each evaluation of a memo edited one value at a time
+ *		matches the tree, on the tier its count calls for, and the
+ *		bytecode is timed against the tree
+ *
+ ***********************************************************************/
+
+static void CheckTiers (void)
+{
+	TierStats * tierStatsP = GetTierStats();
+	TieredExpr * tierP;
+	CompiledExpr comp;
+	Bytecode code;
+	Char exprBuf[64], varsBuf[64];
+	double result = 0, treeResult = 0;
+	clock_t start, treeTicks, codeTicks;
+	UInt32 i;
+	UInt8 err, tier;
+
+	for (i = 1; i <= kTierChecks; i++)
+	{
+		StrCopy(exprBuf, "a*b+c/(a-d)-cos(a)");
+		StrPrintF(varsBuf, "a=%ld\nb=3\nc=2\nd=b*2", (long)i + 10);
+		CHECK(!CompileExpr(exprBuf, varsBuf, &comp));
+		CHECK(!EvalExprTree(&(comp.exprT), &treeResult));
+		err = Eval(exprBuf, varsBuf, &result);
+		CHECK(!err && result == treeResult);
+		tierP = GetInternTier(exprBuf, &(comp.varL));
+		tier = i < kTierBytecodeEvals ? tierTree : i < kTierIncrEvals ? tierBytecode : tierIncremental;
+		CHECK(tierP && tierP->nEvals == i && tierP->tier == tier);
+		DeleteCompiledExpr(&comp);
+	}
+	CHECK(tierStatsP->nTierUps == 2 && tierStatsP->nTierFails == 0);
+	CHECK(tierStatsP->nBytecodeEvals == kTierIncrEvals - kTierBytecodeEvals);
+	CHECK(tierStatsP->nIncrEvals == kTierChecks - kTierIncrEvals + 1);
+
+	// the bytecode tier against the tree, on the same bound values
+	StrCopy(exprBuf, "a*b+c/(a-d)-cos(a)");
+	StrCopy(varsBuf, "a=12\nb=3\nc=2\nd=5");
+	CHECK(!CompileExpr(exprBuf, varsBuf, &comp));
+	CHECK(!CompileBytecode(&(comp.exprT), &code));
+	start = clock();
+	for (i = 0; i < kTimingEvals; i++)
+		EvalExprTree(&(comp.exprT), &treeResult);
+	treeTicks = clock() - start;
+	start = clock();
+	for (i = 0; i < kTimingEvals; i++)
+		EvalBytecode(&code, &result);
+	codeTicks = clock() - start;
+	CHECK(result == treeResult);
+	printf("%d operations on the host: tree %.3f us, bytecode %.3f us per evaluation\n",
+		code.nOps, 1e6 * treeTicks / CLOCKS_PER_SEC / kTimingEvals,
+		1e6 * codeTicks / CLOCKS_PER_SEC / kTimingEvals);
+	DeleteBytecode(&code);
+	DeleteCompiledExpr(&comp);
+}
+
+
+int main (int argc, char ** argv)
+{
+	InternStats * statsP = GetInternStats();
+	double result = 0;
+	UInt8 err;
+
+	// a new expression takes an entry
+	err = EvalStr("a*b+c", "a=2\nb=3\nc=4", &result);
+	CHECK(!err && result == 10);
+	CHECK(statsP->nEntries == 1 && statsP->nHits == 0 && statsP->nodesShared == 0);
+
+	// the same tokens with other values hit it, no tree is shared
+	err = EvalStr("a * b + c", "a=1\nb=3\nc=4", &result);
+	CHECK(!err && result == 7);
+	CHECK(statsP->nEntries == 1 && statsP->nHits == 1 && statsP->nodesShared == 0);
+
+	// other tokens compiled to the same tree share its 5 nodes
+	err = EvalStr("c+b*a", "a=2\nb=3\nc=5", &result);
+	CHECK(!err && result == 11);
+	CHECK(statsP->nEntries == 1 && statsP->nCanonicalHits == 1 && statsP->nodesShared == 5);
+
+	// evaluated again, hit by tokens, no more nodes shared
+	err = EvalStr("c+b*a", "a=2\nb=3\nc=6", &result);
+	CHECK(!err && result == 12);
+	CHECK(statsP->nHits == 2 && statsP->nodesShared == 5);
+
+	// no tokens, no key and no entry
+	err = EvalStr("a*#", "a=2", &result);
+	CHECK(err);
+	CHECK(statsP->nEntries == 1);
+	err = EvalStr("a*(b", "a=2\nb=3", &result);
+	CHECK(err & parseError);
+
+	CheckTiers();
+
+	return HostCheckStatus("InternCheck");
+}
@@ -0,0 +1,315 @@
+/***********************************************************************
+ *
+ * FILE : OptimizerCheck.c
+ *
+ * DESCRIPTION : Checks of the optimizer on random expressions against
+ *		their direct evaluation in the order written: bitwise equal
+ *		results and errors in exact mode, and polynomials in Horner
+ *		form within rounding of the sum of their terms otherwise. The
+ *		partial evaluation is checked against the whole tree, for
+ *		random free variables, and integer operations beyond 2^53
+ *		against their doubles in exact mode.
+ *
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ *
+ *
+ ***********************************************************************/
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcOptimizer.h"
+#include "HostStubs.h"
+
+#define kRandomExprs		3000
+#define kSpecializeEvals	10
+#define kExprVars			8
+#define kExprSize			8192
+#define kHornerRelError		1e-10
+
+// globals
+static UInt32 sSeed = 1;
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	NextRandom
+ *
+ * DESCRIPTION: Linear congruential generator, the same sequence on
+ *		every host
+ *
+ * PARAMETERS:  bound
+ *
+ * RETURNED:	random number in [0, bound[
+ *
+ ***********************************************************************/
+
+static UInt32 NextRandom (UInt32 bound)
+{
+	sSeed = sSeed * 1103515245UL + 12345UL;
+	return (sSeed >> 16) % bound;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	RandomExpr
+ *
+ * DESCRIPTION: Append a random fully parenthesized expression of
+ *		variables a to h and evaluate it in the order written, every
+ *		intermediate result checked as in evalCheckEachNode. A
+ *		polynomial only has sums, products and integer powers, and its
+ *		magnitude is the value with the absolute value of each term.
+ *
+ * PARAMETERS:  buffer, depth, variables values, polynomial only,
+ *		returned magnitude, cleared if some result is not finite
+ *
+ * RETURNED:	value
+ *
+ ***********************************************************************/
+
+static double RandomExpr (Char * bufP, UInt16 depth, double * valuesP, Boolean polynomial, double * magP, Boolean * finiteP)
+{
+	static const Char * funcs[] = { "sin", "cos", "log", "exp", "atan" };
+	static FuncType * funcRefs[] = { sin, cos, log, exp, atan };
+	UInt32 r = NextRandom(10);
+	double left, right, leftMag, rightMag, value;
+	UInt16 i, n;
+	Char op;
+
+	bufP += StrLen(bufP);
+	if (depth == 0 || r < 2)
+	{
+		if (NextRandom(3))
+		{
+			i = (UInt16) NextRandom(kExprVars);
+			StrPrintF(bufP, "%c", (char) ('a' + i));
+			value = valuesP[i];
+		}
+		else
+		{
+			StrPrintF(bufP, "%d.%d", (int) NextRandom(10), (int) NextRandom(10));
+			value = strtod(bufP, NULL);
+		}
+		* magP = fabs(value);
+	}
+	else if (r == 2 && !polynomial)
+	{
+		i = (UInt16) NextRandom(5);
+		StrPrintF(bufP, "%s(", funcs[i]);
+		value = funcRefs[i](RandomExpr(bufP, depth - 1, valuesP, polynomial, magP, finiteP));
+		StrCat(bufP, ")");
+		* magP = fabs(value);
+	}
+	else if (r <= 3)
+	{
+		StrCat(bufP, "(");
+		left = RandomExpr(bufP, depth - 1, valuesP, polynomial, &leftMag, finiteP);
+		n = (UInt16) NextRandom(5);
+		StrPrintF(bufP + StrLen(bufP), ")^%d", n);
+		value = IntPower(left, n);
+		* magP = IntPower(leftMag, n);
+	}
+	else
+	{
+		op = "+-*/"[NextRandom(polynomial ? 3 : 4)];
+		StrCat(bufP, "(");
+		left = RandomExpr(bufP, depth - 1, valuesP, polynomial, &leftMag, finiteP);
+		StrPrintF(bufP + StrLen(bufP), "%c", op);
+		right = RandomExpr(bufP, depth - 1, valuesP, polynomial, &rightMag, finiteP);
+		StrCat(bufP, ")");
+		switch (op)
+		{
+			case '+': value = left + right; * magP = leftMag + rightMag; break;
+			case '-': value = left - right; * magP = leftMag + rightMag; break;
+			case '*': value = left * right; * magP = leftMag * rightMag; break;
+			default: value = left / right; * magP = fabs(value);
+		}
+	}
+	if (isnan(value) || isinf(value))
+		* finiteP = false;
+	return value;
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	MakeVars
+ *
+ * DESCRIPTION: Random values of the variables a to h, as assignations
+ *
+ ***********************************************************************/
+
+static void MakeVars (Char * varsStr, double * valuesP)
+{
+	UInt16 i;
+
+	varsStr[0] = nullChr;
+	for (i = 0; i < kExprVars; i++)
+	{
+		valuesP[i] = ((double) NextRandom(41) - 20) / 4;
+		StrPrintF(varsStr + StrLen(varsStr), "%s%c=%.2f", i ? "\n" : "", (char) ('a' + i), valuesP[i]);
+	}
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckRandomExprs
+ *
+ * DESCRIPTION: Compare the optimized trees with the direct evaluation,
+ *		in exact mode and in Horner form
+ *
+ ***********************************************************************/
+
+static void CheckRandomExprs (Boolean polynomial)
+{
+	Char exprBuf[kExprSize], varsBuf[256];
+	CompiledExpr comp;
+	double values[kExprVars], result, expected, magnitude;
+	UInt32 nChecks = 0, nDiffs = 0, nPolynomials = 0;
+	Boolean finite;
+	UInt16 i;
+	UInt8 err;
+
+	SetOptimizeFlags(polynomial ? 0 : optimizeExact);
+	SetEvalMode(evalCheckEachNode);
+	for (i = 0; i < kRandomExprs; i++)
+	{
+		MakeVars(varsBuf, values);
+		exprBuf[0] = nullChr;
+		finite = true;
+		expected = RandomExpr(exprBuf, 2 + NextRandom(6), values, polynomial, &magnitude, &finite);
+		if (CompileExpr(exprBuf, varsBuf, &comp))
+		{
+			DeleteCompiledExpr(&comp);
+			continue;
+		}
+		nPolynomials += comp.exprT.stats.nPolynomials;
+		err = EvalExprTree(&(comp.exprT), &result);
+		nChecks++;
+		if ((err == 0) != finite)
+			nDiffs++;
+		else if (!err && !polynomial && MemCmp(&result, &expected, sizeof(double)))
+			nDiffs++;
+		else if (!err && polynomial && fabs(result - expected) > kHornerRelError * magnitude)
+			nDiffs++;
+		DeleteCompiledExpr(&comp);
+	}
+	printf("%s: %ld random expressions, %ld differences, %ld Horner polynomials\n",
+		polynomial ? "polynomials" : "exact", (long) nChecks, (long) nDiffs, (long) nPolynomials);
+	CHECK(nChecks > kRandomExprs / 2);
+	CHECK(nDiffs == 0);
+	CHECK(!polynomial || nPolynomials > 0);
+	SetOptimizeFlags(optimizeExact);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckSpecialize
+ *
+ * DESCRIPTION: Compare the partial evaluation with the whole tree,
+ *		results bitwise and errors, for new values of the free
+ *		variables
+ *
+ ***********************************************************************/
+
+static void CheckSpecialize (void)
+{
+	Char exprBuf[kExprSize], varsBuf[256];
+	CompiledExpr comp, spec;
+	VarCell * varP;
+	Boolean freeP[kExprVars + 1];
+	double values[kExprVars], specResult, treeResult, magnitude;
+	UInt32 nChecks = 0, nDiffs = 0;
+	Boolean finite;
+	UInt16 i, k;
+	UInt8 specErr, treeErr;
+
+	for (i = 0; i < kRandomExprs; i++)
+	{
+		MakeVars(varsBuf, values);
+		exprBuf[0] = nullChr;
+		RandomExpr(exprBuf, 2 + NextRandom(6), values, false, &magnitude, &finite);
+		SetOptimizeFlags((UInt8) NextRandom(2));
+		if (CompileExpr(exprBuf, varsBuf, &comp))
+		{
+			DeleteCompiledExpr(&comp);
+			continue;
+		}
+		MemSet(freeP, sizeof(freeP), 0);
+		for (varP = comp.varL.headP; varP; varP = varP->nextP)
+			freeP[varP->index] = NextRandom(3) == 0;
+		SpecializeExpr(&comp, freeP, &spec);
+		for (k = 0; k < kSpecializeEvals; k++)
+		{
+			for (varP = comp.varL.headP; varP; varP = varP->nextP)
+				if (freeP[varP->index])
+					varP->value = ((double) NextRandom(41) - 20) / 4;
+			specErr = EvalExprTree(&(spec.exprT), &specResult);
+			treeErr = EvalExprTree(&(comp.exprT), &treeResult);
+			nChecks++;
+			if (!specErr != !treeErr || (!specErr && MemCmp(&specResult, &treeResult, sizeof(double))))
+				nDiffs++;
+		}
+		DeleteNodes(spec.exprT.rootP);
+		DeleteCompiledExpr(&comp);
+	}
+	printf("specialized: %ld evaluations, %ld differences\n", (long) nChecks, (long) nDiffs);
+	CHECK(nChecks > kRandomExprs * kSpecializeEvals / 2);
+	CHECK(nDiffs == 0);
+	SetOptimizeFlags(optimizeExact);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckExactIntegers
+ *
+ * DESCRIPTION: In exact mode, bitwise results beyond 2^53 round to
+ *		doubles before the next operation, as written
+ *
+ ***********************************************************************/
+
+static void CheckExactIntegers (void)
+{
+	static const Char * exprs[] = { "(x|1)-(x|0)", "(x|1)&1", "~(x|1)+x", "(x|1)+1-x" };
+	Char exprBuf[32], varsBuf[64];
+	CompiledExpr comp;
+	Int64Value x;
+	double expected[4], result;
+	UInt16 i;
+
+	SetOptimizeFlags(optimizeExact);
+	SetEvalMode(evalCheckEachNode);
+	for (i = 0; i < sizeof(exprs) / sizeof(exprs[0]); i++)
+	{
+		StrCopy(exprBuf, exprs[i]);
+		StrCopy(varsBuf, "x=1152921504606846976");
+		CHECK(!CompileExpr(exprBuf, varsBuf, &comp));
+		x = (Int64Value) comp.varL.headP->value;
+		expected[0] = (double) (x | 1) - (double) (x | 0);
+		expected[1] = (double) ((Int64Value) (double) (x | 1) & 1);
+		expected[2] = (double) ~(Int64Value) (double) (x | 1) + (double) x;
+		expected[3] = (double) (x | 1) + 1 - (double) x;
+		CHECK(!EvalExprTree(&(comp.exprT), &result) && result == expected[i]);
+		DeleteCompiledExpr(&comp);
+	}
+	printf("exact integers: %d expressions beyond 2^53\n", (int) i);
+}
+
+
+int main (int argc, char ** argv)
+{
+	CheckRandomExprs(false);
+	CheckRandomExprs(true);
+	CheckSpecialize();
+	CheckExactIntegers();
+	return HostCheckStatus("OptimizerCheck");
+}
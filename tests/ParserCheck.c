@@ -0,0 +1,454 @@
+/***********************************************************************
+ *
+ * FILE : ParserCheck.c
+ *
+ * DESCRIPTION : Checks of the names bound by the lexer, whole names and
+ *		memo titles only, of the constants library, and of the
+ *		variables defined by an
+ *		expression: a deep chain of definitions, cycles read or not by
+ *		the expression, and the engines reading definitions, goal seek,
+ *		gradient, column evaluation, Monte Carlo, multiple expressions
+ *		and the incremental evaluation, against the tree walk. Bitwise
+ *		operands out of the integer range are math errors in every
+ *		engine.
+ *
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ *
+ *
+ ***********************************************************************/
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+#include <math.h>
+#include <time.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcIncremental.h"
+#include "MemoCalcGradient.h"
+#include "MemoCalcSolver.h"
+#include "MemoCalcBatch.h"
+#include "MemoCalcMonteCarlo.h"
+#include "MemoCalcMulti.h"
+#include "MemoCalcExport.h"
+#include "MemoCalcLibrary.h"
+#include "HostStubs.h"
+
+#define kChainDepth			30
+#define kVarsSize			1024
+#define kBatchRows			50
+#define kMaxRelError		1e-9
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckNames
+ *
+ * DESCRIPTION: A name binds the variable of the same whole name, not
+ *		one it begins, and a memo reference ends at its line end
+ *
+ ***********************************************************************/
+
+static void CheckNames (void)
+{
+	Char exprBuf[64], varsBuf[64];
+	CompiledExpr comp;
+	VarList varL;
+	double result = 0;
+
+	StrCopy(varsBuf, "rate2=5\nrate=1");
+	CHECK(!Eval("rate", varsBuf, &result) && result == 1);
+	StrCopy(varsBuf, "pix=2");
+	CHECK(!Eval("pi", varsBuf, &result) && result > 3.14 && result < 3.15);
+	StrCopy(varsBuf, "x=1");
+	CHECK(Eval("p", varsBuf, &result) & missingVarError);
+	StrCopy(varsBuf, "x=1");
+	CHECK(Eval("s(x)", varsBuf, &result) & missingFuncError);
+
+	MemSet(&varL, sizeof(VarList), 0);
+	AddVarCell(&varL, "@Loan monthly payments")->value = 100;
+	AddVarCell(&varL, "@Loan")->value = 1;
+	StrCopy(exprBuf, "@Loan*1000+@Loan monthly payments");
+	CHECK(!CompileParsedExpr(exprBuf, &varL, &comp));
+	CHECK(!EvalExprTree(&(comp.exprT), &result) && result == 1100);
+	DeleteCompiledExpr(&comp);
+
+	MemSet(&varL, sizeof(VarList), 0);
+	AddVarCell(&varL, "@Loan monthly payments")->value = 100;
+	AddVarCell(&varL, "@Loan")->value = 1;
+	StrCopy(exprBuf, "@Loan\nmonthly payments");
+	CHECK(CompileParsedExpr(exprBuf, &varL, &comp) & parseError);
+	DeleteCompiledExpr(&comp);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckChain
+ *
+ * DESCRIPTION: Each definition of the chain reads the previous one
+ *		twice, a copy per reference would have 2^kChainDepth nodes
+ *
+ ***********************************************************************/
+
+static void CheckChain (void)
+{
+	Char varsBuf[kVarsSize], exprBuf[16];
+	double result = 0;
+	clock_t start;
+	UInt16 i;
+	UInt8 err;
+
+	StrCopy(varsBuf, "d0=1.5");
+	for (i = 1; i <= kChainDepth; i++)
+		StrPrintF(varsBuf + StrLen(varsBuf), "\nd%d=d%d+d%d", i, i - 1, i - 1);
+	StrPrintF(exprBuf, "d%d", kChainDepth);
+	start = clock();
+	err = Eval(exprBuf, varsBuf, &result);
+	printf("%d chained definitions on the host: %.2f us\n", kChainDepth,
+		1e6 * (clock() - start) / CLOCKS_PER_SEC);
+	CHECK(!err);
+	CHECK(result == ldexp(1.5, kChainDepth));
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckLibrary
+ *
+ * DESCRIPTION: Library definitions evaluated once on the library vars,
+ *		a chain of them included, those in a cycle or not parsing
+ *		left out, and the memo vars overlaying the library
+ *
+ ***********************************************************************/
+
+static void CheckLibrary (void)
+{
+	Char varsBuf[kVarsSize], exprBuf[16];
+	double result = 0;
+	UInt16 i;
+
+	StrCopy(varsBuf, "g=9.5\nh=g*2\nc1=c2+1\nc2=c1\nbad=(\nk=h+1\nd0=1.5");
+	for (i = 1; i <= kChainDepth; i++)
+		StrPrintF(varsBuf + StrLen(varsBuf), "\nd%d=d%d+d%d", i, i - 1, i - 1);
+	CHECK(!LoadConstLibrary(varsBuf));
+	CHECK(GetLibraryStats()->nConsts == 3 + kChainDepth + 1);
+	StrCopy(varsBuf, "x=1");
+	CHECK(!Eval("h+k", varsBuf, &result) && result == 39);
+	StrPrintF(exprBuf, "d%d", kChainDepth);
+	StrCopy(varsBuf, "x=1");
+	CHECK(!Eval(exprBuf, varsBuf, &result) && result == ldexp(1.5, kChainDepth));
+	StrCopy(varsBuf, "x=1");
+	CHECK(Eval("c1", varsBuf, &result) & missingVarError);
+	StrCopy(varsBuf, "x=1");
+	CHECK(Eval("bad", varsBuf, &result) & missingVarError);
+	StrCopy(varsBuf, "g=1");
+	CHECK(!Eval("g+h", varsBuf, &result) && result == 20);
+	UnloadConstLibrary();
+	StrCopy(varsBuf, "x=1");
+	CHECK(Eval("h", varsBuf, &result) & missingVarError);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckCycles
+ *
+ * DESCRIPTION: A cycle is an error of the expressions reading it only
+ *
+ ***********************************************************************/
+
+static void CheckCycles (void)
+{
+	Char varsBuf[64];
+	double result = 0;
+
+	StrCopy(varsBuf, "x=2\na=b+1\nb=a*2");
+	CHECK(!Eval("x*3", varsBuf, &result) && result == 6);
+	StrCopy(varsBuf, "x=2\na=b+1\nb=a*2");
+	CHECK(Eval("x+a", varsBuf, &result) & cycleError);
+	StrCopy(varsBuf, "x=x+1");
+	CHECK(Eval("x", varsBuf, &result) & cycleError);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckSolver
+ *
+ * DESCRIPTION: Goal seek through a definition, and on a defined
+ *		variable, which then starts from its definition
+ *
+ ***********************************************************************/
+
+static void CheckSolver (void)
+{
+	Char varsBuf[64];
+	double solution = 0;
+
+	StrCopy(varsBuf, "rate=0.06\nmonthly=rate/12");
+	CHECK(!GoalSeek("1000*monthly", varsBuf, "rate", 2.5, &solution));
+	CHECK(fabs(solution - 0.03) < kMaxRelError);
+	StrCopy(varsBuf, "rate=0.06\nmonthly=rate/12");
+	CHECK(!GoalSeek("1000*monthly", varsBuf, "monthly", 2.5, &solution));
+	CHECK(fabs(solution - 0.0025) < kMaxRelError);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckGradient
+ *
+ * DESCRIPTION: Chain rule through the definitions
+ *
+ ***********************************************************************/
+
+static void CheckGradient (void)
+{
+	Char exprBuf[16], varsBuf[64];
+	CompiledExpr comp;
+	double result = 0, grad[3];
+	VarCell * xP, * yP;
+
+	StrCopy(exprBuf, "f*f+y");
+	StrCopy(varsBuf, "x=3\ny=5\nf=x*2");
+	CHECK(!CompileExpr(exprBuf, varsBuf, &comp));
+	xP = GetVarCell(&(comp.varL), "x");
+	yP = GetVarCell(&(comp.varL), "y");
+	CHECK(xP && yP && comp.varL.nVars == 3);
+	CHECK(!EvalExprGradient(&comp, &result, grad));
+	CHECK(result == 41 && grad[xP->index] == 24 && grad[yP->index] == 1);
+	DeleteCompiledExpr(&comp);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckBatch
+ *
+ * DESCRIPTION: A column of values of a variable read by a definition,
+ *		against the tree walk, then Monte Carlo through it
+ *
+ ***********************************************************************/
+
+static void CheckBatch (void)
+{
+	Char exprBuf[16], varsBuf[64];
+	CompiledExpr comp;
+	MonteCarloStats stats;
+	double ** columnP;
+	double results[kBatchRows], treeResult;
+	UInt8 errs[kBatchRows];
+	VarCell * xP;
+	UInt16 i;
+	UInt8 err;
+
+	StrCopy(exprBuf, "f+g+y");
+	StrCopy(varsBuf, "x=1\ny=2\nf=x*x\ng=y*3");
+	CHECK(!CompileExpr(exprBuf, varsBuf, &comp));
+	xP = GetVarCell(&(comp.varL), "x");
+	columnP = MemPtrNew((comp.varL.nVars + 1) * sizeof(double *));
+	MemSet(columnP, (comp.varL.nVars + 1) * sizeof(double *), 0);
+	columnP[xP->index] = MemPtrNew(kBatchRows * sizeof(double));
+	for (i = 0; i < kBatchRows; i++)
+		columnP[xP->index][i] = i * 0.5;
+	err = EvalExprBatch(&comp, columnP, kBatchRows, results, errs);
+	CHECK(!err);
+	for (i = 0; i < kBatchRows; i++)
+	{
+		xP->value = columnP[xP->index][i];
+		CHECK(!EvalExprTree(&(comp.exprT), &treeResult) && results[i] == treeResult);
+	}
+	MemPtrFree(columnP[xP->index]);
+	MemPtrFree(columnP);
+	DeleteCompiledExpr(&comp);
+
+	StrCopy(exprBuf, "f");
+	StrCopy(varsBuf, "x~uniform(1,2)\nf=x*2");
+	CHECK(!MonteCarlo(exprBuf, varsBuf, 1000, 1, &stats));
+	CHECK(stats.nErrors == 0 && stats.min >= 2 && stats.max <= 4);
+	CHECK(stats.min < stats.max);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckMulti
+ *
+ * DESCRIPTION: Named expressions reading definitions, against their
+ *		single evaluation, then the second one selected for the
+ *		engines of single expressions
+ *
+ ***********************************************************************/
+
+static void CheckMulti (void)
+{
+	Char exprBuf[32], varsBuf[64];
+	MultiExpr multi;
+	CompiledExpr comp;
+	MonteCarloStats stats;
+	double results[kMultiMaxExprs], result = 0, solution = 0, grad[4];
+	UInt8 errs[kMultiMaxExprs];
+	VarCell * xP;
+
+	StrCopy(exprBuf, "a: f+1\nb: f*2+a");
+	StrCopy(varsBuf, "x=3\nf=x*x");
+	CHECK(!CompileMultiExpr(exprBuf, varsBuf, &multi));
+	CHECK(multi.nExprs == 2);
+	EvalMultiExpr(&multi, results, errs);
+	CHECK(!errs[0] && !errs[1] && results[0] == 10 && results[1] == 28);
+	DeleteMultiExpr(&multi);
+	StrCopy(varsBuf, "x=3\nf=x*x");
+	CHECK(!Eval("f*2+(f+1)", varsBuf, &result) && result == results[1]);
+
+	// b = 3 x^2 + 1
+	StrCopy(varsBuf, "x=3\nf=x*x");
+	CHECK(!CompileMultiExpr(exprBuf, varsBuf, &multi));
+	CHECK(!GetMultiCompiledExpr(&multi, StrLen("a: f+1\nb"), &comp));
+	CHECK(comp.exprT.rootP == multi.trees[1].rootP);
+	xP = GetVarCell(&(comp.varL), "x");
+	CHECK(!EvalExprGradient(&comp, &result, grad));
+	CHECK(result == 28 && grad[xP->index] == 18);
+	CHECK(!SolveExpr(&comp, xP, 49, &solution));
+	CHECK(fabs(solution - 4) < kMaxRelError);
+	DeleteMultiExpr(&multi);
+
+	StrCopy(varsBuf, "x~uniform(1,2)\nf=x*x");
+	CHECK(!CompileMultiExpr(exprBuf, varsBuf, &multi));
+	CHECK(!GetMultiCompiledExpr(&multi, 0, &comp));
+	CHECK(!MonteCarloEval(&comp, 1000, 1, &stats));
+	CHECK(stats.nErrors == 0 && stats.min >= 2 && stats.max <= 5);
+	DeleteMultiExpr(&multi);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckIncremental
+ *
+ * DESCRIPTION: The incremental evaluation, after each variable update,
+ *		against the tree walk
+ *
+ ***********************************************************************/
+
+static void CheckIncremental (void)
+{
+	Char exprBuf[32], varsBuf[64];
+	CompiledExpr comp;
+	IncrExpr incr;
+	double incrResult, treeResult;
+	VarCell * xP, * yP;
+	UInt16 i;
+
+	StrCopy(exprBuf, "f*y+f/g");
+	StrCopy(varsBuf, "x=1\ny=2\nf=x*x+1\ng=f-y");
+	CHECK(!CompileExpr(exprBuf, varsBuf, &comp));
+	xP = GetVarCell(&(comp.varL), "x");
+	yP = GetVarCell(&(comp.varL), "y");
+	InitIncrExpr(&comp, &incr);
+	for (i = 0; i < 20; i++)
+	{
+		if (i % 2)
+			xP->value = i * 0.25;
+		else
+			yP->value = i * 0.5;
+		CHECK(!EvalIncrExpr(&incr, &incrResult) == !EvalExprTree(&(comp.exprT), &treeResult));
+		CHECK(incrResult == treeResult);
+	}
+	DeleteIncrExpr(&incr);
+	DeleteCompiledExpr(&comp);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckBitwiseRange
+ *
+ * DESCRIPTION: Bitwise operands beyond the Int64Value range are math
+ *		errors, in both evaluation modes, for the tree walk, the
+ *		gradient, the incremental evaluation and the columns in both
+ *		precisions
+ *
+ ***********************************************************************/
+
+static void CheckBitwiseRange (void)
+{
+	static const Char * exprs[] = { "x|1", "x&1", "~x", "(x|1)|y", "1+(y&x)" };
+	Char exprBuf[16], varsBuf[64];
+	CompiledExpr comp;
+	IncrExpr incr;
+	BatchOptions options;
+	double result, grad[3], results[2];
+	UInt8 errs[2];
+	UInt16 i, mode;
+
+	MemSet(&options, sizeof(BatchOptions), 0);
+	for (mode = 0; mode < 2; mode++)
+	{
+		SetEvalMode((UInt8) mode);
+		for (i = 0; i < sizeof(exprs) / sizeof(exprs[0]); i++)
+		{
+			StrCopy(exprBuf, exprs[i]);
+			StrCopy(varsBuf, "x=10000000000000000000\ny=1");
+			CHECK(Eval(exprBuf, varsBuf, &result) == mathError);
+			CHECK(!CompileExpr(exprBuf, varsBuf, &comp));
+			CHECK(EvalExprTree(&(comp.exprT), &result) == mathError);
+			CHECK(EvalExprGradient(&comp, &result, grad) == mathError);
+			InitIncrExpr(&comp, &incr);
+			CHECK(EvalIncrExpr(&incr, &result) == mathError);
+			DeleteIncrExpr(&incr);
+			options.precision = batchDouble;
+			EvalExprBatchOptions(&comp, NULL, 2, &options, results, errs);
+			CHECK(errs[0] == mathError && errs[1] == mathError);
+			options.precision = batchSingle;
+			EvalExprBatchOptions(&comp, NULL, 2, &options, results, errs);
+			CHECK(errs[0] == mathError && errs[1] == mathError);
+			DeleteCompiledExpr(&comp);
+		}
+	}
+	SetEvalMode(evalCheckEachNode);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	CheckExport
+ *
+ * DESCRIPTION: Definitions are exported as local constants
+ *
+ ***********************************************************************/
+
+static void CheckExport (void)
+{
+	Char exprBuf[16], varsBuf[64];
+	CompiledExpr comp;
+	Char * srcStr = NULL;
+
+	StrCopy(exprBuf, "f+y");
+	StrCopy(varsBuf, "x=1\ny=2\nf=x*x");
+	CHECK(!CompileExpr(exprBuf, varsBuf, &comp));
+	CHECK(!ExportExprC(&comp, "defs", exportInline, &srcStr));
+	CHECK(srcStr && StrStr(srcStr, "(double v_x, double v_y)")
+		&& StrStr(srcStr, "const double v_f = "));
+	if (srcStr)
+		MemPtrFree(srcStr);
+	DeleteCompiledExpr(&comp);
+}
+
+
+int main (int argc, char ** argv)
+{
+	CheckNames();
+	CheckChain();
+	CheckLibrary();
+	CheckCycles();
+	CheckSolver();
+	CheckGradient();
+	CheckBatch();
+	CheckMulti();
+	CheckIncremental();
+	CheckBitwiseRange();
+	CheckExport();
+	return HostCheckStatus("ParserCheck");
+}
@@ -0,0 +1,156 @@
+/***********************************************************************
+ *
+ * FILE : PersistCheck.c
+ *
+ * DESCRIPTION : Checks of the persistent compiled expressions cache:
+ *		trees are saved by PersistMemoExpr only, loaded on the next
+ *		run, and the least recently used record is deleted past
+ *		kPersistMaxRecords. The time of a cold evaluation of the loan
+ *		sample, compiled or loaded, is printed, on the host processor.
+ *
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ *
+ *
+ ***********************************************************************/
+
+#include <PalmOS.h>
+#include <FloatMgr.h>
+#include <time.h>
+
+#include "MemoCalcFunctions.h"
+#include "MemoCalcLexer.h"
+#include "MemoCalcParser.h"
+#include "MemoCalcOptimizer.h"
+#include "MemoCalcCache.h"
+#include "MemoCalcIncremental.h"
+#include "MemoCalcBytecode.h"
+#include "MemoCalcIntern.h"
+#include "MemoCalcPersist.h"
+#include "HostStubs.h"
+
+#define kCreator		'MCal'
+#define kLoanExpr		"amount * (rate* (1+rate)^years) / ((1+rate)^years-1) / 12"
+#define kLoanVars		"rate=0.065\nyears=15\namount=100000"
+#define kTimingEvals	20000L
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	Restart
+ *
+ * DESCRIPTION: Start a new run: the cache database is closed and opened
+ *		again, the tables in memory are emptied
+ *
+ ***********************************************************************/
+
+static void Restart (Boolean persist)
+{
+	ClosePersistCache();
+	FlushInternTable();
+	FlushEvalCache();
+	if (persist)
+		OpenPersistCache(kCreator);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	EvalStr, PersistStr
+ *
+ * DESCRIPTION: Eval and PersistMemoExpr on copies of constant strings
+ *
+ ***********************************************************************/
+
+static UInt8 EvalStr (const Char * exprStr, const Char * varsStr, double * resultP)
+{
+	Char exprBuf[128], varsBuf[128];
+
+	StrCopy(exprBuf, exprStr);
+	StrCopy(varsBuf, varsStr);
+	return Eval(exprBuf, varsBuf, resultP);
+}
+
+static UInt8 PersistStr (const Char * exprStr, const Char * varsStr)
+{
+	Char exprBuf[128], varsBuf[128];
+
+	StrCopy(exprBuf, exprStr);
+	StrCopy(varsBuf, varsStr);
+	return PersistMemoExpr(exprBuf, varsBuf);
+}
+
+
+/***********************************************************************
+ *
+ * FUNCTION:	TimeColdEval
+ *
+ * DESCRIPTION: Time of an evaluation of the loan sample after a
+ *		restart, without or with its saved tree
+ *
+ * RETURNED:	microseconds per evaluation
+ *
+ ***********************************************************************/
+
+static double TimeColdEval (Boolean persist)
+{
+	double result;
+	clock_t start, ticks = 0;
+	Int32 i;
+
+	for (i = 0; i < kTimingEvals; i++)
+	{
+		Restart(persist);
+		start = clock();
+		EvalStr(kLoanExpr, kLoanVars, &result);
+		ticks += clock() - start;
+	}
+	return 1e6 * ticks / CLOCKS_PER_SEC / kTimingEvals;
+}
+
+
+int main (int argc, char ** argv)
+{
+	PersistStats * statsP;
+	Char exprBuf[32];
+	double compiled = 0, loaded = 0, result;
+	UInt8 err;
+	Int16 i;
+
+	HostResetRecords();
+	OpenPersistCache(kCreator);
+	statsP = GetPersistStats();
+
+	// evaluating saves nothing, saving twice saves once
+	err = EvalStr(kLoanExpr, kLoanVars, &compiled);
+	CHECK(!err && statsP->nRecords == 0);
+	CHECK(!PersistStr(kLoanExpr, kLoanVars) && statsP->nRecords == 1);
+	CHECK(!PersistStr(kLoanExpr, kLoanVars) && statsP->nSaves == 1);
+
+	// the next run loads the tree
+	Restart(true);
+	err = EvalStr(kLoanExpr, kLoanVars, &loaded);
+	CHECK(!err && statsP->nLoads == 1 && loaded == compiled);
+
+	// full, the least recently used is deleted, not the loan just loaded
+	for (i = 1; i < kPersistMaxRecords; i++)
+	{
+		StrPrintF(exprBuf, "a+%d", i);
+		PersistStr(exprBuf, "a=1");
+	}
+	CHECK(statsP->nRecords == kPersistMaxRecords && statsP->nEvictions == 0);
+	Restart(true);
+	EvalStr(kLoanExpr, kLoanVars, &result);
+	CHECK(statsP->nLoads == 1);
+	PersistStr("a+1000", "a=1");
+	CHECK(statsP->nRecords == kPersistMaxRecords && statsP->nEvictions == 1);
+	Restart(true);
+	EvalStr(kLoanExpr, kLoanVars, &result);
+	EvalStr("a+2", "a=1", &result);
+	EvalStr("a+1", "a=1", &result);
+	CHECK(statsP->nLoads == 2 && statsP->nMisses == 1 && result == 2);
+
+	printf("loan cold start on the host: compiled %.2f us, loaded %.2f us per evaluation\n",
+		TimeColdEval(false), TimeColdEval(true));
+	ClosePersistCache();
+	return HostCheckStatus("PersistCheck");
+}
@@ -0,0 +1,61 @@
+/***********************************************************************
+ *
+ * FILE : FloatMgr.h
+ * 
+ * DESCRIPTION : Host shim of the Palm OS float manager, on the C
+ *		library conversions
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef HOST_FLOATMGR_H
+#define HOST_FLOATMGR_H
+
+typedef double FlpDouble;
+typedef union {
+	double d;
+	FlpDouble fd;
+	UInt32 ul[2];
+} FlpCompDouble;
+
+static Err FlpBufferAToF (FlpDouble * resultP, const Char * str)
+{
+	* resultP = strtod(str, NULL);
+	return 0;
+}
+
+static Err FlpFToA (FlpDouble d, Char * str)
+{
+	sprintf(str, "%.9g", d);
+	return 0;
+}
+
+// mantissa of 8 digits and base 10 exponent, as the Palm OS call
+static Err FlpBase10Info (FlpDouble d, UInt32 * mantissaP, Int16 * exponentP, Int16 * signP)
+{
+	Char buf[32], digits[16];
+	Char * p;
+	UInt16 n = 0;
+
+	* signP = d < 0;
+	if (d < 0)
+		d = -d;
+	if (d == 0)
+	{
+		* mantissaP = 0;
+		* exponentP = 0;
+		return 0;
+	}
+	sprintf(buf, "%.7e", d);
+	for (p = buf; * p && * p != 'e'; p++)
+		if (* p != '.')
+			digits[n++] = * p;
+	digits[n] = nullChr;
+	* mantissaP = strtoul(digits, NULL, 10);
+	* exponentP = atoi(p + 1) - 7;
+	return 0;
+}
+
+#endif // HOST_FLOATMGR_H
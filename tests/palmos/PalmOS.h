@@ -0,0 +1,115 @@
+/***********************************************************************
+ *
+ * FILE : PalmOS.h
+ * 
+ * DESCRIPTION : Host shim of the Palm OS headers, for the checks of the
+ *		evaluation engines built with the desktop C compiler. Only the
+ *		types and managers these sources use are provided, memory and
+ *		string calls map to the C library.
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#ifndef HOST_PALMOS_H
+#define HOST_PALMOS_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// types
+
+typedef uint8_t UInt8;
+typedef int8_t Int8;
+typedef uint16_t UInt16;
+typedef int16_t Int16;
+typedef uint32_t UInt32;
+typedef int32_t Int32;
+typedef char Char;
+typedef unsigned char Boolean;
+typedef uint16_t Err;
+typedef uint16_t WChar;
+typedef void * MemPtr;
+typedef void * MemHandle;
+typedef void * DmOpenRef;
+typedef void * SortRecordInfoPtr;
+typedef Int16 DmComparF (void *, void *, Int16, SortRecordInfoPtr, SortRecordInfoPtr, MemHandle);
+
+#define true				1
+#define false				0
+#define errNone				0
+#define nullChr				'\0'
+#define OffsetOf(type, member)	((UInt32) offsetof(type, member))
+
+// shared libraries, MathLib calls go straight to libm
+
+#define SYS_TRAP(x)
+#define sysLibTrapOpen		0
+#define sysLibTrapClose		0
+#define sysLibTrapSleep		0
+#define sysLibTrapWake		0
+#define sysLibTrapCustom	0
+
+// memory and string managers
+
+#define MemPtrNew(n)		malloc(n)
+#define MemPtrFree(p)		free(p)
+#define MemPtrResize(p,n)	(realloc(p, n) ? 0 : 1)
+#define MemSet(p,n,v)		memset(p, v, n)
+#define MemMove(d,s,n)		memmove(d, s, n)
+#define MemCmp(a,b,n)		memcmp(a, b, n)
+#define StrLen(s)			strlen(s)
+#define StrCopy(d,s)		strcpy(d, s)
+#define StrCat(d,s)			strcat(d, s)
+#define StrNCopy(d,s,n)		strncpy(d, s, n)
+#define StrNCompare(a,b,n)	strncmp(a, b, n)
+#define StrCompare(a,b)		strcmp(a, b)
+#define StrChr(s,c)			strchr(s, c)
+#define StrStr(a,b)			strstr(a, b)
+#define StrPrintF			sprintf
+#define StrIToA(s,i)		(sprintf(s, "%ld", (long)(i)), s)
+#define StrIToH(s,i)		(sprintf(s, "%08lX", (unsigned long)(i)), s)
+#define ErrFatalDisplayIf(c,m)
+
+// features, none is set on the host
+
+#define FtrGet(a,b,c)		1
+#define FtrSet(a,b,c)		0
+#define sysFtrCreator				0
+#define sysFtrNumProcessorID		0
+#define sysFtrNumProcessorMask		0xFFFF0000
+#define sysFtrNumProcessor328		0x00010000
+#define sysFtrNumProcessorEZ		0x00020000
+#define sysFtrNumProcessorVZ		0x00030000
+#define sysFtrNumProcessorSuperVZ	0x00040000
+#define sysFtrNumProcessorARM720T	0x00100000
+#define sysFtrNumProcessorIs68K(x)	(((x) & 0xFFF00000) == 0)
+#define sysFtrNumProcessorIsARM(x)	(((x) & 0xFFF00000) == 0x00100000)
+
+// data manager, records kept in memory by HostStubs.c
+
+#define dmModeReadWrite		3
+#define dmMaxRecordIndex	0xFFFF
+
+DmOpenRef DmOpenDatabaseByTypeCreator (UInt32 type, UInt32 creator, UInt16 mode);
+Err DmCreateDatabase (UInt16 card, const Char * name, UInt32 creator, UInt32 type, Boolean res);
+Err DmCloseDatabase (DmOpenRef db);
+UInt16 DmNumRecords (DmOpenRef db);
+MemHandle DmQueryRecord (DmOpenRef db, UInt16 index);
+MemHandle DmGetRecord (DmOpenRef db, UInt16 index);
+Err DmRemoveRecord (DmOpenRef db, UInt16 index);
+MemHandle DmNewRecord (DmOpenRef db, UInt16 * indexP, UInt32 size);
+Err DmWrite (void * recP, UInt32 offset, const void * srcP, UInt32 size);
+Err DmReleaseRecord (DmOpenRef db, UInt16 index, Boolean dirty);
+UInt16 DmFindSortPosition (DmOpenRef db, void * newRecord, SortRecordInfoPtr info, DmComparF * comparF, Int16 other);
+MemHandle DmQueryNextInCategory (DmOpenRef db, UInt16 * indexP, UInt16 category);
+Err DmRecordInfo (DmOpenRef db, UInt16 index, UInt16 * attrP, UInt32 * idP, void * chunkP);
+Err DmFindRecordByID (DmOpenRef db, UInt32 id, UInt16 * indexP);
+void * MemHandleLock (MemHandle h);
+Err MemHandleUnlock (MemHandle h);
+
+#endif // HOST_PALMOS_H
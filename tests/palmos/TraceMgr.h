@@ -0,0 +1,14 @@
+/***********************************************************************
+ *
+ * FILE : TraceMgr.h
+ * 
+ * DESCRIPTION : Host shim of the Palm OS trace manager, traces are
+ *		dropped
+ * 
+ * COPYRIGHT : (C) 2026 MemoCalc contributors
+ * 
+ *
+ ***********************************************************************/
+
+#define TraceOutput(x)
+#define TL(...)